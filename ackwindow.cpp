@@ -0,0 +1,93 @@
+#include <algorithm>
+#include "ackwindow.h"
+#include "logging.h"
+
+AckWindow::AckWindow(int count, int interval, QObject *parent) :
+    QObject(parent)
+  ,m_timer(new QTimer(this))
+  ,m_count(qMax(1, count))
+  ,m_started(false)
+  ,m_next(0)
+  ,m_pending(0)
+{
+    m_timer->setSingleShot(true);
+    m_timer->setInterval(interval);
+    connect(m_timer, SIGNAL(timeout()), this, SLOT(flush()));
+}
+
+
+void AckWindow::received(quint32 sequence, bool ok)
+{
+    if (m_started && sequence != m_next && m_next - sequence <= quint32(m_count))
+    {
+        /* A retransmission after a NAK or a late datagram, the numbers after it were handled already */
+        QList<quint32>::iterator it = std::lower_bound(m_failed.begin(), m_failed.end(), sequence);
+        bool listed = it != m_failed.end() && *it == sequence;
+        if (ok && listed)
+            m_failed.erase(it);
+        else if (!ok && !listed)
+            m_failed.insert(it, sequence);
+        m_pending += 1;
+        report();
+        return;
+    }
+
+    if (!m_started || sequence - m_next > quint32(m_count))
+    {
+        if (m_started)
+            qCInfo(lcMain) << "[QMLVIEWER] Ack sequence restarted at" << sequence << ", expected" << m_next;
+        flush();
+        m_started = true;
+        m_next = sequence;
+    }
+
+    /* Numbers that were skipped never arrived */
+    while (m_next != sequence)
+    {
+        m_failed.append(m_next);
+        m_next += 1;
+        m_pending += 1;
+    }
+
+    if (!ok)
+        m_failed.append(sequence);
+    m_next = sequence + 1;
+    m_pending += 1;
+    report();
+}
+
+
+void AckWindow::report()
+{
+    if (m_pending >= m_count)
+        flush();
+    else if (!m_timer->isActive())
+        m_timer->start();
+}
+
+
+void AckWindow::flush()
+{
+    m_timer->stop();
+    if (m_pending == 0)
+        return;
+
+    /* m_failed is in ascending order */
+    int i = 0;
+    while (i < m_failed.count())
+    {
+        quint32 base = m_failed.at(i);
+        quint32 bitmap = 0;
+        while (i < m_failed.count() && m_failed.at(i) - base < 32)
+        {
+            bitmap |= 1u << (m_failed.at(i) - base);
+            i++;
+        }
+        emit send(QString("NAK %1 %2").arg(base).arg(bitmap, 8, 16, QChar('0')));
+    }
+
+    emit send(QString("ACK %1").arg(m_next - 1));
+
+    m_failed.clear();
+    m_pending = 0;
+}
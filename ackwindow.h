@@ -0,0 +1,51 @@
+#ifndef ACKWINDOW_H
+#define ACKWINDOW_H
+
+#include <QObject>
+#include <QTimer>
+#include <QList>
+
+/*
+ * Windowed acknowledgements for sequence numbered inbound lines ("@1042 ...").
+ *
+ * Instead of a LUOK/LUNO/LUNP line per message the viewer reports, once every
+ * count messages or interval ms, whichever comes first:
+ *
+ *   NAK <base> <bitmap>  messages that failed (lookup or syntax error) or
+ *                        never arrived, bit n of the 32 bit hex bitmap is
+ *                        sequence number base + n, one line per 32 numbers
+ *   ACK <n>              every message up to and including n was handled
+ *
+ * NAK lines come before the ACK that covers them. Lines are expected in
+ * order, a skipped number counts as failed. A number up to count below the
+ * expected one is a retransmission or a late record: it is reported again in
+ * the next window, NAKed if it failed once more, and the expected number
+ * doesn't move. A larger jump in either direction means the sender restarted
+ * its numbering, the window is flushed and starts over from that number.
+ */
+class AckWindow : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AckWindow(int count, int interval, QObject *parent = 0);
+
+    void received(quint32 sequence, bool ok);
+
+signals:
+    void send(QString message);
+
+public slots:
+    void flush();
+
+private:
+    QTimer *m_timer;
+    int m_count;
+    bool m_started;
+    quint32 m_next;
+    int m_pending;
+    QList<quint32> m_failed;
+
+    void report();
+};
+
+#endif // ACKWINDOW_H
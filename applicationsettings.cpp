@@ -1,4 +1,6 @@
+#include <QHostAddress>
 #include "applicationsettings.h"
+#include "logging.h"
 
 ApplicationSettings::ApplicationSettings(QObject *parent) : QObject(parent)
 {
@@ -29,6 +31,24 @@ bool ApplicationSettings::enableAck() const
 }
 
 
+QString ApplicationSettings::ackMode() const
+{
+    return m_ackMode;
+}
+
+
+int ApplicationSettings::ackWindowCount() const
+{
+    return m_ackWindowCount;
+}
+
+
+int ApplicationSettings::ackWindowInterval() const
+{
+    return m_ackWindowInterval;
+}
+
+
 QList<SerialServerSetting> ApplicationSettings::serialServers() const
 {
     return m_serialServers;
@@ -41,6 +61,24 @@ QList<StringServerSetting> ApplicationSettings::stringServers() const
 }
 
 
+QList<LocalServerSetting> ApplicationSettings::localServers() const
+{
+    return m_localServers;
+}
+
+
+QList<UdpServerSetting> ApplicationSettings::udpServers() const
+{
+    return m_udpServers;
+}
+
+
+QList<ShmServerSetting> ApplicationSettings::shmServers() const
+{
+    return m_shmServers;
+}
+
+
 int ApplicationSettings::screenSaverTimeout() const
 {
     return m_screenSaverTimeout;
@@ -82,6 +120,54 @@ QString ApplicationSettings::languageFile() const
 }
 
 
+QString ApplicationSettings::logLevel() const
+{
+    return m_logLevel;
+}
+
+
+bool ApplicationSettings::logAsync() const
+{
+    return m_logAsync;
+}
+
+
+QString ApplicationSettings::logFile() const
+{
+    return m_logFile;
+}
+
+
+int ApplicationSettings::logFileMaxSize() const
+{
+    return m_logFileMaxSize;
+}
+
+
+int ApplicationSettings::logFileCount() const
+{
+    return m_logFileCount;
+}
+
+
+int ApplicationSettings::logRingSize() const
+{
+    return m_logRingSize;
+}
+
+
+int ApplicationSettings::metricsPort() const
+{
+    return m_metricsPort;
+}
+
+
+QString ApplicationSettings::metricsSocket() const
+{
+    return m_metricsSocket;
+}
+
+
 int ApplicationSettings::heartbeatInterval() const
 {
     return m_heartbeatInterval;
@@ -110,6 +196,9 @@ bool ApplicationSettings::validateSettingsFile(QJsonObject jsonObj)
     QStringList translateIdList;
     QStringList tcpServerPortList;
     QStringList serialServerPortList;
+    QStringList localServerPathList;
+    QStringList udpServerPortList;
+    QStringList shmServerNameList;
 
     QJsonArray tcpServers = jsonObj.value("tcp_servers").toArray();
     foreach (const QJsonValue &v, tcpServers)
@@ -178,16 +267,101 @@ bool ApplicationSettings::validateSettingsFile(QJsonObject jsonObj)
             primaryConnectionCount += 1;
     }
 
+    QJsonArray localServers = jsonObj.value("unix_socket_servers").toArray();
+    foreach (const QJsonValue &v, localServers)
+    {
+        if (v.toObject().value("enabled").toBool())
+            enabledServerCount += 1;
+
+        if (v.toObject().value("translate").toBool() == true && v.toObject().value("enabled").toBool())
+        {
+            QString translateId = v.toObject().value("translate_id").toString();
+            translateCount += 1;
+            if (translateId.length() == 0)
+                errorMessage.append("Missing translate_id for unix_socket_servers on path: ").append(v.toObject().value("path").toString()).append("\n");
+
+            if (!translateIdList.contains(translateId) && translateId.length() > 0)
+                translateIdList << translateId;
+            else
+                errorMessage.append("JSON field translate_id was duplicated: ").append(translateId).append("\n");
+        }
+
+        QString path = v.toObject().value("path").toString();
+        if (!localServerPathList.contains(path))
+            localServerPathList << path;
+        else
+            errorMessage.append("JSON field unix_socket_servers path was duplicated: ").append(path).append("\n");
+
+        if (v.toObject().value("primary_connection").toBool() == true && v.toObject().value("enabled").toBool())
+            primaryConnectionCount += 1;
+    }
+
+    QJsonArray udpServers = jsonObj.value("udp_servers").toArray();
+    foreach (const QJsonValue &v, udpServers)
+    {
+        if (v.toObject().value("enabled").toBool())
+            enabledServerCount += 1;
+
+        if (v.toObject().value("translate").toBool() == true && v.toObject().value("enabled").toBool())
+        {
+            QString translateId = v.toObject().value("translate_id").toString();
+            translateCount += 1;
+            if (translateId.length() == 0)
+                errorMessage.append("Missing translate_id for udp_servers on port: ").append(QString::number(v.toObject().value("port").toInt())).append("\n");
+
+            if (!translateIdList.contains(translateId) && translateId.length() > 0)
+                translateIdList << translateId;
+            else
+                errorMessage.append("JSON field translate_id was duplicated: ").append(translateId).append("\n");
+        }
+
+        /* Several multicast groups can share a port, only plain listeners can't */
+        QString port = QString::number(v.toObject().value("port").toInt());
+        if (v.toObject().value("multicast_group").toString().length() == 0)
+        {
+            if (!udpServerPortList.contains(port))
+                udpServerPortList << port;
+            else
+                errorMessage.append("JSON field udp_servers port was duplicated: ").append(port).append("\n");
+        }
+    }
+
+    QJsonArray shmServers = jsonObj.value("shm_servers").toArray();
+    foreach (const QJsonValue &v, shmServers)
+    {
+        if (v.toObject().value("enabled").toBool())
+            enabledServerCount += 1;
+
+        if (v.toObject().value("translate").toBool() == true && v.toObject().value("enabled").toBool())
+        {
+            QString translateId = v.toObject().value("translate_id").toString();
+            translateCount += 1;
+            if (translateId.length() == 0)
+                errorMessage.append("Missing translate_id for shm_servers named: ").append(v.toObject().value("name").toString()).append("\n");
+
+            if (!translateIdList.contains(translateId) && translateId.length() > 0)
+                translateIdList << translateId;
+            else
+                errorMessage.append("JSON field translate_id was duplicated: ").append(translateId).append("\n");
+        }
+
+        QString name = v.toObject().value("name").toString();
+        if (!shmServerNameList.contains(name))
+            shmServerNameList << name;
+        else
+            errorMessage.append("JSON field shm_servers name was duplicated: ").append(name).append("\n");
+    }
+
     if (enabledServerCount == 0)
-        errorMessage.append("You must enable at least one tcp_servers or serial_port_servers.\n");
+        errorMessage.append("You must enable at least one tcp_servers, unix_socket_servers, udp_servers, shm_servers or serial_port_servers.\n");
 
     if (primaryConnectionCount > 1)
-        qDebug() << "[SETTINGS WARNING] More than 1 primary_connection field was set to true.";
+        qCWarning(lcSettings) << "[SETTINGS WARNING] More than 1 primary_connection field was set to true.";
 
     if (translateCount > 0 && jsonObj.value("translate_file").toString().length() == 0)
     {
         if (QSysInfo::buildCpuArchitecture() == "arm")
-            qDebug() << "[SETTINGS WARNING] The JSON field translate_file is empty.";
+            qCWarning(lcSettings) << "[SETTINGS WARNING] The JSON field translate_file is empty.";
         else
             errorMessage.append("The JSON field translate_file is empty.\n");
     }
@@ -212,6 +386,14 @@ bool ApplicationSettings::setMembers(QJsonObject jsonObj)
         {
             /* set the members */
             m_enableAck = jsonObj.contains("enable_ack") ? jsonObj.value("enable_ack").toBool() : false;
+            m_ackMode = jsonObj.contains("ack_mode") ? jsonObj.value("ack_mode").toString() : "line";
+            m_ackWindowCount = jsonObj.contains("ack_window_count") ? jsonObj.value("ack_window_count").toInt() : 32;
+            m_ackWindowInterval = jsonObj.contains("ack_window_interval") ? jsonObj.value("ack_window_interval").toInt() : 50;
+            if (m_ackMode != "line" && m_ackMode != "window")
+            {
+                emit error("[SETTINGS ERROR] ack_mode must be line or window: " + m_ackMode);
+                return false;
+            }
             m_enableHeartbeat = jsonObj.contains("enable_heartbeat") ? jsonObj.value("enable_heartbeat").toBool() : false;
             m_enableWatchdog = jsonObj.contains("enable_watchdog") ? jsonObj.value("enable_watchdog").toBool() : false;
             m_fullScreen = jsonObj.contains("full_screen") ? jsonObj.value("full_screen").toBool() : true;
@@ -224,6 +406,14 @@ bool ApplicationSettings::setMembers(QJsonObject jsonObj)
             m_translateFile = jsonObj.contains("translate_file") ? jsonObj.value("translate_file").toString() : "";
             m_translateMaxMapSize = jsonObj.contains("translate_max_map_size") ? jsonObj.value("translate_max_map_size").toInt() : 400;
             m_languageFile = jsonObj.contains("language_translate_file") ? jsonObj.value("language_translate_file").toString() : "";
+            m_logLevel = jsonObj.contains("log_level") ? jsonObj.value("log_level").toString() : "debug";
+            m_logAsync = jsonObj.contains("log_async") ? jsonObj.value("log_async").toBool() : false;
+            m_logFile = jsonObj.contains("log_file") ? jsonObj.value("log_file").toString() : "";
+            m_logFileMaxSize = jsonObj.contains("log_file_max_size") ? jsonObj.value("log_file_max_size").toInt() : 1048576;
+            m_logFileCount = jsonObj.contains("log_file_count") ? jsonObj.value("log_file_count").toInt() : 3;
+            m_logRingSize = jsonObj.contains("log_ring_size") ? jsonObj.value("log_ring_size").toInt() : 256;
+            m_metricsPort = jsonObj.contains("metrics_port") ? jsonObj.value("metrics_port").toInt() : 0;
+            m_metricsSocket = jsonObj.contains("metrics_socket") ? jsonObj.value("metrics_socket").toString() : "";
 
             /* set serial port servers */
             foreach(const QJsonValue &v, jsonObj.value("serial_port_servers").toArray())
@@ -235,7 +425,7 @@ bool ApplicationSettings::setMembers(QJsonObject jsonObj)
                         m_serialServers << serialServer;
                     else
                     {
-                        qDebug() << "[SETTINGS ERROR] json not valid for serial_port_servers:" << v.toObject();
+                        qCWarning(lcSettings) << "[SETTINGS ERROR] json not valid for serial_port_servers:" << v.toObject();
                         emit error(serialServer.error());
                         return false;
                     }
@@ -253,18 +443,72 @@ bool ApplicationSettings::setMembers(QJsonObject jsonObj)
                         m_stringServers << stringServer;
                     else
                     {
-                        qDebug() << "[SETTINGS ERROR] json not valid for tcp_servers:" << v.toObject();
+                        qCWarning(lcSettings) << "[SETTINGS ERROR] json not valid for tcp_servers:" << v.toObject();
                         emit error(stringServer.error());
                         return false;
                     }
                 }
             }
 
+            /* set unix socket servers */
+            foreach(const QJsonValue &v, jsonObj.value("unix_socket_servers").toArray())
+            {
+                if (v.toObject().contains("enabled") && v.toObject().value("enabled").toBool())
+                {
+                    LocalServerSetting localServer;
+
+                    if (localServer.setMembers(v.toObject()))
+                        m_localServers << localServer;
+                    else
+                    {
+                        qCWarning(lcSettings) << "[SETTINGS ERROR] json not valid for unix_socket_servers:" << v.toObject();
+                        emit error(localServer.error());
+                        return false;
+                    }
+                }
+            }
+
+            /* set udp servers */
+            foreach(const QJsonValue &v, jsonObj.value("udp_servers").toArray())
+            {
+                if (v.toObject().contains("enabled") && v.toObject().value("enabled").toBool())
+                {
+                    UdpServerSetting udpServer;
+
+                    if (udpServer.setMembers(v.toObject()))
+                        m_udpServers << udpServer;
+                    else
+                    {
+                        qCWarning(lcSettings) << "[SETTINGS ERROR] json not valid for udp_servers:" << v.toObject();
+                        emit error(udpServer.error());
+                        return false;
+                    }
+                }
+            }
+
+            /* set shared memory servers */
+            foreach(const QJsonValue &v, jsonObj.value("shm_servers").toArray())
+            {
+                if (v.toObject().contains("enabled") && v.toObject().value("enabled").toBool())
+                {
+                    ShmServerSetting shmServer;
+
+                    if (shmServer.setMembers(v.toObject()))
+                        m_shmServers << shmServer;
+                    else
+                    {
+                        qCWarning(lcSettings) << "[SETTINGS ERROR] json not valid for shm_servers:" << v.toObject();
+                        emit error(shmServer.error());
+                        return false;
+                    }
+                }
+            }
+
             return true;
         }
         catch (std::exception & e)
         {
-            qDebug() << "[SETTINGS ERROR] " << e.what();
+            qCWarning(lcSettings) << "[SETTINGS ERROR] " << e.what();
             emit error( QString("[SETTINGS ERROR] ").append(e.what()));
             return false;
         }
@@ -364,6 +608,66 @@ bool SerialServerSetting::setMembers(QJsonObject jsonObj)
     }
 
     m_primaryConnection = jsonObj.contains("primary_connection") ? jsonObj.value("primary_connection").toBool() : false;
+    m_coalesce = jsonObj.contains("coalesce") ? jsonObj.value("coalesce").toBool() : false;
+    m_ioThread = jsonObj.contains("io_thread") ? jsonObj.value("io_thread").toBool() : false;
+    m_ioRingSize = jsonObj.contains("io_ring_size") ? jsonObj.value("io_ring_size").toInt() : 1024;
+    m_framing = jsonObj.contains("framing") ? jsonObj.value("framing").toString() : "line";
+    m_maxFrameSize = jsonObj.contains("max_frame_size") ? jsonObj.value("max_frame_size").toInt() : 4096;
+
+    /* Tty tuning, -1 and 0 leave the driver and QSerialPort defaults */
+    m_lowLatency = jsonObj.contains("low_latency") ? jsonObj.value("low_latency").toBool() : false;
+    m_vmin = jsonObj.contains("vmin") ? jsonObj.value("vmin").toInt() : -1;
+    m_vtime = jsonObj.contains("vtime") ? jsonObj.value("vtime").toInt() : -1;
+    m_readBufferSize = jsonObj.contains("read_buffer_size") ? jsonObj.value("read_buffer_size").toInt() : 0;
+    m_rxTriggerBytes = jsonObj.contains("rx_trigger_bytes") ? jsonObj.value("rx_trigger_bytes").toInt() : 0;
+    m_maxLineLength = jsonObj.contains("max_line_length") ? jsonObj.value("max_line_length").toInt() : 65536;
+    /* Bytes the native backend holds for a tty that doesn't take them, more is refused */
+    m_sendQueueBytes = jsonObj.contains("send_queue_bytes") ? jsonObj.value("send_queue_bytes").toInt() : 1048576;
+
+    if (m_vmin < -1 || m_vmin > 255 || m_vtime < -1 || m_vtime > 255)
+    {
+        m_error = "[SETTINGS ERROR] serial_port_servers vmin and vtime must be between 0 and 255.";
+        return false;
+    }
+
+    /* The port is polled, with VTIME 0 it only turns readable once VMIN bytes are waiting and a short last line stalls */
+    if (m_vmin > 1 && m_vtime <= 0)
+    {
+        m_error = "[SETTINGS ERROR] serial_port_servers vmin above 1 needs a vtime, a short line would never be read.";
+        return false;
+    }
+
+    if (m_maxLineLength <= 0 || m_sendQueueBytes <= 0 || m_readBufferSize < 0 || m_rxTriggerBytes < 0)
+    {
+        m_error = "[SETTINGS ERROR] serial_port_servers max_line_length and send_queue_bytes must be positive, read_buffer_size and rx_trigger_bytes not negative.";
+        return false;
+    }
+
+    /* "native" reads the tty from its own epoll thread instead of through QSerialPort */
+    m_backend = jsonObj.contains("backend") ? jsonObj.value("backend").toString() : "qt";
+    if (m_backend != "qt" && m_backend != "native")
+    {
+        m_error = "[SETTINGS ERROR] serial_port_servers backend must be \"qt\" or \"native\".";
+        return false;
+    }
+
+    if (m_backend == "native" && m_framing != "line")
+    {
+        m_error = "[SETTINGS ERROR] serial_port_servers backend \"native\" only supports line framing.";
+        return false;
+    }
+
+    if (m_framing != "line" && m_framing != "binary")
+    {
+        m_error = "[SETTINGS ERROR] serial_port_servers framing must be \"line\" or \"binary\".";
+        return false;
+    }
+
+    if (m_maxFrameSize <= 0)
+    {
+        m_error = "[SETTINGS ERROR] serial_port_servers max_frame_size must be positive.";
+        return false;
+    }
 
     return true;
 }
@@ -391,6 +695,152 @@ bool StringServerSetting::setMembers(QJsonObject jsonObj)
     }
 
     m_primaryConnection = jsonObj.contains("primary_connection") ? jsonObj.value("primary_connection").toBool() : false;
+    m_coalesce = jsonObj.contains("coalesce") ? jsonObj.value("coalesce").toBool() : false;
+    m_ioThread = jsonObj.contains("io_thread") ? jsonObj.value("io_thread").toBool() : false;
+    m_ioRingSize = jsonObj.contains("io_ring_size") ? jsonObj.value("io_ring_size").toInt() : 1024;
+    m_sendQueueBytes = jsonObj.contains("send_queue_bytes") ? jsonObj.value("send_queue_bytes").toInt() : 1048576;
+    m_sendQueueMessages = jsonObj.contains("send_queue_messages") ? jsonObj.value("send_queue_messages").toInt() : 10000;
+
+    QString policy = jsonObj.contains("send_queue_policy") ? jsonObj.value("send_queue_policy").toString() : "drop_oldest";
+    if (!SendQueue::policyFromString(policy, &m_sendQueuePolicy))
+    {
+        m_error = "[SETTINGS ERROR] Invalid tcp_servers send_queue_policy: " + policy;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool LocalServerSetting::setMembers(QJsonObject jsonObj)
+{
+    if (jsonObj.contains("path") && jsonObj.value("path").toString().length() > 0)
+        m_path = jsonObj.value("path").toString();
+    else
+    {
+        m_error = "[SETTINGS ERROR] Missing a unix_socket_servers path field.";
+        return false;
+    }
+
+    m_parseJson = jsonObj.contains("parse_json") ? jsonObj.value("parse_json").toBool() : false;
+    m_translate = jsonObj.contains("translate") ? jsonObj.value("translate").toBool() : true;
+
+    if (m_translate && jsonObj.contains("translate_id"))
+        m_translateId = jsonObj.value("translate_id").toString();
+    else if (m_translate)
+    {
+        m_error = "[SETTINGS ERROR] Missing a unix_socket_servers translate_id field.";
+        return false;
+    }
+
+    m_primaryConnection = jsonObj.contains("primary_connection") ? jsonObj.value("primary_connection").toBool() : false;
+    m_coalesce = jsonObj.contains("coalesce") ? jsonObj.value("coalesce").toBool() : false;
+    m_ioThread = jsonObj.contains("io_thread") ? jsonObj.value("io_thread").toBool() : false;
+    m_ioRingSize = jsonObj.contains("io_ring_size") ? jsonObj.value("io_ring_size").toInt() : 1024;
+    m_sendQueueBytes = jsonObj.contains("send_queue_bytes") ? jsonObj.value("send_queue_bytes").toInt() : 1048576;
+    m_sendQueueMessages = jsonObj.contains("send_queue_messages") ? jsonObj.value("send_queue_messages").toInt() : 10000;
+
+    QString policy = jsonObj.contains("send_queue_policy") ? jsonObj.value("send_queue_policy").toString() : "drop_oldest";
+    if (!SendQueue::policyFromString(policy, &m_sendQueuePolicy))
+    {
+        m_error = "[SETTINGS ERROR] Invalid unix_socket_servers send_queue_policy: " + policy;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool UdpServerSetting::setMembers(QJsonObject jsonObj)
+{
+    if (jsonObj.contains("port") && jsonObj.value("port").toInt() > 0)
+        m_port = jsonObj.value("port").toInt();
+    else
+    {
+        m_error = "[SETTINGS ERROR] Missing a udp_servers port field.";
+        return false;
+    }
+
+    /* IPv4 only, multicast membership is joined with ip_mreqn */
+    m_bindAddress = jsonObj.contains("bind_address") ? jsonObj.value("bind_address").toString() : "0.0.0.0";
+    if (QHostAddress(m_bindAddress).protocol() != QAbstractSocket::IPv4Protocol)
+    {
+        m_error = "[SETTINGS ERROR] Invalid udp_servers bind_address: " + m_bindAddress;
+        return false;
+    }
+
+    m_multicastGroup = jsonObj.contains("multicast_group") ? jsonObj.value("multicast_group").toString() : "";
+    if (m_multicastGroup.length() > 0 && !QHostAddress(m_multicastGroup).isInSubnet(QHostAddress("224.0.0.0"), 4))
+    {
+        m_error = "[SETTINGS ERROR] Invalid udp_servers multicast_group: " + m_multicastGroup;
+        return false;
+    }
+
+    m_multicastInterface = jsonObj.contains("multicast_interface") ? jsonObj.value("multicast_interface").toString() : "";
+    if (m_multicastInterface.length() > 0 && QHostAddress(m_multicastInterface).protocol() != QAbstractSocket::IPv4Protocol)
+    {
+        m_error = "[SETTINGS ERROR] Invalid udp_servers multicast_interface: " + m_multicastInterface;
+        return false;
+    }
+
+    m_receiveBufferSize = jsonObj.contains("receive_buffer_size") ? jsonObj.value("receive_buffer_size").toInt() : 0;
+    m_maxDatagramSize = jsonObj.contains("max_datagram_size") ? jsonObj.value("max_datagram_size").toInt() : 2048;
+    if (m_maxDatagramSize < 64 || m_maxDatagramSize > 65536)
+    {
+        m_error = "[SETTINGS ERROR] udp_servers max_datagram_size must be between 64 and 65536: " + QString::number(m_maxDatagramSize);
+        return false;
+    }
+
+    m_parseJson = jsonObj.contains("parse_json") ? jsonObj.value("parse_json").toBool() : false;
+    m_translate = jsonObj.contains("translate") ? jsonObj.value("translate").toBool() : true;
+
+    if (m_translate && jsonObj.contains("translate_id"))
+        m_translateId = jsonObj.value("translate_id").toString();
+    else if (m_translate)
+    {
+        m_error = "[SETTINGS ERROR] Missing a udp_servers translate_id field.";
+        return false;
+    }
+
+    m_coalesce = jsonObj.contains("coalesce") ? jsonObj.value("coalesce").toBool() : false;
+    m_ioThread = jsonObj.contains("io_thread") ? jsonObj.value("io_thread").toBool() : false;
+    m_ioRingSize = jsonObj.contains("io_ring_size") ? jsonObj.value("io_ring_size").toInt() : 1024;
+
+    return true;
+}
+
+
+bool ShmServerSetting::setMembers(QJsonObject jsonObj)
+{
+    /* shm_open() names are a single path component with a leading slash */
+    if (jsonObj.contains("name") && jsonObj.value("name").toString().startsWith("/")
+            && jsonObj.value("name").toString().count("/") == 1 && jsonObj.value("name").toString().length() > 1)
+        m_name = jsonObj.value("name").toString();
+    else
+    {
+        m_error = "[SETTINGS ERROR] Missing or invalid shm_servers name field, use a name like /qml-viewer.";
+        return false;
+    }
+
+    m_size = jsonObj.contains("size") ? jsonObj.value("size").toInt() : 262144;
+    if (m_size < 4096 || (m_size & (m_size - 1)) != 0)
+    {
+        m_error = "[SETTINGS ERROR] shm_servers size must be a power of two of at least 4096: " + QString::number(m_size);
+        return false;
+    }
+
+    m_parseJson = jsonObj.contains("parse_json") ? jsonObj.value("parse_json").toBool() : false;
+    m_translate = jsonObj.contains("translate") ? jsonObj.value("translate").toBool() : true;
+
+    if (m_translate && jsonObj.contains("translate_id"))
+        m_translateId = jsonObj.value("translate_id").toString();
+    else if (m_translate)
+    {
+        m_error = "[SETTINGS ERROR] Missing a shm_servers translate_id field.";
+        return false;
+    }
+
+    m_coalesce = jsonObj.contains("coalesce") ? jsonObj.value("coalesce").toBool() : false;
 
     return true;
 }
@@ -7,6 +7,7 @@
 #include <QJsonArray>
 #include <QFile>
 #include <QDebug>
+#include "sendqueue.h"
 
 class SerialServerSetting
 {
@@ -25,6 +26,19 @@ public:
     bool translate() const { return m_translate; }
     QString translateId() const { return m_translateId; }
     bool primaryConnection() const { return m_primaryConnection; }
+    bool coalesce() const { return m_coalesce; }
+    bool ioThread() const { return m_ioThread; }
+    int ioRingSize() const { return m_ioRingSize; }
+    QString framing() const { return m_framing; }
+    int maxFrameSize() const { return m_maxFrameSize; }
+    bool lowLatency() const { return m_lowLatency; }
+    int vmin() const { return m_vmin; }
+    int vtime() const { return m_vtime; }
+    int readBufferSize() const { return m_readBufferSize; }
+    int rxTriggerBytes() const { return m_rxTriggerBytes; }
+    int maxLineLength() const { return m_maxLineLength; }
+    qint64 sendQueueBytes() const { return m_sendQueueBytes; }
+    QString backend() const { return m_backend; }
     QString error() const { return m_error; }
 
     bool setMembers(QJsonObject jsonObj);
@@ -44,6 +58,19 @@ private:
     bool m_translate;
     QString m_translateId;
     bool m_primaryConnection;
+    bool m_coalesce;
+    bool m_ioThread;
+    int m_ioRingSize;
+    QString m_framing;
+    int m_maxFrameSize;
+    bool m_lowLatency;
+    int m_vmin;
+    int m_vtime;
+    int m_readBufferSize;
+    int m_rxTriggerBytes;
+    int m_maxLineLength;
+    qint64 m_sendQueueBytes;
+    QString m_backend;
     QString m_error;
 };
 
@@ -56,6 +83,12 @@ public:
     bool translate() const { return m_translate; }
     QString translateId() const { return m_translateId; }
     bool primaryConnection() const { return m_primaryConnection; }
+    bool coalesce() const { return m_coalesce; }
+    bool ioThread() const { return m_ioThread; }
+    int ioRingSize() const { return m_ioRingSize; }
+    qint64 sendQueueBytes() const { return m_sendQueueBytes; }
+    int sendQueueMessages() const { return m_sendQueueMessages; }
+    SendQueue::Policy sendQueuePolicy() const { return m_sendQueuePolicy; }
     QString error() const { return m_error; }
 
     bool setMembers(QJsonObject jsonObj);
@@ -66,6 +99,106 @@ private:
     bool m_translate;
     QString m_translateId;
     bool m_primaryConnection;
+    bool m_coalesce;
+    bool m_ioThread;
+    int m_ioRingSize;
+    qint64 m_sendQueueBytes;
+    int m_sendQueueMessages;
+    SendQueue::Policy m_sendQueuePolicy;
+    QString m_error;
+};
+
+
+class LocalServerSetting
+{
+public:
+    QString path() const { return m_path; }
+    bool parseJson() const { return m_parseJson; }
+    bool translate() const { return m_translate; }
+    QString translateId() const { return m_translateId; }
+    bool primaryConnection() const { return m_primaryConnection; }
+    bool coalesce() const { return m_coalesce; }
+    bool ioThread() const { return m_ioThread; }
+    int ioRingSize() const { return m_ioRingSize; }
+    qint64 sendQueueBytes() const { return m_sendQueueBytes; }
+    int sendQueueMessages() const { return m_sendQueueMessages; }
+    SendQueue::Policy sendQueuePolicy() const { return m_sendQueuePolicy; }
+    QString error() const { return m_error; }
+
+    bool setMembers(QJsonObject jsonObj);
+
+private:
+    QString m_path;
+    bool m_parseJson;
+    bool m_translate;
+    QString m_translateId;
+    bool m_primaryConnection;
+    bool m_coalesce;
+    bool m_ioThread;
+    int m_ioRingSize;
+    qint64 m_sendQueueBytes;
+    int m_sendQueueMessages;
+    SendQueue::Policy m_sendQueuePolicy;
+    QString m_error;
+};
+
+
+class UdpServerSetting
+{
+public:
+    int port() const { return m_port; }
+    QString bindAddress() const { return m_bindAddress; }
+    QString multicastGroup() const { return m_multicastGroup; }
+    QString multicastInterface() const { return m_multicastInterface; }
+    int receiveBufferSize() const { return m_receiveBufferSize; }
+    int maxDatagramSize() const { return m_maxDatagramSize; }
+    bool parseJson() const { return m_parseJson; }
+    bool translate() const { return m_translate; }
+    QString translateId() const { return m_translateId; }
+    bool coalesce() const { return m_coalesce; }
+    bool ioThread() const { return m_ioThread; }
+    int ioRingSize() const { return m_ioRingSize; }
+    QString error() const { return m_error; }
+
+    bool setMembers(QJsonObject jsonObj);
+
+private:
+    int m_port;
+    QString m_bindAddress;
+    QString m_multicastGroup;
+    QString m_multicastInterface;
+    int m_receiveBufferSize;
+    int m_maxDatagramSize;
+    bool m_parseJson;
+    bool m_translate;
+    QString m_translateId;
+    bool m_coalesce;
+    bool m_ioThread;
+    int m_ioRingSize;
+    QString m_error;
+};
+
+
+class ShmServerSetting
+{
+public:
+    QString name() const { return m_name; }
+    int size() const { return m_size; }
+    bool parseJson() const { return m_parseJson; }
+    bool translate() const { return m_translate; }
+    QString translateId() const { return m_translateId; }
+    bool coalesce() const { return m_coalesce; }
+    QString error() const { return m_error; }
+
+    bool setMembers(QJsonObject jsonObj);
+
+private:
+    QString m_name;
+    int m_size;
+    bool m_parseJson;
+    bool m_translate;
+    QString m_translateId;
+    bool m_coalesce;
     QString m_error;
 };
 
@@ -80,6 +213,9 @@ public:
     bool fullScreen() const;
     bool hideCursor() const;
     bool enableAck() const;
+    QString ackMode() const;
+    int ackWindowCount() const;
+    int ackWindowInterval() const;
     bool enableHeartbeat() const;
     int heartbeatInterval() const;
     int screenSaverTimeout() const;
@@ -89,9 +225,20 @@ public:
     QString translateFile() const;
     int translateMaxMapSize() const;
     QString languageFile() const;
+    QString logLevel() const;
+    bool logAsync() const;
+    QString logFile() const;
+    int logFileMaxSize() const;
+    int logFileCount() const;
+    int logRingSize() const;
+    int metricsPort() const;
+    QString metricsSocket() const;
 
     QList<SerialServerSetting> serialServers() const;
     QList<StringServerSetting> stringServers() const;
+    QList<LocalServerSetting> localServers() const;
+    QList<UdpServerSetting> udpServers() const;
+    QList<ShmServerSetting> shmServers() const;
 
     bool parseJSON(QString settingsFile);
 
@@ -106,6 +253,9 @@ private:
     bool m_fullScreen;
     bool m_hideCursor;
     bool m_enableAck;
+    QString m_ackMode;
+    int m_ackWindowCount;
+    int m_ackWindowInterval;
     bool m_enableHeartbeat;
     int m_heartbeatInterval;
     int m_screenSaverTimeout;
@@ -115,8 +265,19 @@ private:
     QString m_translateFile;
     int m_translateMaxMapSize;
     QString m_languageFile;
+    QString m_logLevel;
+    bool m_logAsync;
+    QString m_logFile;
+    int m_logFileMaxSize;
+    int m_logFileCount;
+    int m_logRingSize;
+    int m_metricsPort;
+    QString m_metricsSocket;
     QList<SerialServerSetting> m_serialServers;
     QList<StringServerSetting> m_stringServers;
+    QList<LocalServerSetting> m_localServers;
+    QList<UdpServerSetting> m_udpServers;
+    QList<ShmServerSetting> m_shmServers;
 
     bool setMembers(QJsonObject jsonObj);
     bool validateSettingsFile(QJsonObject jsonObj);
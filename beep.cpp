@@ -1,4 +1,5 @@
 #include "beep.h"
+#include "logging.h"
 
 Beep::Beep(QObject *parent) :
     QObject(parent)
@@ -19,7 +20,7 @@ Beep::~Beep()
 bool Beep::init()
 {
     if (isOpen()) {
-        qDebug() << "{QML] sound card is already open";
+        qCDebug(lcBeep) << "{QML] sound card is already open";
         return true;
     }
 
@@ -27,11 +28,11 @@ bool Beep::init()
     register int err;
     if ((err = snd_pcm_open(&m_playbackHandle, &SoundCardPortName[0], SND_PCM_STREAM_PLAYBACK, 0)) < 0)
     {
-        qDebug("[QML] can't open audio %s: %s\n", &SoundCardPortName[0], snd_strerror(err));
+        qCWarning(lcBeep, "[QML] can't open audio %s: %s\n", &SoundCardPortName[0], snd_strerror(err));
         return false;
     }
     else
-      qDebug() << "[QML] sound card is open";
+      qCInfo(lcBeep) << "[QML] sound card is open";
 
     m_open = true;
     return true;
@@ -41,7 +42,7 @@ bool Beep::init(const int frequency, const int duration)
 {
     m_frequency = frequency;
     m_duration = duration;
-    qDebug("[QML] beeper frequency %d and duration %d set", frequency, duration);
+    qCInfo(lcBeep, "[QML] beeper frequency %d and duration %d set", frequency, duration);
     return true;
 }
 
@@ -71,10 +72,10 @@ void Beep::setVolume(int volume)
     {
         m_volume = volume;
         QString output = execute(QString("amixer set PCM ").append(QString::number(volume).append("%")));
-        qDebug() << "[QML]" << output;
+        qCDebug(lcBeep) << "[QML]" << output;
     }
     else
-        qDebug() << "{QML] amixer error: volume must be set between 0 and 100";
+        qCWarning(lcBeep) << "{QML] amixer error: volume must be set between 0 and 100";
 }
 
 int Beep::volume()
@@ -88,7 +89,7 @@ void Beep::deinit()
     if (isOpen() && m_wavePtr) {
         snd_pcm_close(m_playbackHandle);
         m_open = false;
-        qDebug() << "[QML] sound card closed";
+        qCInfo(lcBeep) << "[QML] sound card closed";
     }
 }
 
@@ -132,7 +133,7 @@ bool Beep::openwave(const QString &path)
             // Set the audio card's hardware parameters (sample rate, bit resolution, etc)
             if ((err = snd_pcm_set_params(m_playbackHandle, m_format, SND_PCM_ACCESS_RW_INTERLEAVED, m_waveChannels, m_waveRate, 1, 100000)) < 0)
             {
-                qDebug("[QML] can't set sound parameters: %s\n", snd_strerror(err));
+                qCWarning(lcBeep, "[QML] can't set sound parameters: %s\n", snd_strerror(err));
                 return false;
             }
 
@@ -162,7 +163,7 @@ void Beep::play()
                 frames = snd_pcm_recover(m_playbackHandle, frames, 0);
             if (frames < 0)
             {
-                qDebug("[QML] error playing wave: %s\n", snd_strerror(frames));
+                qCWarning(lcBeep, "[QML] error playing wave: %s\n", snd_strerror(frames));
                 break;
             }
 
@@ -188,7 +189,7 @@ QString Beep::execute(QString command)
 {
     QProcess p(this);
     p.setProcessChannelMode(QProcess::MergedChannels);
-    qDebug() << "executing " << command << "\n";
+    qCDebug(lcBeep) << "executing " << command << "\n";
 
     p.start(command);
 
@@ -218,7 +219,7 @@ bool Beep::loadWaveFile(const char *fn)
 
     if ((inHandle = open(fn, O_RDONLY)) == -1)
     {
-        qDebug() << "[QML] could not open wave file:" << fn ;
+        qCWarning(lcBeep) << "[QML] could not open wave file:" << fn ;
         return false;
     }
     else
@@ -230,7 +231,7 @@ bool Beep::loadWaveFile(const char *fn)
             if (!compareID(&Riff[0], &head.ID[0]) || !compareID(&Wave[0], &head.Type[0]))
             {
                 close(inHandle);
-                qDebug() << "[QML] " << fn << "is not a wave file.";
+                qCWarning(lcBeep) << "[QML] " << fn << "is not a wave file.";
                 return false;
             }
 
@@ -249,7 +250,7 @@ bool Beep::loadWaveFile(const char *fn)
                     if (format.wFormatTag != 1)
                     {
                         close(inHandle);
-                        qDebug() << "[QML] compressed wave file is not supported";
+                        qCWarning(lcBeep) << "[QML] compressed wave file is not supported";
                         return false;
                     }
 
@@ -265,7 +266,7 @@ bool Beep::loadWaveFile(const char *fn)
                     if (!(m_wavePtr = (unsigned char *)malloc(head.Length)))
                     {
                         close(inHandle);
-                        qDebug() << "[QML] wave file won't fit in RAM";
+                        qCWarning(lcBeep) << "[QML] wave file won't fit in RAM";
                         return false;
                     }
 
@@ -293,7 +294,7 @@ bool Beep::loadWaveFile(const char *fn)
         }
     }
 
-    qDebug("[QML] beeper wave file loaded %s", fn);
+    qCInfo(lcBeep, "[QML] beeper wave file loaded %s", fn);
     return true;
 
 }
@@ -0,0 +1,12 @@
+TEMPLATE = subdirs
+
+# Benchmarks run on a development machine, no hardware is needed.
+SUBDIRS += \
+    parser \
+    ingest \
+    json \
+    listmodel \
+    tcpload \
+    serial \
+    transport \
+    translator
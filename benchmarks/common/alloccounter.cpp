@@ -0,0 +1,48 @@
+#include <stddef.h>
+#include "alloccounter.h"
+
+static bool s_counting = false;
+static quint64 s_allocations = 0;
+
+extern "C" {
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+    if (s_counting)
+        s_allocations++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    if (s_counting)
+        s_allocations++;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    if (s_counting)
+        s_allocations++;
+    return __libc_realloc(ptr, size);
+}
+
+}
+
+
+void AllocCounter::start()
+{
+    s_allocations = 0;
+    s_counting = true;
+}
+
+
+quint64 AllocCounter::stop()
+{
+    s_counting = false;
+    return s_allocations;
+}
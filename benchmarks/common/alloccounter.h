@@ -0,0 +1,19 @@
+#ifndef ALLOCCOUNTER_H
+#define ALLOCCOUNTER_H
+
+#include <QtGlobal>
+
+/*
+ * Counts heap allocations made by the process while started. malloc(),
+ * calloc() and realloc() are interposed and forwarded to glibc, so Qt
+ * containers and operator new are counted as well. Not thread safe, only
+ * count single threaded sections.
+ */
+class AllocCounter
+{
+public:
+    static void start();
+    static quint64 stop();
+};
+
+#endif // ALLOCCOUNTER_H
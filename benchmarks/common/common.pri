@@ -0,0 +1,5 @@
+# Shared helpers for the benchmarks.
+INCLUDEPATH += $$PWD $$PWD/../..
+
+SOURCES += $$PWD/alloccounter.cpp
+HEADERS += $$PWD/alloccounter.h
@@ -0,0 +1,81 @@
+# The viewer itself, without main.cpp, for benchmarks that drive MainController.
+VIEWER_DIR = $$PWD/../..
+
+QT += qml quick network serialport concurrent
+LIBS += -lasound -lrt
+INCLUDEPATH += $$VIEWER_DIR/tools/shmring
+
+SOURCES += \
+    $$VIEWER_DIR/maincontroller.cpp \
+    $$VIEWER_DIR/mainview.cpp \
+    $$VIEWER_DIR/stringserver.cpp \
+    $$VIEWER_DIR/localserver.cpp \
+    $$VIEWER_DIR/udpserver.cpp \
+    $$VIEWER_DIR/shmserver.cpp \
+    $$VIEWER_DIR/tools/shmring/shmring.c \
+    $$VIEWER_DIR/sendqueue.cpp \
+    $$VIEWER_DIR/streamclients.cpp \
+    $$VIEWER_DIR/serialserver.cpp \
+    $$VIEWER_DIR/nativeserialport.cpp \
+    $$VIEWER_DIR/translator.cpp \
+    $$VIEWER_DIR/translationrules.cpp \
+    $$VIEWER_DIR/ruleimage.cpp \
+    $$VIEWER_DIR/wildcardrules.cpp \
+    $$VIEWER_DIR/screen.cpp \
+    $$VIEWER_DIR/settings.cpp \
+    $$VIEWER_DIR/watchdog.cpp \
+    $$VIEWER_DIR/applicationsettings.cpp \
+    $$VIEWER_DIR/beep.cpp \
+    $$VIEWER_DIR/objectindex.cpp \
+    $$VIEWER_DIR/propertycache.cpp \
+    $$VIEWER_DIR/updatecoalescer.cpp \
+    $$VIEWER_DIR/messageparser.cpp \
+    $$VIEWER_DIR/jsonconverter.cpp \
+    $$VIEWER_DIR/jsonlistmodel.cpp \
+    $$VIEWER_DIR/ackwindow.cpp \
+    $$VIEWER_DIR/messagering.cpp \
+    $$VIEWER_DIR/iothread.cpp \
+    $$VIEWER_DIR/framecodec.cpp \
+    $$VIEWER_DIR/logging.cpp \
+    $$VIEWER_DIR/logger.cpp \
+    $$VIEWER_DIR/metrics.cpp \
+    $$VIEWER_DIR/metricsserver.cpp
+
+HEADERS += \
+    $$VIEWER_DIR/maincontroller.h \
+    $$VIEWER_DIR/mainview.h \
+    $$VIEWER_DIR/stringserver.h \
+    $$VIEWER_DIR/localserver.h \
+    $$VIEWER_DIR/udpserver.h \
+    $$VIEWER_DIR/shmserver.h \
+    $$VIEWER_DIR/tools/shmring/shmring.h \
+    $$VIEWER_DIR/sendqueue.h \
+    $$VIEWER_DIR/streamclients.h \
+    $$VIEWER_DIR/systemdefs.h \
+    $$VIEWER_DIR/serialserver.h \
+    $$VIEWER_DIR/nativeserialport.h \
+    $$VIEWER_DIR/translator.h \
+    $$VIEWER_DIR/translationrules.h \
+    $$VIEWER_DIR/ruleimage.h \
+    $$VIEWER_DIR/wildcardrules.h \
+    $$VIEWER_DIR/screen.h \
+    $$VIEWER_DIR/settings.h \
+    $$VIEWER_DIR/watchdog.h \
+    $$VIEWER_DIR/applicationsettings.h \
+    $$VIEWER_DIR/beep.h \
+    $$VIEWER_DIR/objectindex.h \
+    $$VIEWER_DIR/propertycache.h \
+    $$VIEWER_DIR/updatecoalescer.h \
+    $$VIEWER_DIR/messageparser.h \
+    $$VIEWER_DIR/jsonconverter.h \
+    $$VIEWER_DIR/jsonlistmodel.h \
+    $$VIEWER_DIR/ackwindow.h \
+    $$VIEWER_DIR/messagering.h \
+    $$VIEWER_DIR/iothread.h \
+    $$VIEWER_DIR/framecodec.h \
+    $$VIEWER_DIR/logging.h \
+    $$VIEWER_DIR/logger.h \
+    $$VIEWER_DIR/metrics.h \
+    $$VIEWER_DIR/metricsserver.h
+
+RESOURCES += $$VIEWER_DIR/qt.qrc
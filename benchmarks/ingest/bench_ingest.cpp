@@ -0,0 +1,313 @@
+#include <algorithm>
+#include <stdio.h>
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QQuickItem>
+#include <QFile>
+#include "alloccounter.h"
+#include "maincontroller.h"
+#include "mainview.h"
+
+/*
+ * End to end ingest benchmark.
+ *
+ * Builds a scene with N named objects, starts a MainController on it and
+ * replays a message mix through FakeTransport, which emits the same
+ * MessageAvailable signal as SerialServer/StringServer without any port.
+ * Runs under the offscreen platform, no hardware or display is needed:
+ *
+ *   bench_ingest --objects 200 --messages 100000 --mix mixed --ack
+ *
+ * Latency is measured from the emit until the target property's change
+ * signal fires. Property writes are applied directly, coalescing only applies
+ * to real servers.
+ */
+
+#define TRANSLATE_ID "MB"
+
+class FakeTransport : public QObject
+{
+    Q_OBJECT
+public:
+    void send(const QByteArray &ba, bool parseJson, bool translate)
+    {
+        emit MessageAvailable(ba, parseJson, translate, TRANSLATE_ID);
+    }
+
+signals:
+    void MessageAvailable(QByteArray ba, bool parseJson, bool translate, QString translateID);
+};
+
+
+class AppliedProbe : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AppliedProbe(const QElapsedTimer *clock) : appliedAt(-1), m_clock(clock) {}
+
+    qint64 appliedAt;
+
+public slots:
+    void onApplied() { appliedAt = m_clock->nsecsElapsed(); }
+
+private:
+    const QElapsedTimer *m_clock;
+};
+
+
+struct BenchMessage
+{
+    QByteArray line;
+    bool parseJson;
+    bool translate;
+    bool applies;
+};
+
+
+static bool writeFile(const QString &path, const QByteArray &content)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    return file.write(content) == content.size();
+}
+
+
+static QByteArray sceneQml(int objects)
+{
+    QByteArray qml("import QtQuick 2.5\n\nItem {\n    width: 800\n    height: 480\n");
+    for (int i = 0; i < objects; i++)
+        qml += "    Item { objectName: \"obj" + QByteArray::number(i) + "\"; property real value; property var payload }\n";
+    qml += "}\n";
+    return qml;
+}
+
+
+static QByteArray translateFile(int objects)
+{
+    QByteArray rules("G:%s,T:%s\n");
+    for (int i = 0; i < objects; i++)
+        rules += TRANSLATE_ID ":set" + QByteArray::number(i) + "=%d,T:obj" + QByteArray::number(i) + ".value=%d\n";
+    return rules;
+}
+
+
+static QByteArray settingsJson(const QString &dir, bool ack, bool heartbeat, const QString &logLevel)
+{
+    QJsonObject server;
+    server.insert("port", 0);
+    server.insert("enabled", true);
+    server.insert("parse_json", false);
+    server.insert("translate", true);
+    server.insert("translate_id", QString(TRANSLATE_ID));
+    server.insert("primary_connection", true);
+
+    QJsonObject settings;
+    settings.insert("main_view", dir + "/scene.qml");
+    settings.insert("full_screen", false);
+    settings.insert("enable_ack", ack);
+    /* The heartbeat timer has to run for "pong" to be taken as a heartbeat */
+    settings.insert("enable_heartbeat", heartbeat);
+    settings.insert("heartbeat_interval", 3600);
+    settings.insert("enable_watchdog", false);
+    settings.insert("translate_file", dir + "/translate.txt");
+    settings.insert("translate_max_map_size", 1000000);
+    settings.insert("log_level", logLevel);
+    settings.insert("tcp_servers", QJsonArray() << server);
+    settings.insert("serial_port_servers", QJsonArray());
+
+    return QJsonDocument(settings).toJson();
+}
+
+
+static BenchMessage makeMessage(const QString &kind, int i, int objects)
+{
+    BenchMessage msg;
+    QByteArray object = QByteArray::number(i % objects);
+    QByteArray value = QByteArray::number(i);
+
+    msg.parseJson = false;
+    msg.translate = false;
+    msg.applies = true;
+
+    if (kind == "translated")
+    {
+        msg.line = "set" + object + "=" + value + "\r\n";
+        msg.translate = true;
+    }
+    else if (kind == "json")
+    {
+        msg.line = "obj" + object + ".payload={\"v\":" + value + "}\r\n";
+        msg.parseJson = true;
+    }
+    else if (kind == "heartbeat")
+    {
+        msg.line = "pong\r\n";
+        msg.applies = false;
+    }
+    else
+        msg.line = "obj" + object + ".value=" + value + "\r\n";
+
+    return msg;
+}
+
+
+static qint64 percentile(QVector<qint64> &sorted, double p)
+{
+    if (sorted.isEmpty())
+        return 0;
+    int index = qMin(sorted.size() - 1, int(p * sorted.size()));
+    return sorted.at(index);
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("MainController ingest benchmark");
+    parser.addHelpOption();
+    QCommandLineOption objectsOption("objects", "Named objects in the scene.", "n", "100");
+    QCommandLineOption messagesOption("messages", "Messages to replay.", "n", "100000");
+    QCommandLineOption warmupOption("warmup", "Messages replayed before measuring.", "n", "1000");
+    QCommandLineOption mixOption("mix", "plain, translated, json, heartbeat or mixed.", "mix", "plain");
+    QCommandLineOption ackOption("ack", "Enable lookup acks.");
+    QCommandLineOption logOption("log-level", "Viewer log level.", "level", "warning");
+    parser.addOption(objectsOption);
+    parser.addOption(messagesOption);
+    parser.addOption(warmupOption);
+    parser.addOption(mixOption);
+    parser.addOption(ackOption);
+    parser.addOption(logOption);
+    parser.process(app);
+
+    int objects = qMax(1, parser.value(objectsOption).toInt());
+    int messages = qMax(1, parser.value(messagesOption).toInt());
+    int warmup = qMax(0, parser.value(warmupOption).toInt());
+    QString mix = parser.value(mixOption);
+    bool ack = parser.isSet(ackOption);
+
+    QStringList kinds;
+    if (mix == "mixed")
+        kinds << "plain" << "translated" << "json" << "heartbeat";
+    else if (mix == "plain" || mix == "translated" || mix == "json" || mix == "heartbeat")
+        kinds << mix;
+    else
+    {
+        fprintf(stderr, "unknown mix: %s\n", qPrintable(mix));
+        return 1;
+    }
+
+    QTemporaryDir dir;
+    if (!dir.isValid()
+            || !writeFile(dir.path() + "/scene.qml", sceneQml(objects))
+            || !writeFile(dir.path() + "/translate.txt", translateFile(objects))
+            || !writeFile(dir.path() + "/settings.json", settingsJson(dir.path(), ack, kinds.contains("heartbeat"),
+                                                                      parser.value(logOption))))
+    {
+        fprintf(stderr, "unable to create the benchmark files\n");
+        return 1;
+    }
+
+    MainView view;
+    /* Without OpenGL the scene graph can't render, that doesn't matter here */
+    QObject::connect(&view, &QQuickWindow::sceneGraphError, [](QQuickWindow::SceneGraphError, const QString &message) {
+        fprintf(stderr, "scene graph error ignored: %s\n", qPrintable(message));
+    });
+
+    MainController controller(&view, dir.path() + "/settings.json");
+    if (!controller.getStartUpError().isEmpty())
+    {
+        fprintf(stderr, "%s\n", qPrintable(controller.getStartUpError()));
+        return 1;
+    }
+
+    view.setSource(QUrl::fromLocalFile(controller.getMainViewPath()));
+    if (view.status() != QQuickView::Ready)
+    {
+        fprintf(stderr, "unable to load the scene\n");
+        return 1;
+    }
+    app.processEvents();
+
+    /* Watch every property the messages write */
+    QElapsedTimer clock;
+    clock.start();
+    AppliedProbe probe(&clock);
+    foreach (QQuickItem *item, view.rootObject()->findChildren<QQuickItem*>())
+    {
+        QObject::connect(item, SIGNAL(valueChanged()), &probe, SLOT(onApplied()));
+        QObject::connect(item, SIGNAL(payloadChanged()), &probe, SLOT(onApplied()));
+    }
+
+    FakeTransport transport;
+    QObject::connect(&transport, SIGNAL(MessageAvailable(QByteArray, bool, bool, QString)),
+                     &controller, SLOT(onMessageAvailable(QByteArray, bool, bool, QString)));
+
+    /* Build the messages up front so only MainController is measured */
+    QVector<BenchMessage> replay;
+    replay.reserve(warmup + messages);
+    for (int i = 0; i < warmup + messages; i++)
+        replay.append(makeMessage(kinds.at(i % kinds.size()), i, objects));
+
+    for (int i = 0; i < warmup; i++)
+        transport.send(replay.at(i).line, replay.at(i).parseJson, replay.at(i).translate);
+
+    QVector<qint64> latencies;
+    latencies.reserve(messages);
+    int missed = 0;
+    int translatedMissed = 0;
+
+    AllocCounter::start();
+    qint64 started = clock.nsecsElapsed();
+    for (int i = warmup; i < warmup + messages; i++)
+    {
+        const BenchMessage &msg = replay.at(i);
+        probe.appliedAt = -1;
+        qint64 sent = clock.nsecsElapsed();
+
+        transport.send(msg.line, msg.parseJson, msg.translate);
+
+        if (!msg.applies)
+            continue;
+        if (probe.appliedAt >= 0)
+            latencies.append(probe.appliedAt - sent);
+        else
+        {
+            missed++;
+            if (msg.translate)
+                translatedMissed++;
+        }
+    }
+    qint64 elapsed = clock.nsecsElapsed() - started;
+    quint64 allocations = AllocCounter::stop();
+
+    std::sort(latencies.begin(), latencies.end());
+
+    printf("mix=%s objects=%d messages=%d ack=%s\n", qPrintable(mix), objects, messages, ack ? "on" : "off");
+    printf("throughput: %.0f msg/s\n", messages / (elapsed / 1e9));
+    printf("latency: p50 %.2f us, p99 %.2f us\n", percentile(latencies, 0.5) / 1e3, percentile(latencies, 0.99) / 1e3);
+    printf("allocations per message: %.2f\n", double(allocations) / messages);
+    if (missed > 0)
+        printf("messages without a property change: %d\n", missed);
+
+    /* A translated line that sets nothing means the rules don't match, the numbers are of the miss path */
+    if (translatedMissed > 0)
+    {
+        fprintf(stderr, "%d translated messages matched no rule\n", translatedMissed);
+        return 1;
+    }
+
+    return 0;
+}
+
+#include "bench_ingest.moc"
@@ -0,0 +1,177 @@
+#include <QtTest>
+#include <QQmlEngine>
+#include <QQmlComponent>
+#include "alloccounter.h"
+#include "jsonconverter.h"
+
+/*
+ * parse_json writes to a QML "property var", through the QJsonDocument
+ * QVariant tree that setJsonProperty used to build and through the engine's
+ * JSON.parse(). A binding reads value.steps.length after every write, so the
+ * time includes QML turning the written value into something JS can use.
+ *
+ *   small  a recipe with 3 steps, about 400 bytes
+ *   large  a recipe with 250 steps, about 40 KB
+ */
+class JsonBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void variantPath_data();
+    void variantPath();
+    void enginePath_data();
+    void enginePath();
+    void sameResult();
+    void allocationsPerWrite();
+
+private:
+    QQmlEngine *m_engine;
+    QObject *m_target;
+    QMetaProperty m_value;
+    JsonConverter *m_converter;
+    QByteArray m_small;
+    QByteArray m_large;
+
+    void addPayloads();
+    void writeVariant(const QByteArray &payload);
+    void writeScriptValue(const QByteArray &payload);
+};
+
+
+static QByteArray recipe(int steps)
+{
+    QByteArray json("{\"name\":\"Recipe 12\",\"version\":3,\"steps\":[");
+    for (int i = 0; i < steps; i++)
+    {
+        if (i > 0)
+            json.append(',');
+        json.append(QString("{\"id\":%1,\"name\":\"Step %1\",\"temperature\":72.5,\"duration\":120,"
+                            "\"valves\":[true,false,true,false],\"note\":\"hold until stable\"}").arg(i).toUtf8());
+    }
+    json.append("]}");
+    return json;
+}
+
+
+void JsonBench::initTestCase()
+{
+    m_engine = new QQmlEngine(this);
+    QQmlComponent component(m_engine);
+    component.setData("import QtQml 2.0\n"
+                      "QtObject {\n"
+                      "    property var value\n"
+                      "    property int steps: value ? value.steps.length : 0\n"
+                      "}\n", QUrl());
+    m_target = component.create();
+    QVERIFY2(m_target, qPrintable(component.errorString()));
+
+    const QMetaObject *metaObject = m_target->metaObject();
+    m_value = metaObject->property(metaObject->indexOfProperty("value"));
+    QCOMPARE(m_value.userType(), int(QMetaType::QVariant));
+
+    m_converter = new JsonConverter(m_engine, this);
+    m_small = recipe(3);
+    m_large = recipe(250);
+}
+
+
+void JsonBench::cleanupTestCase()
+{
+    delete m_target;
+}
+
+
+void JsonBench::addPayloads()
+{
+    QTest::addColumn<QByteArray>("payload");
+    QTest::newRow("small") << m_small;
+    QTest::newRow("large") << m_large;
+}
+
+
+void JsonBench::writeVariant(const QByteArray &payload)
+{
+    QVariant value;
+    JsonConverter::toVariant(payload.constData(), payload.size(), &value);
+    m_value.write(m_target, value);
+}
+
+
+void JsonBench::writeScriptValue(const QByteArray &payload)
+{
+    QVariant value;
+    m_converter->toScriptValue(payload.constData(), payload.size(), &value);
+    m_value.write(m_target, value);
+}
+
+
+void JsonBench::variantPath_data()
+{
+    addPayloads();
+}
+
+
+void JsonBench::variantPath()
+{
+    QFETCH(QByteArray, payload);
+    QBENCHMARK {
+        writeVariant(payload);
+    }
+}
+
+
+void JsonBench::enginePath_data()
+{
+    addPayloads();
+}
+
+
+void JsonBench::enginePath()
+{
+    QFETCH(QByteArray, payload);
+    QBENCHMARK {
+        writeScriptValue(payload);
+    }
+}
+
+
+void JsonBench::sameResult()
+{
+    QJSValue stringify = m_engine->globalObject().property("JSON").property("stringify");
+
+    writeVariant(m_large);
+    QCOMPARE(m_target->property("steps").toInt(), 250);
+    QString viaVariant = stringify.call(QJSValueList() << m_engine->toScriptValue(m_target->property("value"))).toString();
+
+    writeScriptValue(m_large);
+    QCOMPARE(m_target->property("steps").toInt(), 250);
+    QString viaEngine = stringify.call(QJSValueList() << m_engine->toScriptValue(m_target->property("value"))).toString();
+
+    QCOMPARE(viaEngine, viaVariant);
+
+    QVariant rejected;
+    QVERIFY(!m_converter->toScriptValue("42", 2, &rejected));
+    QVERIFY(!m_converter->toScriptValue("{\"a\":", 5, &rejected));
+}
+
+
+void JsonBench::allocationsPerWrite()
+{
+    AllocCounter::start();
+    writeVariant(m_large);
+    quint64 variant = AllocCounter::stop();
+
+    AllocCounter::start();
+    writeScriptValue(m_large);
+    quint64 engine = AllocCounter::stop();
+
+    qDebug("large payload allocations: variant path %llu, engine path %llu", variant, engine);
+}
+
+
+QTEST_GUILESS_MAIN(JsonBench)
+
+#include "bench_json.moc"
@@ -0,0 +1,15 @@
+TEMPLATE = app
+TARGET = bench_json
+
+QT += testlib qml
+QT -= gui
+CONFIG += c++11 console testcase
+
+include(../common/common.pri)
+
+SOURCES += \
+    bench_json.cpp \
+    ../../jsonconverter.cpp
+
+HEADERS += \
+    ../../jsonconverter.h
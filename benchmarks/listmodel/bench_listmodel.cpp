@@ -0,0 +1,260 @@
+#include <QtTest>
+#include <QQmlEngine>
+#include <QQmlComponent>
+#include "jsonlistmodel.h"
+
+/*
+ * A 500 row alarm list where one row changes per write, shown through an
+ * Instantiator so delegates are really created:
+ *
+ *   fullRebuild   the whole array into a "property var", what parse_json
+ *                 offered so far; every delegate is created again
+ *   rowUpdate     alarms.update={row}
+ *   rowReplace    alarms.replace=[rows], the same 500 rows with one changed
+ *
+ * delegatesPerWrite prints how many delegates each way creates.
+ */
+class ListModelBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void fullRebuild();
+    void rowUpdate();
+    void rowReplace();
+    void delegatesPerWrite();
+    void operations();
+
+private:
+    QQmlEngine *m_engine;
+    QObject *m_root;
+    JsonListModel *m_model;
+    QJSValue m_parse;
+    int m_write;
+
+    QByteArray alarms();
+    QByteArray alarm(int id);
+    void writeArray();
+    void writeUpdate();
+    void writeReplace();
+    int created() const;
+};
+
+
+static const int Rows = 500;
+
+
+QByteArray ListModelBench::alarm(int id)
+{
+    /* The row m_write points at gets a new text on every write */
+    QString text = id == m_write % Rows ? QString("Alarm %1 #%2").arg(id).arg(m_write) : QString("Alarm %1").arg(id);
+    return QString("{\"id\":%1,\"text\":\"%2\",\"active\":%3,\"time\":\"12:00:%4\"}")
+            .arg(id).arg(text).arg(id % 3 == 0 ? "true" : "false").arg(id % 60, 2, 10, QChar('0')).toUtf8();
+}
+
+
+QByteArray ListModelBench::alarms()
+{
+    QByteArray json("[");
+    for (int id = 0; id < Rows; id++)
+    {
+        if (id > 0)
+            json.append(',');
+        json.append(alarm(id));
+    }
+    json.append(']');
+    return json;
+}
+
+
+void ListModelBench::initTestCase()
+{
+    qmlRegisterType<JsonListModel>("Reach.Models", 1, 0, "JsonListModel");
+
+    m_engine = new QQmlEngine(this);
+    QQmlComponent component(m_engine);
+    component.setData("import QtQml 2.2\n"
+                      "import Reach.Models 1.0\n"
+                      "QtObject {\n"
+                      "    property var rows: []\n"
+                      "    property int created: 0\n"
+                      "    property JsonListModel alarms: JsonListModel { roles: [\"id\", \"text\", \"active\", \"time\"] }\n"
+                      "    property Instantiator fromArray: Instantiator {\n"
+                      "        model: rows\n"
+                      "        delegate: QtObject { property string text: modelData.text }\n"
+                      "        onObjectAdded: created++\n"
+                      "    }\n"
+                      "    property Instantiator fromModel: Instantiator {\n"
+                      "        model: alarms\n"
+                      "        delegate: QtObject { property string text: model.text }\n"
+                      "        onObjectAdded: created++\n"
+                      "    }\n"
+                      "}\n", QUrl());
+    m_root = component.create();
+    QVERIFY2(m_root, qPrintable(component.errorString()));
+
+    m_model = qobject_cast<JsonListModel*>(m_root->property("alarms").value<QObject*>());
+    QVERIFY(m_model);
+    m_parse = m_engine->globalObject().property("JSON").property("parse");
+    m_write = 0;
+
+    QString error;
+    QByteArray rows = alarms();
+    QVERIFY2(m_model->apply(JsonListModel::Replace, rows.constData(), rows.size(), &error), qPrintable(error));
+    QCOMPARE(m_model->rowCount(), Rows);
+}
+
+
+void ListModelBench::cleanupTestCase()
+{
+    delete m_root;
+}
+
+
+int ListModelBench::created() const
+{
+    return m_root->property("created").toInt();
+}
+
+
+void ListModelBench::writeArray()
+{
+    m_write++;
+    QByteArray rows = alarms();
+    QJSValue value = m_parse.call(QJSValueList() << QJSValue(QString::fromUtf8(rows)));
+    m_root->setProperty("rows", QVariant::fromValue(value));
+}
+
+
+void ListModelBench::writeUpdate()
+{
+    m_write++;
+    QByteArray row = alarm(m_write % Rows);
+    QString error;
+    m_model->apply(JsonListModel::Update, row.constData(), row.size(), &error);
+}
+
+
+void ListModelBench::writeReplace()
+{
+    m_write++;
+    QByteArray rows = alarms();
+    QString error;
+    m_model->apply(JsonListModel::Replace, rows.constData(), rows.size(), &error);
+}
+
+
+void ListModelBench::fullRebuild()
+{
+    QBENCHMARK {
+        writeArray();
+    }
+}
+
+
+void ListModelBench::rowUpdate()
+{
+    QBENCHMARK {
+        writeUpdate();
+    }
+}
+
+
+void ListModelBench::rowReplace()
+{
+    QBENCHMARK {
+        writeReplace();
+    }
+}
+
+
+void ListModelBench::delegatesPerWrite()
+{
+    int before = created();
+    writeArray();
+    int array = created() - before;
+
+    before = created();
+    writeUpdate();
+    int update = created() - before;
+
+    before = created();
+    writeReplace();
+    int replace = created() - before;
+
+    qDebug("delegates created per write: whole array %d, update %d, replace %d", array, update, replace);
+    QCOMPARE(array, Rows);
+    QCOMPARE(update, 0);
+    QCOMPARE(replace, 0);
+}
+
+
+void ListModelBench::operations()
+{
+    qRegisterMetaType<QVector<int> >("QVector<int>");
+    JsonListModel model;
+    QSignalSpy inserted(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    QSignalSpy removed(&model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+    QSignalSpy moved(&model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)));
+    QSignalSpy changed(&model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+    QSignalSpy reset(&model, SIGNAL(modelReset()));
+    QString error;
+
+    QByteArray data("[{\"id\":\"a\",\"v\":1},{\"id\":\"b\",\"v\":2},{\"id\":\"c\",\"v\":3}]");
+    QVERIFY(model.apply(JsonListModel::Append, data.constData(), data.size(), &error));
+    QCOMPARE(model.roles(), QStringList() << "id" << "v");
+    QCOMPARE(inserted.count(), 1);
+
+    data = "{\"id\":\"a\",\"v\":1}";
+    QVERIFY(!model.apply(JsonListModel::Append, data.constData(), data.size(), &error));
+
+    data = "{\"index\":1,\"rows\":{\"id\":\"x\",\"v\":9}}";
+    QVERIFY(model.apply(JsonListModel::Insert, data.constData(), data.size(), &error));
+    QCOMPARE(model.indexOf("x"), 1);
+    QCOMPARE(model.indexOf("c"), 3);
+
+    data = "{\"id\":\"b\",\"v\":20}";
+    QVERIFY(model.apply(JsonListModel::Update, data.constData(), data.size(), &error));
+    QCOMPARE(changed.count(), 1);
+    QCOMPARE(model.get(2).value("v").toInt(), 20);
+
+    data = "{\"key\":\"c\",\"index\":0}";
+    QVERIFY(model.apply(JsonListModel::Move, data.constData(), data.size(), &error));
+    QCOMPARE(moved.count(), 1);
+    QCOMPARE(model.indexOf("c"), 0);
+    QCOMPARE(model.indexOf("a"), 1);
+
+    data = "x";
+    QVERIFY(model.apply(JsonListModel::Remove, data.constData(), data.size(), &error));
+    QCOMPARE(model.rowCount(), 3);
+
+    /* c a b -> b d c, a goes, d comes, b moves up, c is changed */
+    inserted.clear();
+    removed.clear();
+    moved.clear();
+    changed.clear();
+    data = "[{\"id\":\"b\",\"v\":20},{\"id\":\"d\",\"v\":4},{\"id\":\"c\",\"v\":30}]";
+    QVERIFY2(model.apply(JsonListModel::Replace, data.constData(), data.size(), &error), qPrintable(error));
+    QCOMPARE(removed.count(), 1);
+    QCOMPARE(inserted.count(), 1);
+    QCOMPARE(moved.count(), 1);
+    QCOMPARE(changed.count(), 1);
+    QCOMPARE(reset.count(), 0);
+    QCOMPARE(model.indexOf("b"), 0);
+    QCOMPARE(model.indexOf("d"), 1);
+    QCOMPARE(model.indexOf("c"), 2);
+    QCOMPARE(model.indexOf("a"), -1);
+    QCOMPARE(model.get(2).value("v").toInt(), 30);
+
+    data = "[\"b\",\"c\"]";
+    QVERIFY(model.apply(JsonListModel::Remove, data.constData(), data.size(), &error));
+    QCOMPARE(model.rowCount(), 1);
+    QCOMPARE(model.indexOf("d"), 0);
+}
+
+
+QTEST_GUILESS_MAIN(ListModelBench)
+
+#include "bench_listmodel.moc"
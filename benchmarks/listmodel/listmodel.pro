@@ -0,0 +1,17 @@
+TEMPLATE = app
+TARGET = bench_listmodel
+
+QT += testlib qml
+QT -= gui
+CONFIG += c++11 console testcase
+
+include(../common/common.pri)
+
+SOURCES += \
+    bench_listmodel.cpp \
+    ../../jsonlistmodel.cpp \
+    ../../logging.cpp
+
+HEADERS += \
+    ../../jsonlistmodel.h \
+    ../../logging.h
@@ -0,0 +1,138 @@
+#include <QtTest>
+#include "alloccounter.h"
+#include "messageparser.h"
+
+/*
+ * Compares the QString based inbound parsing that onMessageAvailable used to do
+ * with MessageParser, and reports the heap allocations per message of both.
+ */
+class ParserBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void legacyParse();
+    void byteParse();
+    void allocationsPerMessage();
+
+private:
+    QList<QByteArray> m_lines;
+    QByteArray m_heartbeat;
+    int m_sink;
+
+    void parseLegacy(const QByteArray &ba);
+    void parseBytes(const QByteArray &ba);
+};
+
+
+void ParserBench::initTestCase()
+{
+    m_heartbeat = "pong";
+    m_sink = 0;
+    m_lines << "gauge1.value=42.5\r\n"
+            << "txtStatus.text=Pump running\r\n"
+            << "tank12.level=1034\r\n"
+            << "alarm.visible=true\r\n";
+}
+
+
+void ParserBench::parseLegacy(const QByteArray &ba)
+{
+    /* What MainController::onMessageAvailable did before MessageParser. */
+    QString message(ba);
+    message.replace('\r', "");
+    message.replace('\n', "");
+    if (message.length() == 0)
+        return;
+
+    if (message.trimmed() == QString(m_heartbeat))
+        return;
+
+    if (message.contains("=") && message.contains("."))
+    {
+        int pos = message.indexOf("=");
+        QString value = message.mid(pos + 1, message.length());
+        QString item = message.mid(0, pos);
+        QStringList items = item.split('.');
+        if (value.length() == 0 || items.count() != 2)
+            return;
+
+        /* QMetaProperty::write() converted the string for a real property. */
+        QVariant v(value);
+        v.convert(QMetaType::Double);
+        m_sink += items[0].length() + items[1].length() + v.isValid();
+    }
+}
+
+
+void ParserBench::parseBytes(const QByteArray &ba)
+{
+    const char *data = ba.constData();
+    int length = ba.length();
+    MessageParser::stripLineEnding(&data, &length);
+    if (length == 0)
+        return;
+
+    if (MessageParser::isHeartbeat(data, length, m_heartbeat))
+        return;
+
+    ParsedMessage msgs[MessageParser::MaxAssignments];
+    int count;
+    if (MessageParser::parse(data, length, true, msgs, &count) == MessageParser::Assignment)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            QVariant v = MessageParser::toVariant(msgs[i].value, msgs[i].valueLength, QMetaType::Double);
+            m_sink += msgs[i].objectLength + msgs[i].propertyLength + v.isValid();
+        }
+    }
+}
+
+
+void ParserBench::legacyParse()
+{
+    QBENCHMARK {
+        foreach (const QByteArray &line, m_lines)
+            parseLegacy(line);
+    }
+}
+
+
+void ParserBench::byteParse()
+{
+    QBENCHMARK {
+        foreach (const QByteArray &line, m_lines)
+            parseBytes(line);
+    }
+}
+
+
+void ParserBench::allocationsPerMessage()
+{
+    const int rounds = 10000;
+    int messages = rounds * m_lines.count();
+
+    AllocCounter::start();
+    for (int i = 0; i < rounds; i++)
+        foreach (const QByteArray &line, m_lines)
+            parseLegacy(line);
+    quint64 legacy = AllocCounter::stop();
+
+    AllocCounter::start();
+    for (int i = 0; i < rounds; i++)
+        foreach (const QByteArray &line, m_lines)
+            parseBytes(line);
+    quint64 bytes = AllocCounter::stop();
+
+    qDebug("allocations per message: legacy %.2f, MessageParser %.2f",
+           double(legacy) / messages, double(bytes) / messages);
+
+    /* Only values that are not numbers still allocate, for their QString. */
+    QVERIFY(bytes < legacy);
+}
+
+
+QTEST_APPLESS_MAIN(ParserBench)
+
+#include "bench_parser.moc"
@@ -0,0 +1,15 @@
+TEMPLATE = app
+TARGET = bench_parser
+
+QT += testlib
+QT -= gui
+CONFIG += c++11 console testcase
+
+include(../common/common.pri)
+
+SOURCES += \
+    bench_parser.cpp \
+    ../../messageparser.cpp
+
+HEADERS += \
+    ../../messageparser.h
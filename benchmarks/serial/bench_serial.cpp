@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QScopedPointer>
+#include "serialserver.h"
+
+/*
+ * SerialServer latency under the serial_port_servers tuning profiles and
+ * with the QSerialPort and native backends, on a pseudo terminal so no
+ * hardware is needed:
+ *
+ *   bench_serial --messages 2000 --burst 1000
+ *
+ * latency  one line written to the pty master until MessageAvailable
+ * burst    --burst lines written at once until the last MessageAvailable
+ *
+ * A pty has no UART driver, low_latency is refused (and logged) and the
+ * numbers show the tty layer and QSerialPort only. A profile that stalls is
+ * reported as such; VMIN above 1 without a VTIME would, the settings refuse
+ * it. Run it on the target against a real port looped back to see the
+ * driver's share.
+ */
+
+struct Profile {
+    const char *name;
+    QJsonObject settings;
+};
+
+
+static qint64 percentile(QVector<qint64> &sorted, double p)
+{
+    if (sorted.isEmpty())
+        return 0;
+    int index = qMin(sorted.size() - 1, int(p * sorted.size()));
+    return sorted.at(index);
+}
+
+
+static int openPty(QString *slavePath)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0)
+        return -1;
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    *slavePath = QString::fromLocal8Bit(ptsname(master));
+    return master;
+}
+
+
+static bool waitFor(const int *value, int target, int timeout)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (*value < target)
+    {
+        if (timer.elapsed() > timeout)
+            return false;
+        QCoreApplication::processEvents();
+    }
+    return true;
+}
+
+
+/* The pty buffer is small, keep the viewer side reading while the rest is written */
+static bool writeAll(int master, const QByteArray &data)
+{
+    int written = 0;
+    QElapsedTimer timer;
+    timer.start();
+    while (written < data.size())
+    {
+        ssize_t n = ::write(master, data.constData() + written, data.size() - written);
+        if (n > 0)
+            written += n;
+        else if (n < 0 && errno != EAGAIN)
+            return false;
+        else if (timer.elapsed() > 5000)
+            return false;
+        else
+            QCoreApplication::processEvents();
+    }
+    return true;
+}
+
+
+static bool run(const Profile &profile, int messages, int burst)
+{
+    QString slavePath;
+    int master = openPty(&slavePath);
+    if (master < 0)
+    {
+        fprintf(stderr, "unable to open a pty\n");
+        return false;
+    }
+
+    QJsonObject json = profile.settings;
+    json.insert("port_name", "bench");
+    json.insert("linux_vm_port", slavePath);
+    json.insert("linux_target_port", slavePath);
+    json.insert("translate", false);
+
+    SerialServerSetting setting;
+    if (!setting.setMembers(json))
+    {
+        fprintf(stderr, "%s: %s\n", profile.name, qPrintable(setting.error()));
+        ::close(master);
+        return false;
+    }
+
+    /* Deleted before the master is closed, a hangup would be logged as a port error */
+    QScopedPointer<SerialServer> server(new SerialServer(setting));
+    QElapsedTimer clock;
+    clock.start();
+    qint64 receivedAt = -1;
+    int received = 0;
+    QObject::connect(server.data(), &SerialServer::MessageAvailable, [&](QByteArray, bool, bool, QString) {
+        receivedAt = clock.nsecsElapsed();
+        received++;
+    });
+
+    if (!server->Start())
+    {
+        ::close(master);
+        return false;
+    }
+
+    QByteArray line("obj.value=1234567\r\n");
+    QVector<qint64> latency;
+    latency.reserve(messages);
+    bool stalled = false;
+
+    for (int i = 0; i < messages && !stalled; i++)
+    {
+        int before = received;
+        qint64 sent = clock.nsecsElapsed();
+        if (!writeAll(master, line))
+            break;
+        stalled = !waitFor(&received, before + 1, 1000);
+        if (!stalled)
+            latency.append(receivedAt - sent);
+    }
+
+    std::sort(latency.begin(), latency.end());
+    if (stalled)
+        printf("%-14s latency stalled after %d messages", profile.name, latency.size());
+    else
+        printf("%-14s latency p50 %7.2f us p99 %7.2f us", profile.name,
+               percentile(latency, 0.5) / 1e3, percentile(latency, 0.99) / 1e3);
+
+    /* A line a stalled profile left in the tty comes out with the burst, one extra message */
+    received = 0;
+    QByteArray data = line.repeated(burst);
+    qint64 start = clock.nsecsElapsed();
+    if (writeAll(master, data) && waitFor(&received, burst, 5000))
+        printf("   burst %8.0f ns/message\n", double(receivedAt - start) / burst);
+    else
+        printf("   burst stalled at %d of %d\n", received, burst);
+
+    server.reset();
+    ::close(master);
+    return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Serial line latency per tty tuning profile, on a pty");
+    parser.addHelpOption();
+    QCommandLineOption messagesOption("messages", "Single line messages per profile.", "n", "2000");
+    QCommandLineOption burstOption("burst", "Lines written at once per profile.", "n", "1000");
+    parser.addOption(messagesOption);
+    parser.addOption(burstOption);
+    parser.process(app);
+
+    int messages = qMax(1, parser.value(messagesOption).toInt());
+    int burst = qMax(1, parser.value(burstOption).toInt());
+
+    QList<Profile> profiles;
+    Profile profile;
+
+    profile.name = "default";
+    profiles << profile;
+
+    profile.name = "low_latency";
+    profile.settings = QJsonObject();
+    profile.settings.insert("low_latency", true);
+    profile.settings.insert("vmin", 1);
+    profile.settings.insert("vtime", 0);
+    profiles << profile;
+
+    profile.name = "read_buffer_64";
+    profile.settings = QJsonObject();
+    profile.settings.insert("read_buffer_size", 64);
+    profiles << profile;
+
+    profile.name = "native";
+    profile.settings = QJsonObject();
+    profile.settings.insert("backend", QString("native"));
+    profiles << profile;
+
+    foreach (const Profile &p, profiles)
+    {
+        if (!run(p, messages, burst))
+            return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include "stringserver.h"
+
+/*
+ * StringServer load benchmark.
+ *
+ * Connects N loopback clients to a StringServer and has them take turns
+ * writing one line each, waiting for every line to come out of
+ * MessageAvailable before the next round. Each readyRead then carries a
+ * single message, so the time per message shows whether handling one event
+ * depends on how many other clients are connected:
+ *
+ *   bench_tcpload --clients 1,10,100,250 --messages 20000
+ *
+ * Client side writes are included and cost the same for every N. Keep N
+ * below half of "ulimit -n", both ends of each connection are in this process.
+ */
+
+class MessageCounter : public QObject
+{
+    Q_OBJECT
+public:
+    MessageCounter() : count(0) {}
+
+    int count;
+
+public slots:
+    void onMessageAvailable(QByteArray ba, bool parseJson, bool translate, QString translateID)
+    {
+        Q_UNUSED(ba);
+        Q_UNUSED(parseJson);
+        Q_UNUSED(translate);
+        Q_UNUSED(translateID);
+        count++;
+    }
+};
+
+
+static bool waitFor(const int *value, int target, int timeout)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (*value < target)
+    {
+        if (timer.elapsed() > timeout)
+            return false;
+        QCoreApplication::processEvents();
+    }
+    return true;
+}
+
+
+/* Returns nanoseconds per message, -1 on failure */
+static double run(int clients, int messages)
+{
+    StringServer server(0, 0);
+    MessageCounter counter;
+    QObject::connect(&server, SIGNAL(MessageAvailable(QByteArray, bool, bool, QString)),
+                     &counter, SLOT(onMessageAvailable(QByteArray, bool, bool, QString)));
+    if (!server.Start())
+        return -1;
+
+    int connected = 0;
+    QObject::connect(&server, &StringServer::ClientConnected, [&connected]() { connected++; });
+
+    QList<QTcpSocket*> sockets;
+    for (int i = 0; i < clients; i++)
+    {
+        QTcpSocket *socket = new QTcpSocket;
+        socket->connectToHost(QHostAddress::LocalHost, server.getPort());
+        if (!socket->waitForConnected(5000))
+        {
+            delete socket;
+            qDeleteAll(sockets);
+            return -1;
+        }
+        sockets.append(socket);
+    }
+
+    /* The server side sockets exist once the pending connections are handled */
+    if (!waitFor(&connected, clients, 5000))
+    {
+        qDeleteAll(sockets);
+        return -1;
+    }
+
+    QByteArray line("obj.value=123\r\n");
+    int rounds = qMax(1, messages / clients);
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int round = 0; round < rounds; round++)
+    {
+        foreach (QTcpSocket *socket, sockets)
+        {
+            socket->write(line);
+            socket->flush();
+        }
+
+        if (!waitFor(&counter.count, (round + 1) * clients, 5000))
+        {
+            qDeleteAll(sockets);
+            return -1;
+        }
+    }
+    qint64 elapsed = timer.nsecsElapsed();
+
+    qDeleteAll(sockets);
+    return double(elapsed) / (rounds * clients);
+}
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("StringServer load benchmark");
+    parser.addHelpOption();
+    QCommandLineOption clientsOption("clients", "Comma separated client counts.", "list", "1,10,100,250");
+    QCommandLineOption messagesOption("messages", "Messages per client count.", "n", "20000");
+    parser.addOption(clientsOption);
+    parser.addOption(messagesOption);
+    parser.process(app);
+
+    int messages = qMax(1, parser.value(messagesOption).toInt());
+
+    printf("%8s %14s %12s\n", "clients", "ns/message", "msg/s");
+    foreach (const QString &value, parser.value(clientsOption).split(','))
+    {
+        int clients = qMax(1, value.toInt());
+        double ns = run(clients, messages);
+        if (ns < 0)
+        {
+            fprintf(stderr, "run with %d clients failed\n", clients);
+            return 1;
+        }
+        printf("%8d %14.0f %12.0f\n", clients, ns, 1e9 / ns);
+    }
+
+    return 0;
+}
+
+#include "bench_tcpload.moc"
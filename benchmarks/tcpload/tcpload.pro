@@ -0,0 +1,11 @@
+TEMPLATE = app
+TARGET = bench_tcpload
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+include(../common/common.pri)
+include(../common/viewer.pri)
+
+SOURCES += \
+    bench_tcpload.cpp
@@ -0,0 +1,232 @@
+#include <QtTest>
+#include "translationrules.h"
+
+/*
+ * Compares the hash-of-"origin:key" lookup that Translator used to do with
+ * the compiled TranslationRules, for a few rule counts. One message in ten
+ * has no rule. wildcardTranslate replaces the whole tank family with one
+ * wildcard rule.
+ */
+class LegacyRules
+{
+public:
+    void addLine(const QString &line)
+    {
+        QStringList list = line.split(",");
+        QStringList originKey = list[0].split(":");
+        QStringList markerMessage = list[1].split(":");
+        QString key = originKey[1];
+        key.replace("%d", "");
+        m_mcuHash.insert(originKey[0] + ":" + key, markerMessage[1]);
+    }
+
+    /* What Translator::translateMCUMessage did before TranslationRules. */
+    QString translateMCUMessage(QString origin, QString message)
+    {
+        if (message.isEmpty() || message.isNull())
+            return "";
+
+        QString key = origin + ":" + message.mid(0, message.indexOf("=")+1);
+        QString value = message.mid(message.indexOf("=")+1, message.length());
+
+        if (m_mcuHash.contains(key))
+        {
+            QString message = m_mcuHash.value(key);
+            if (message.indexOf("%d") > 0)
+                message = message.replace("%d", value);
+            else if (message.indexOf("%s") > 0)
+                message = message.replace("%s", value);
+            return message;
+        }
+        else if (m_mcuDefaultMessages.contains(origin))
+            return message;
+
+        return "";
+    }
+
+private:
+    QHash<QString, QString> m_mcuHash;
+    QHash<QString, QString> m_mcuDefaultMessages;
+};
+
+
+class TranslatorBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void legacyTranslate_data();
+    void legacyTranslate();
+    void compiledTranslate_data();
+    void compiledTranslate();
+    void wildcardTranslate_data();
+    void wildcardTranslate();
+    void sameOutput();
+    void wildcardSameOutput();
+
+private:
+    QStringList rules(int count) const;
+    QStringList messages(int count) const;
+    void addRuleCounts();
+
+    QString m_origin;
+    int m_sink;
+};
+
+
+void TranslatorBench::initTestCase()
+{
+    m_origin = "M1";
+    m_sink = 0;
+}
+
+
+QStringList TranslatorBench::rules(int count) const
+{
+    QStringList lines;
+    for (int i = 0; i < count; i++)
+        lines << QString("M1:tank%1.level=%d,T:tank%1.value=%d").arg(i);
+    return lines;
+}
+
+
+QStringList TranslatorBench::messages(int count) const
+{
+    QStringList lines;
+    for (int i = 0; i < 64; i++)
+    {
+        if (i % 10 == 9)
+            lines << QString("pump%1.state=%2").arg(i).arg(i);
+        else
+            lines << QString("tank%1.level=%2").arg((i * 7919) % count).arg(i * 13);
+    }
+    return lines;
+}
+
+
+void TranslatorBench::addRuleCounts()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("50 rules") << 50;
+    QTest::newRow("500 rules") << 500;
+    QTest::newRow("10000 rules") << 10000;
+}
+
+
+void TranslatorBench::legacyTranslate_data()
+{
+    addRuleCounts();
+}
+
+
+void TranslatorBench::legacyTranslate()
+{
+    QFETCH(int, count);
+    LegacyRules legacy;
+    foreach (const QString &line, rules(count))
+        legacy.addLine(line);
+    QStringList lines = messages(count);
+
+    QBENCHMARK {
+        foreach (const QString &line, lines)
+            m_sink += legacy.translateMCUMessage(m_origin, line).length();
+    }
+}
+
+
+void TranslatorBench::compiledTranslate_data()
+{
+    addRuleCounts();
+}
+
+
+void TranslatorBench::compiledTranslate()
+{
+    QFETCH(int, count);
+    TranslationRules compiled;
+    int i = 1;
+    foreach (const QString &line, rules(count))
+        compiled.addLine(line, i++);
+    QStringList lines = messages(count);
+    QString out;
+
+    QBENCHMARK {
+        foreach (const QString &line, lines)
+        {
+            compiled.translate(m_origin, line, &out);
+            m_sink += out.length();
+        }
+    }
+}
+
+
+void TranslatorBench::wildcardTranslate_data()
+{
+    addRuleCounts();
+}
+
+
+void TranslatorBench::wildcardTranslate()
+{
+    QFETCH(int, count);
+    TranslationRules wildcard;
+    wildcard.addLine("M1:tank*.level=%d,T:tank$1.value=%d", 1);
+    QStringList lines = messages(count);
+    QString out;
+
+    QBENCHMARK {
+        foreach (const QString &line, lines)
+        {
+            wildcard.translate(m_origin, line, &out);
+            m_sink += out.length();
+        }
+    }
+}
+
+
+void TranslatorBench::sameOutput()
+{
+    LegacyRules legacy;
+    TranslationRules compiled;
+    int i = 1;
+    foreach (const QString &line, rules(500))
+    {
+        legacy.addLine(line);
+        compiled.addLine(line, i++);
+    }
+
+    foreach (const QString &line, messages(500))
+    {
+        QString out;
+        if (compiled.translate(m_origin, line, &out) != TranslationRules::Translated)
+            out = "";
+        QCOMPARE(out, legacy.translateMCUMessage(m_origin, line));
+    }
+}
+
+
+
+void TranslatorBench::wildcardSameOutput()
+{
+    TranslationRules exact;
+    TranslationRules wildcard;
+    int i = 1;
+    foreach (const QString &line, rules(500))
+        exact.addLine(line, i++);
+    wildcard.addLine("M1:tank*.level=%d,T:tank$1.value=%d", 1);
+
+    foreach (const QString &line, messages(500))
+    {
+        QString exactOut;
+        QString wildcardOut;
+        QCOMPARE(wildcard.translate(m_origin, line, &wildcardOut), exact.translate(m_origin, line, &exactOut));
+        if (exactOut.length() > 0)
+            QCOMPARE(wildcardOut, exactOut);
+    }
+}
+
+
+QTEST_APPLESS_MAIN(TranslatorBench)
+
+#include "bench_translator.moc"
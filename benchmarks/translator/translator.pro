@@ -0,0 +1,21 @@
+TEMPLATE = app
+TARGET = bench_translator
+
+QT += testlib
+QT -= gui
+CONFIG += c++11 console testcase
+
+include(../common/common.pri)
+
+SOURCES += \
+    bench_translator.cpp \
+    ../../translationrules.cpp \
+    ../../ruleimage.cpp \
+    ../../wildcardrules.cpp \
+    ../../logging.cpp
+
+HEADERS += \
+    ../../translationrules.h \
+    ../../ruleimage.h \
+    ../../wildcardrules.h \
+    ../../logging.h
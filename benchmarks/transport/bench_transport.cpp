@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <stdio.h>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QTcpSocket>
+#include <QLocalSocket>
+#include <QHostAddress>
+#include "stringserver.h"
+#include "localserver.h"
+#include "shmserver.h"
+
+/*
+ * Latency of StringServer on loopback TCP against LocalServer on a unix
+ * domain socket and ShmServer on a shared memory ring, with a single client:
+ *
+ *   bench_transport --messages 20000
+ *
+ * inbound     the client writes a line until the server emits MessageAvailable
+ * round trip  the same plus the server sending a reply line (through its
+ *             batched Send()) until the client has read it, not for shm
+ *             which has no way back
+ *
+ * Both ends run in this process on one event loop, the numbers compare the
+ * transports, they are not the absolute latency seen by another process.
+ */
+
+class Echo : public QObject
+{
+    Q_OBJECT
+public:
+    Echo(QObject *server, const QElapsedTimer *clock) : receivedAt(-1), m_server(server), m_clock(clock) {}
+
+    qint64 receivedAt;
+
+public slots:
+    void onMessageAvailable(QByteArray ba, bool parseJson, bool translate, QString translateID)
+    {
+        Q_UNUSED(ba);
+        Q_UNUSED(parseJson);
+        Q_UNUSED(translate);
+        Q_UNUSED(translateID);
+        receivedAt = m_clock->nsecsElapsed();
+        QMetaObject::invokeMethod(m_server, "Send", Qt::DirectConnection, Q_ARG(QString, QString("LUOK")));
+    }
+
+private:
+    QObject *m_server;
+    const QElapsedTimer *m_clock;
+};
+
+
+static qint64 percentile(QVector<qint64> &sorted, double p)
+{
+    if (sorted.isEmpty())
+        return 0;
+    int index = qMin(sorted.size() - 1, int(p * sorted.size()));
+    return sorted.at(index);
+}
+
+
+/* The server side socket exists once the pending connection is handled */
+template <class Server>
+static bool waitForClient(Server *server)
+{
+    bool connected = false;
+    QObject::connect(server, &Server::ClientConnected, [&connected]() { connected = true; });
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!connected && timer.elapsed() < 5000)
+        QCoreApplication::processEvents();
+    return connected;
+}
+
+
+static bool measure(const char *name, QObject *server, QIODevice *client, int messages)
+{
+    QElapsedTimer clock;
+    clock.start();
+    Echo echo(server, &clock);
+    QObject::connect(server, SIGNAL(MessageAvailable(QByteArray, bool, bool, QString)),
+                     &echo, SLOT(onMessageAvailable(QByteArray, bool, bool, QString)));
+
+    QVector<qint64> inbound;
+    QVector<qint64> roundTrip;
+    inbound.reserve(messages);
+    roundTrip.reserve(messages);
+    QByteArray line("obj.value=123\r\n");
+
+    for (int i = 0; i < messages; i++)
+    {
+        echo.receivedAt = -1;
+        qint64 sent = clock.nsecsElapsed();
+        client->write(line);
+
+        QElapsedTimer timeout;
+        timeout.start();
+        while (!client->canReadLine())
+        {
+            if (timeout.elapsed() > 5000)
+            {
+                fprintf(stderr, "%s: no reply to message %d\n", name, i);
+                return false;
+            }
+            QCoreApplication::processEvents();
+        }
+        qint64 replied = clock.nsecsElapsed();
+        client->readLine();
+
+        inbound.append(echo.receivedAt - sent);
+        roundTrip.append(replied - sent);
+    }
+
+    std::sort(inbound.begin(), inbound.end());
+    std::sort(roundTrip.begin(), roundTrip.end());
+    printf("%-6s inbound p50 %7.2f us p99 %7.2f us   round trip p50 %7.2f us p99 %7.2f us\n", name,
+           percentile(inbound, 0.5) / 1e3, percentile(inbound, 0.99) / 1e3,
+           percentile(roundTrip, 0.5) / 1e3, percentile(roundTrip, 0.99) / 1e3);
+    return true;
+}
+
+
+/* The producer writes from this thread, ShmServer's waiter thread wakes and posts the drain */
+static bool measureShm(ShmServer *server, shmring *producer, int messages)
+{
+    QElapsedTimer clock;
+    clock.start();
+    qint64 receivedAt = -1;
+    QObject::connect(server, &ShmServer::MessageAvailable, [&receivedAt, &clock](QByteArray, bool, bool, QString) {
+        receivedAt = clock.nsecsElapsed();
+    });
+
+    QVector<qint64> inbound;
+    inbound.reserve(messages);
+
+    for (int i = 0; i < messages; i++)
+    {
+        receivedAt = -1;
+        qint64 sent = clock.nsecsElapsed();
+        if (shmring_write_string(producer, "obj.value=123") != SHMRING_OK)
+        {
+            fprintf(stderr, "shm: write of message %d failed\n", i);
+            return false;
+        }
+
+        QElapsedTimer timeout;
+        timeout.start();
+        while (receivedAt < 0)
+        {
+            if (timeout.elapsed() > 5000)
+            {
+                fprintf(stderr, "shm: message %d not received\n", i);
+                return false;
+            }
+            QCoreApplication::processEvents();
+        }
+
+        inbound.append(receivedAt - sent);
+    }
+
+    std::sort(inbound.begin(), inbound.end());
+    printf("%-6s inbound p50 %7.2f us p99 %7.2f us\n", "shm",
+           percentile(inbound, 0.5) / 1e3, percentile(inbound, 0.99) / 1e3);
+    return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("TCP loopback against unix domain socket and shared memory latency");
+    parser.addHelpOption();
+    QCommandLineOption messagesOption("messages", "Messages per transport.", "n", "20000");
+    parser.addOption(messagesOption);
+    parser.process(app);
+
+    int messages = qMax(1, parser.value(messagesOption).toInt());
+
+    StringServer tcpServer(0, 0);
+    if (!tcpServer.Start())
+        return 1;
+    QTcpSocket tcpClient;
+    tcpClient.connectToHost(QHostAddress::LocalHost, tcpServer.getPort());
+    if (!tcpClient.waitForConnected(5000) || !waitForClient(&tcpServer))
+    {
+        fprintf(stderr, "unable to connect to the TCP server\n");
+        return 1;
+    }
+    tcpClient.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+    QTemporaryDir dir;
+    LocalServer localServer(0, dir.path() + "/bench.sock");
+    if (!dir.isValid() || !localServer.Start())
+        return 1;
+    QLocalSocket localClient;
+    localClient.connectToServer(localServer.getPath());
+    if (!localClient.waitForConnected(5000) || !waitForClient(&localServer))
+    {
+        fprintf(stderr, "unable to connect to the unix socket server\n");
+        return 1;
+    }
+
+    QString shmName = QString("/bench-transport-%1").arg(QCoreApplication::applicationPid());
+    ShmServer shmServer(0, shmName);
+    if (!shmServer.Start())
+        return 1;
+    shmring *producer = shmring_open(shmName.toLocal8Bit().constData());
+    if (!producer)
+    {
+        fprintf(stderr, "unable to open the shared memory ring\n");
+        return 1;
+    }
+
+    bool ok = measure("tcp", &tcpServer, &tcpClient, messages)
+            && measure("unix", &localServer, &localClient, messages)
+            && measureShm(&shmServer, producer, messages);
+    shmring_close(producer);
+    if (!ok)
+        return 1;
+
+    return 0;
+}
+
+#include "bench_transport.moc"
@@ -0,0 +1,187 @@
+#include <string.h>
+#include "framecodec.h"
+
+/* length + crc */
+#define FRAME_OVERHEAD 4
+
+FrameCodec::FrameCodec(int maxFrameSize) :
+    m_discarding(false)
+  ,m_framesReceived(0)
+  ,m_frameErrors(0)
+  ,m_resyncs(0)
+  ,m_droppedBytes(0)
+{
+    /* COBS adds one byte every 254 bytes plus the leading code byte. */
+    int bodySize = maxFrameSize + FRAME_OVERHEAD;
+    m_maxEncodedSize = bodySize + bodySize / 254 + 1;
+    m_buffer.reserve(m_maxEncodedSize);
+    m_decoded.reserve(m_maxEncodedSize);
+    /* Both buffers keep their capacity, resize(0) is used to empty them. */
+}
+
+
+QByteArray FrameCodec::encode(const QByteArray &payload)
+{
+    /* The length field is 16 bit, a cut off payload would still get a valid CRC */
+    if (payload.size() > 0xFFFF)
+        return QByteArray();
+    int payloadSize = payload.size();
+
+    QByteArray body;
+    body.reserve(payloadSize + FRAME_OVERHEAD);
+    body.append(char((payloadSize >> 8) & 0xFF));
+    body.append(char(payloadSize & 0xFF));
+    body.append(payload.constData(), payloadSize);
+
+    quint16 crc = qChecksum(body.constData(), body.size());
+    body.append(char(crc & 0xFF));
+    body.append(char((crc >> 8) & 0xFF));
+
+    /* COBS encode, code bytes hold the distance to the next zero. */
+    QByteArray frame;
+    frame.resize(body.size() + body.size() / 254 + 2);
+    char *out = frame.data();
+    int codeIndex = 0;
+    int outIndex = 1;
+    uchar code = 1;
+
+    for (int i = 0; i < body.size(); i++)
+    {
+        if (body.at(i) == 0)
+        {
+            out[codeIndex] = char(code);
+            codeIndex = outIndex++;
+            code = 1;
+        }
+        else
+        {
+            out[outIndex++] = body.at(i);
+            if (++code == 0xFF)
+            {
+                out[codeIndex] = char(code);
+                codeIndex = outIndex++;
+                code = 1;
+            }
+        }
+    }
+
+    out[codeIndex] = char(code);
+    out[outIndex++] = 0;
+    frame.resize(outIndex);
+    return frame;
+}
+
+
+void FrameCodec::decode(const char *data, int length, QList<QByteArray> *frames)
+{
+    const char *end = data + length;
+
+    while (data < end)
+    {
+        const char *delimiter = static_cast<const char*>(memchr(data, 0, end - data));
+        const char *segmentEnd = delimiter ? delimiter : end;
+
+        if (!m_discarding)
+        {
+            m_buffer.append(data, segmentEnd - data);
+
+            /* Too long for a frame, drop it and skip to the next delimiter. */
+            if (m_buffer.size() > m_maxEncodedSize)
+            {
+                m_droppedBytes.fetchAndAddRelaxed(m_buffer.size());
+                m_resyncs.fetchAndAddRelaxed(1);
+                m_buffer.resize(0);
+                m_discarding = true;
+            }
+        }
+        else
+            m_droppedBytes.fetchAndAddRelaxed(segmentEnd - data);
+
+        if (!delimiter)
+            break;
+
+        /* Empty frames are allowed, senders may use a 0x00 to flush the line. */
+        if (!m_discarding && !m_buffer.isEmpty())
+        {
+            QByteArray payload;
+            if (decodeFrame(&payload))
+            {
+                m_framesReceived.fetchAndAddRelaxed(1);
+                frames->append(payload);
+            }
+            else
+            {
+                m_frameErrors.fetchAndAddRelaxed(1);
+                m_droppedBytes.fetchAndAddRelaxed(m_buffer.size());
+            }
+        }
+
+        m_buffer.resize(0);
+        m_discarding = false;
+        data = delimiter + 1;
+    }
+}
+
+
+bool FrameCodec::decodeFrame(QByteArray *payload)
+{
+    const uchar *in = reinterpret_cast<const uchar*>(m_buffer.constData());
+    int length = m_buffer.size();
+
+    m_decoded.resize(length);
+    uchar *out = reinterpret_cast<uchar*>(m_decoded.data());
+    int outLength = 0;
+    int i = 0;
+
+    while (i < length)
+    {
+        int code = in[i++];
+        if (i + code - 1 > length)
+            return false;
+
+        memcpy(out + outLength, in + i, code - 1);
+        outLength += code - 1;
+        i += code - 1;
+
+        if (code < 0xFF && i < length)
+            out[outLength++] = 0;
+    }
+
+    if (outLength < FRAME_OVERHEAD)
+        return false;
+
+    int payloadSize = (out[0] << 8) | out[1];
+    if (payloadSize != outLength - FRAME_OVERHEAD)
+        return false;
+
+    quint16 crc = out[outLength - 2] | (out[outLength - 1] << 8);
+    if (crc != qChecksum(reinterpret_cast<const char*>(out), outLength - 2))
+        return false;
+
+    *payload = QByteArray(reinterpret_cast<const char*>(out) + 2, payloadSize);
+    return true;
+}
+
+
+int FrameCodec::framesReceived() const
+{
+    return m_framesReceived.loadAcquire();
+}
+
+
+int FrameCodec::frameErrors() const
+{
+    return m_frameErrors.loadAcquire();
+}
+
+
+int FrameCodec::resyncs() const
+{
+    return m_resyncs.loadAcquire();
+}
+
+
+int FrameCodec::droppedBytes() const
+{
+    return m_droppedBytes.loadAcquire();
+}
@@ -0,0 +1,46 @@
+#ifndef FRAMECODEC_H
+#define FRAMECODEC_H
+
+#include <QByteArray>
+#include <QList>
+#include <QAtomicInt>
+
+/*
+ * Binary framing for serial links.
+ *
+ * A frame on the wire is COBS(length, payload, crc) followed by a 0x00
+ * delimiter, where length is the payload size as 16 bit big endian and crc
+ * is the CRC-16/X-25 (qChecksum) of length and payload, sent low byte first.
+ * COBS removes every 0x00 from the frame, so the decoder finds the next frame
+ * boundary after line noise by looking for the next 0x00.
+ *
+ * Payloads may contain any byte including newlines. encode() returns an empty
+ * frame for a payload longer than 65535 bytes.
+ */
+class FrameCodec
+{
+public:
+    explicit FrameCodec(int maxFrameSize = 4096);
+
+    static QByteArray encode(const QByteArray &payload);
+    void decode(const char *data, int length, QList<QByteArray> *frames);
+
+    int framesReceived() const;
+    int frameErrors() const;
+    int resyncs() const;
+    int droppedBytes() const;
+
+private:
+    bool decodeFrame(QByteArray *payload);
+
+    int m_maxEncodedSize;
+    QByteArray m_buffer;
+    QByteArray m_decoded;
+    bool m_discarding;
+    QAtomicInt m_framesReceived;
+    QAtomicInt m_frameErrors;
+    QAtomicInt m_resyncs;
+    QAtomicInt m_droppedBytes;
+};
+
+#endif // FRAMECODEC_H
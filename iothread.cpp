@@ -0,0 +1,95 @@
+#include <QDebug>
+#include "iothread.h"
+#include "logging.h"
+
+IoThread::IoThread(QObject *server, int ringSize, QObject *parent) :
+    QObject(parent)
+  ,m_server(server)
+  ,m_ring(ringSize)
+  ,m_drainPending(0)
+  ,m_overflowCount(0)
+{
+    const QMetaObject *metaObject = m_server->metaObject();
+    m_dispatch = metaObject->method(metaObject->indexOfMethod("dispatchMessage(QByteArray)"));
+
+    m_thread.setObjectName(QString("io-%1").arg(metaObject->className()));
+    m_overflows = Metrics::instance()->counter("qmlviewer_io_ring_overflows_total", "Messages dropped because an I/O ring was full.",
+                                               Metrics::label("thread", m_thread.objectName()));
+    connect(&m_thread, SIGNAL(finished()), m_server, SLOT(deleteLater()));
+}
+
+
+IoThread::~IoThread()
+{
+    if (m_thread.isRunning())
+    {
+        /* Deferred deletes are processed when the thread finishes, that deletes the server. */
+        m_thread.quit();
+        m_thread.wait();
+    }
+    else
+        delete m_server;
+}
+
+
+bool IoThread::start()
+{
+    bool started = false;
+
+    m_server->moveToThread(&m_thread);
+    m_thread.start();
+    QMetaObject::invokeMethod(m_server, "Start", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, started));
+
+    qCInfo(lcMain) << "[QMLVIEWER]" << m_thread.objectName() << (started ? "started" : "failed to start");
+    return started;
+}
+
+
+bool IoThread::post(const QByteArray &ba)
+{
+    /* Called on the I/O thread */
+    if (!m_ring.push(ba))
+    {
+        int overflows = m_overflowCount.fetchAndAddRelaxed(1) + 1;
+        m_overflows->add();
+        /* Don't flood the log, report 1, 2, 4, 8... dropped messages */
+        if ((overflows & (overflows - 1)) == 0)
+            qCWarning(lcMain) << "[QMLVIEWER]" << m_thread.objectName() << "ring full, messages dropped:" << overflows;
+        return false;
+    }
+
+    /* Only one drain is queued at a time, it picks up everything pushed until it runs. */
+    if (m_drainPending.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(this, "drain", Qt::QueuedConnection);
+
+    return true;
+}
+
+
+QObject *IoThread::server() const
+{
+    return m_server;
+}
+
+
+int IoThread::overflowCount() const
+{
+    return m_overflowCount.loadAcquire();
+}
+
+
+int IoThread::pendingCount() const
+{
+    return m_ring.count();
+}
+
+
+void IoThread::drain()
+{
+    /* Reset before popping, anything pushed after this point queues a new drain. */
+    m_drainPending.storeRelease(0);
+
+    QByteArray ba;
+    while (m_ring.pop(&ba))
+        m_dispatch.invoke(m_server, Qt::DirectConnection, Q_ARG(QByteArray, ba));
+}
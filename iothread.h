@@ -0,0 +1,48 @@
+#ifndef IOTHREAD_H
+#define IOTHREAD_H
+
+#include <QObject>
+#include <QThread>
+#include <QAtomicInt>
+#include <QMetaMethod>
+#include "messagering.h"
+#include "metrics.h"
+
+/*
+ * Runs a SerialServer or StringServer on its own thread.
+ *
+ * The server is moved to the thread and posts each framed message into a
+ * MessageRing. The ring is drained on the thread the IoThread lives on (the
+ * GUI thread) by calling the server's dispatchMessage(), which emits
+ * MessageAvailable from there, so MainController sees the same signal it
+ * always did. When the ring is full the message is dropped and counted.
+ *
+ * The server is deleted when the thread finishes.
+ */
+class IoThread : public QObject
+{
+    Q_OBJECT
+public:
+    explicit IoThread(QObject *server, int ringSize, QObject *parent = 0);
+    ~IoThread();
+
+    bool start();
+    bool post(const QByteArray &ba);
+    QObject *server() const;
+    int overflowCount() const;
+    int pendingCount() const;
+
+private slots:
+    void drain();
+
+private:
+    QThread m_thread;
+    QObject *m_server;
+    MessageRing m_ring;
+    QMetaMethod m_dispatch;
+    QAtomicInt m_drainPending;
+    QAtomicInt m_overflowCount;
+    MetricCounter *m_overflows;
+};
+
+#endif // IOTHREAD_H
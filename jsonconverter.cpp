@@ -0,0 +1,33 @@
+#include <QJsonDocument>
+#include "jsonconverter.h"
+
+JsonConverter::JsonConverter(QJSEngine *engine, QObject *parent) : QObject(parent)
+  ,m_engine(engine)
+{
+}
+
+
+bool JsonConverter::toScriptValue(const char *data, int length, QVariant *value)
+{
+    /* Looked up once, the global JSON object lives as long as the engine */
+    if (m_parse.isUndefined())
+        m_parse = m_engine->globalObject().property("JSON").property("parse");
+
+    QJSValue result = m_parse.call(QJSValueList() << QJSValue(QString::fromUtf8(data, length)));
+    if (result.isError() || !result.isObject())
+        return false;
+
+    *value = QVariant::fromValue(result);
+    return true;
+}
+
+
+bool JsonConverter::toVariant(const char *data, int length, QVariant *value)
+{
+    QJsonDocument doc(QJsonDocument::fromJson(QByteArray::fromRawData(data, length)));
+    if (!doc.isObject() && !doc.isArray())
+        return false;
+
+    *value = doc.toVariant();
+    return true;
+}
@@ -0,0 +1,34 @@
+#ifndef JSONCONVERTER_H
+#define JSONCONVERTER_H
+
+#include <QObject>
+#include <QJSEngine>
+#include <QJSValue>
+#include <QVariant>
+
+/*
+ * Converts parse_json values for property writes.
+ *
+ * A QML "property var" takes a QJSValue as is, so for those the text goes
+ * through the engine's own JSON.parse() and the result is stored without any
+ * further conversion. The QJsonDocument path builds a QVariantMap/List tree
+ * that QML then turns into JS objects again, on every read of the property.
+ * Typed properties (list, map, string...) still get the QVariant tree.
+ *
+ * Both accept only an object or an array, like setJsonProperty always did.
+ */
+class JsonConverter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit JsonConverter(QJSEngine *engine, QObject *parent = 0);
+
+    bool toScriptValue(const char *data, int length, QVariant *value);
+    static bool toVariant(const char *data, int length, QVariant *value);
+
+private:
+    QJSEngine *m_engine;
+    QJSValue m_parse;
+};
+
+#endif // JSONCONVERTER_H
@@ -0,0 +1,585 @@
+#include <algorithm>
+#include <string.h>
+#include <QJsonDocument>
+#include <QSet>
+#include "jsonlistmodel.h"
+#include "logging.h"
+
+/* Keys are compared as text, 12 and "12" are the same row */
+static QString keyString(const QJsonValue &value)
+{
+    return value.toVariant().toString();
+}
+
+
+/* One object or an array of objects */
+static bool rowArray(const QJsonValue &value, QJsonArray *array, QString *error)
+{
+    if (value.isObject())
+        array->append(value);
+    else if (value.isArray())
+        *array = value.toArray();
+    else
+    {
+        *error = "an object or an array of objects is expected";
+        return false;
+    }
+    return true;
+}
+
+
+JsonListModel::JsonListModel(QObject *parent) : QAbstractListModel(parent)
+  ,m_keyRole("id")
+{
+}
+
+
+JsonListModel::Operation JsonListModel::operation(const char *name, int length)
+{
+    /* Called for every write to any object, so no QString is built */
+    switch (length)
+    {
+    case 4:
+        return memcmp(name, "move", 4) == 0 ? Move : NoOperation;
+    case 5:
+        return memcmp(name, "clear", 5) == 0 ? Clear : NoOperation;
+    case 6:
+        if (memcmp(name, "append", 6) == 0)
+            return Append;
+        if (memcmp(name, "insert", 6) == 0)
+            return Insert;
+        if (memcmp(name, "update", 6) == 0)
+            return Update;
+        if (memcmp(name, "remove", 6) == 0)
+            return Remove;
+        return NoOperation;
+    case 7:
+        return memcmp(name, "replace", 7) == 0 ? Replace : NoOperation;
+    default:
+        return NoOperation;
+    }
+}
+
+
+bool JsonListModel::apply(Operation operation, const char *data, int length, QString *error)
+{
+    /* A key on its own is not a JSON document, remove reads its value itself */
+    if (operation == Remove)
+        return remove(data, length, error);
+    if (operation == Clear)
+    {
+        clear();
+        return true;
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument doc(QJsonDocument::fromJson(QByteArray::fromRawData(data, length), &parseError));
+    if (doc.isNull())
+    {
+        *error = parseError.errorString();
+        return false;
+    }
+    QJsonValue value = doc.isArray() ? QJsonValue(doc.array()) : QJsonValue(doc.object());
+
+    switch (operation)
+    {
+    case Append:
+        return append(value, error);
+    case Insert:
+        return insert(value, error);
+    case Update:
+        return update(value, error);
+    case Move:
+        return move(value, error);
+    case Replace:
+        return replace(value, error);
+    default:
+        *error = "unknown operation";
+        return false;
+    }
+}
+
+
+int JsonListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.count();
+}
+
+
+QVariant JsonListModel::data(const QModelIndex &index, int role) const
+{
+    int column = role - Qt::UserRole - 1;
+    if (!index.isValid() || index.row() >= m_rows.count() || column < 0 || column >= m_roles.count())
+        return QVariant();
+
+    return m_rows.at(index.row()).at(column);
+}
+
+
+QHash<int, QByteArray> JsonListModel::roleNames() const
+{
+    return m_roleNames;
+}
+
+
+QStringList JsonListModel::roles() const
+{
+    return m_roles;
+}
+
+
+void JsonListModel::setRoles(const QStringList &roles)
+{
+    if (roles == m_roles)
+        return;
+
+    if (m_rows.isEmpty())
+    {
+        m_roles = roles;
+        updateRoleNames();
+        emit rolesChanged();
+        return;
+    }
+
+    /* Views only read the roles again after a reset */
+    beginResetModel();
+    for (int row = 0; row < m_rows.count(); row++)
+    {
+        Row values(roles.count());
+        for (int column = 0; column < roles.count(); column++)
+        {
+            int old = m_roles.indexOf(roles.at(column));
+            if (old >= 0)
+                values[column] = m_rows.at(row).at(old);
+        }
+        m_rows[row] = values;
+    }
+    m_roles = roles;
+    updateRoleNames();
+    endResetModel();
+    emit rolesChanged();
+}
+
+
+QString JsonListModel::keyRole() const
+{
+    return m_keyRole;
+}
+
+
+void JsonListModel::setKeyRole(const QString &keyRole)
+{
+    if (keyRole == m_keyRole)
+        return;
+
+    /* The keys of the rows we have were taken from the old field */
+    if (!m_rows.isEmpty())
+    {
+        qCWarning(lcMain) << "[QMLVIEWER] JsonListModel" << objectName() << "keyRole changed, rows cleared";
+        clear();
+    }
+
+    m_keyRole = keyRole;
+    emit keyRoleChanged();
+}
+
+
+QVariantMap JsonListModel::get(int row) const
+{
+    QVariantMap map;
+    if (row < 0 || row >= m_rows.count())
+        return map;
+
+    for (int column = 0; column < m_roles.count(); column++)
+        map.insert(m_roles.at(column), m_rows.at(row).at(column));
+    return map;
+}
+
+
+int JsonListModel::indexOf(const QString &key) const
+{
+    return m_keys.value(key, -1);
+}
+
+
+bool JsonListModel::append(const QJsonValue &value, QString *error)
+{
+    QJsonArray array;
+    if (!rowArray(value, &array, error))
+        return false;
+
+    QStringList roles = rolesFor(array);
+    QVector<Row> rows;
+    QVector<QString> keys;
+    if (!toRows(array, roles, true, &rows, &keys, error))
+        return false;
+    setRoles(roles);
+
+    insertAt(m_rows.count(), rows, keys);
+    return true;
+}
+
+
+bool JsonListModel::insert(const QJsonValue &value, QString *error)
+{
+    QJsonObject object = value.toObject();
+    int index = object.value("index").toInt(-1);
+    if (index < 0 || index > m_rows.count())
+    {
+        *error = "index " + QString::number(index) + " out of range";
+        return false;
+    }
+
+    QJsonArray array;
+    if (!rowArray(object.value("rows"), &array, error))
+        return false;
+
+    QStringList roles = rolesFor(array);
+    QVector<Row> rows;
+    QVector<QString> keys;
+    if (!toRows(array, roles, true, &rows, &keys, error))
+        return false;
+    setRoles(roles);
+
+    insertAt(index, rows, keys);
+    return true;
+}
+
+
+bool JsonListModel::update(const QJsonValue &value, QString *error)
+{
+    if (m_keyRole.isEmpty())
+    {
+        *error = "update needs a keyRole";
+        return false;
+    }
+
+    QJsonArray array;
+    if (!rowArray(value, &array, error))
+        return false;
+
+    /* All rows are checked before any is changed, a bad line changes nothing */
+    QVector<int> rows;
+    foreach (const QJsonValue &item, array)
+    {
+        QString key = keyString(item.toObject().value(m_keyRole));
+        int row = m_keys.value(key, -1);
+        if (row < 0)
+        {
+            *error = "unknown key " + key;
+            return false;
+        }
+        rows.append(row);
+    }
+
+    for (int i = 0; i < rows.count(); i++)
+        assign(rows.at(i), array.at(i).toObject(), true);
+    return true;
+}
+
+
+bool JsonListModel::remove(const char *data, int length, QString *error)
+{
+    if (m_keyRole.isEmpty())
+    {
+        *error = "remove needs a keyRole";
+        return false;
+    }
+
+    /* "key", 12, ["a","b"] or just a bare key */
+    QByteArray text = QByteArray(data, length).trimmed();
+    QStringList keys;
+    QJsonDocument doc(QJsonDocument::fromJson(text.startsWith('[') ? text : '[' + text + ']'));
+    if (doc.isArray())
+    {
+        foreach (const QJsonValue &item, doc.array())
+            keys.append(keyString(item));
+    }
+    else if (!text.startsWith('['))
+        keys.append(QString::fromUtf8(text));
+    else
+    {
+        *error = "a key or an array of keys is expected";
+        return false;
+    }
+
+    QVector<int> rows;
+    foreach (const QString &key, keys)
+    {
+        int row = m_keys.value(key, -1);
+        if (row < 0)
+        {
+            *error = "unknown key " + key;
+            return false;
+        }
+        rows.append(row);
+    }
+
+    /* Bottom up, a run of neighbouring rows goes in one step */
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    int i = rows.count() - 1;
+    while (i >= 0)
+    {
+        int last = rows.at(i);
+        while (i > 0 && rows.at(i - 1) == rows.at(i) - 1)
+            i--;
+        removeAt(rows.at(i), last);
+        i--;
+    }
+    return true;
+}
+
+
+bool JsonListModel::move(const QJsonValue &value, QString *error)
+{
+    if (m_keyRole.isEmpty())
+    {
+        *error = "move needs a keyRole";
+        return false;
+    }
+
+    QJsonObject object = value.toObject();
+    QString key = keyString(object.value("key"));
+    int from = m_keys.value(key, -1);
+    int to = object.value("index").toInt(-1);
+    if (from < 0)
+    {
+        *error = "unknown key " + key;
+        return false;
+    }
+    if (to < 0 || to >= m_rows.count())
+    {
+        *error = "index " + QString::number(to) + " out of range";
+        return false;
+    }
+
+    moveTo(from, to);
+    return true;
+}
+
+
+bool JsonListModel::replace(const QJsonValue &value, QString *error)
+{
+    if (!value.isArray())
+    {
+        *error = "an array of objects is expected";
+        return false;
+    }
+
+    QJsonArray array = value.toArray();
+    QStringList roles = rolesFor(array);
+    QVector<Row> rows;
+    QVector<QString> keys;
+    if (!toRows(array, roles, false, &rows, &keys, error))
+        return false;
+    setRoles(roles);
+
+    int count = m_rows.count();
+    if (m_keyRole.isEmpty())
+    {
+        beginResetModel();
+        m_rows = rows;
+        m_rowKeys = keys;
+        endResetModel();
+        if (count != m_rows.count())
+            emit countChanged();
+        return true;
+    }
+
+    QSet<QString> wanted;
+    foreach (const QString &key, keys)
+        wanted.insert(key);
+
+    /* Rows that are gone first, bottom up so the ones above keep their place */
+    for (int row = m_rows.count() - 1; row >= 0; row--)
+    {
+        if (wanted.contains(m_rowKeys.at(row)))
+            continue;
+        int last = row;
+        while (row > 0 && !wanted.contains(m_rowKeys.at(row - 1)))
+            row--;
+        removeAt(row, last);
+    }
+
+    /* Then in the new order. Everything above i is in place, so a row we
+       still have is always at i or further down. */
+    int i = 0;
+    while (i < rows.count())
+    {
+        int current = m_keys.value(keys.at(i), -1);
+        if (current < 0)
+        {
+            int end = i + 1;
+            while (end < rows.count() && !m_keys.contains(keys.at(end)))
+                end++;
+            insertAt(i, rows.mid(i, end - i), keys.mid(i, end - i));
+            i = end;
+            continue;
+        }
+
+        moveTo(current, i);
+        assign(i, array.at(i).toObject(), false);
+        i++;
+    }
+    return true;
+}
+
+
+void JsonListModel::clear()
+{
+    if (m_rows.isEmpty())
+        return;
+
+    beginResetModel();
+    m_rows.clear();
+    m_rowKeys.clear();
+    m_keys.clear();
+    endResetModel();
+    emit countChanged();
+}
+
+
+QStringList JsonListModel::rolesFor(const QJsonArray &rows) const
+{
+    /* Without roles the first row's fields become them, set once the rows are accepted */
+    if (m_roles.isEmpty() && !rows.isEmpty())
+        return rows.first().toObject().keys();
+    return m_roles;
+}
+
+
+void JsonListModel::updateRoleNames()
+{
+    m_roleNames.clear();
+    for (int column = 0; column < m_roles.count(); column++)
+        m_roleNames.insert(Qt::UserRole + 1 + column, m_roles.at(column).toUtf8());
+}
+
+
+bool JsonListModel::toRows(const QJsonArray &array, const QStringList &roles, bool newKeys, QVector<Row> *rows, QVector<QString> *keys,
+                           QString *error) const
+{
+    QSet<QString> seen;
+    rows->reserve(array.count());
+    keys->reserve(array.count());
+
+    foreach (const QJsonValue &item, array)
+    {
+        if (!item.isObject())
+        {
+            *error = "rows must be objects";
+            return false;
+        }
+        QJsonObject object = item.toObject();
+
+        QString key;
+        if (!m_keyRole.isEmpty())
+        {
+            if (!object.contains(m_keyRole))
+            {
+                *error = "row without " + m_keyRole;
+                return false;
+            }
+            key = keyString(object.value(m_keyRole));
+            if (seen.contains(key) || (newKeys && m_keys.contains(key)))
+            {
+                *error = "duplicate key " + key;
+                return false;
+            }
+            seen.insert(key);
+        }
+
+        Row values(roles.count());
+        for (int column = 0; column < roles.count(); column++)
+            values[column] = object.value(roles.at(column)).toVariant();
+        rows->append(values);
+        keys->append(key);
+    }
+    return true;
+}
+
+
+void JsonListModel::insertAt(int first, const QVector<Row> &rows, const QVector<QString> &keys)
+{
+    if (rows.isEmpty())
+        return;
+
+    beginInsertRows(QModelIndex(), first, first + rows.count() - 1);
+    m_rows.insert(first, rows.count(), Row());
+    m_rowKeys.insert(first, keys.count(), QString());
+    for (int i = 0; i < rows.count(); i++)
+    {
+        m_rows[first + i] = rows.at(i);
+        m_rowKeys[first + i] = keys.at(i);
+    }
+    reindex(first, m_rows.count() - 1);
+    endInsertRows();
+    emit countChanged();
+}
+
+
+void JsonListModel::removeAt(int first, int last)
+{
+    beginRemoveRows(QModelIndex(), first, last);
+    for (int row = first; row <= last; row++)
+        m_keys.remove(m_rowKeys.at(row));
+    m_rows.remove(first, last - first + 1);
+    m_rowKeys.remove(first, last - first + 1);
+    reindex(first, m_rows.count() - 1);
+    endRemoveRows();
+    emit countChanged();
+}
+
+
+void JsonListModel::moveTo(int from, int to)
+{
+    if (from == to)
+        return;
+
+    /* beginMoveRows() wants the row the moved one ends up in front of */
+    beginMoveRows(QModelIndex(), from, from, QModelIndex(), to > from ? to + 1 : to);
+    Row values = m_rows.takeAt(from);
+    QString key = m_rowKeys.takeAt(from);
+    m_rows.insert(to, values);
+    m_rowKeys.insert(to, key);
+    reindex(qMin(from, to), qMax(from, to));
+    endMoveRows();
+}
+
+
+void JsonListModel::assign(int row, const QJsonObject &object, bool merge)
+{
+    /* Only the roles that really changed are reported, bindings on the others stay quiet */
+    Row &values = m_rows[row];
+    QVector<int> changed;
+    for (int column = 0; column < m_roles.count(); column++)
+    {
+        QJsonObject::const_iterator it = object.constFind(m_roles.at(column));
+        if (it == object.constEnd() && merge)
+            continue;
+
+        QVariant value = it == object.constEnd() ? QVariant() : it.value().toVariant();
+        if (values.at(column) != value)
+        {
+            values[column] = value;
+            changed.append(Qt::UserRole + 1 + column);
+        }
+    }
+
+    if (!changed.isEmpty())
+    {
+        QModelIndex modelIndex = index(row);
+        emit dataChanged(modelIndex, modelIndex, changed);
+    }
+}
+
+
+void JsonListModel::reindex(int first, int last)
+{
+    if (m_keyRole.isEmpty())
+        return;
+
+    for (int row = first; row <= last; row++)
+        m_keys.insert(m_rowKeys.at(row), row);
+}
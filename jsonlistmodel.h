@@ -0,0 +1,104 @@
+#ifndef JSONLISTMODEL_H
+#define JSONLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QStringList>
+#include <QVector>
+
+/*
+ * List model for QML that the protocol updates row by row.
+ *
+ *   import Reach.Models 1.0
+ *   JsonListModel { objectName: "alarms"; keyRole: "id"; roles: ["id", "text", "active"] }
+ *
+ * Rows are JSON objects, one role per field listed in roles (taken from the
+ * first row when roles is empty; set it in QML so views see the roles from
+ * the start). A row is found by the value of its keyRole field, "id" unless
+ * set otherwise; with an empty keyRole only append, insert, replace and clear
+ * are possible and replace rebuilds the whole list. Assigning to
+ * one of these names from any server changes only the rows involved, views
+ * keep the delegates of every other row:
+ *
+ *   alarms.append={row} or [rows]              added at the end
+ *   alarms.insert={"index":0,"rows":[rows]}    added before index
+ *   alarms.update={row} or [rows]              fields given are changed, by key
+ *   alarms.remove=key or [keys]
+ *   alarms.move={"key":key,"index":0}
+ *   alarms.replace=[rows]                      removes, inserts, moves and
+ *                                              changes what differs, by key
+ *   alarms.clear=
+ */
+class JsonListModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QStringList roles READ roles WRITE setRoles NOTIFY rolesChanged)
+    Q_PROPERTY(QString keyRole READ keyRole WRITE setKeyRole NOTIFY keyRoleChanged)
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+
+public:
+    enum Operation {
+        NoOperation,
+        Append,
+        Insert,
+        Update,
+        Remove,
+        Move,
+        Replace,
+        Clear
+    };
+
+    explicit JsonListModel(QObject *parent = 0);
+
+    static Operation operation(const char *name, int length);
+    bool apply(Operation operation, const char *data, int length, QString *error);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role) const;
+    QHash<int, QByteArray> roleNames() const;
+
+    QStringList roles() const;
+    void setRoles(const QStringList &roles);
+    QString keyRole() const;
+    void setKeyRole(const QString &keyRole);
+
+    Q_INVOKABLE QVariantMap get(int row) const;
+    Q_INVOKABLE int indexOf(const QString &key) const;
+
+signals:
+    void rolesChanged();
+    void keyRoleChanged();
+    void countChanged();
+
+private:
+    typedef QVector<QVariant> Row;
+
+    QStringList m_roles;
+    QHash<int, QByteArray> m_roleNames;
+    QString m_keyRole;
+    QVector<Row> m_rows;
+    QVector<QString> m_rowKeys;
+    QHash<QString, int> m_keys;
+
+    bool append(const QJsonValue &value, QString *error);
+    bool insert(const QJsonValue &value, QString *error);
+    bool update(const QJsonValue &value, QString *error);
+    bool remove(const char *data, int length, QString *error);
+    bool move(const QJsonValue &value, QString *error);
+    bool replace(const QJsonValue &value, QString *error);
+    void clear();
+
+    QStringList rolesFor(const QJsonArray &rows) const;
+    void updateRoleNames();
+    bool toRows(const QJsonArray &array, const QStringList &roles, bool newKeys, QVector<Row> *rows, QVector<QString> *keys,
+                QString *error) const;
+    void insertAt(int first, const QVector<Row> &rows, const QVector<QString> &keys);
+    void removeAt(int first, int last);
+    void moveTo(int from, int to);
+    void assign(int row, const QJsonObject &object, bool merge);
+    void reindex(int first, int last);
+};
+
+#endif // JSONLISTMODEL_H
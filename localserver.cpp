@@ -0,0 +1,149 @@
+#include <QThread>
+#include "localserver.h"
+#include "iothread.h"
+#include "systemdefs.h"
+#include "logging.h"
+
+LocalServer::LocalServer(QObject *parent, QString path, bool parseJson, bool translate, QString translateID, bool primaryConnection) : QObject(parent)
+  ,m_server(new QLocalServer(this))
+  ,m_ioThread(0)
+  ,m_nextClient(0)
+{
+    m_path = path;
+    m_parseJson = parseJson;
+    m_translate = translate;
+    m_translateID = translateID;
+    m_primaryConnection = primaryConnection;
+
+    QString connection = "unix:" + m_path;
+    m_clients = new StreamClients(lcLocal, "unix", connection, [this](const QByteArray &line) { deliver(line); }, this);
+
+    Metrics *metrics = Metrics::instance();
+    QString labels = Metrics::label("connection", connection);
+    m_clientCount = metrics->gauge("qmlviewer_unix_clients", "Clients connected to a unix socket server.", labels);
+    m_queueMetrics.queuedBytes = metrics->gauge("qmlviewer_unix_send_queue_bytes", "Bytes waiting in unix socket client send queues.", labels);
+    m_queueMetrics.dropped = metrics->counter("qmlviewer_unix_send_dropped_total", "Messages dropped from unix socket client send queues.", labels);
+    m_queueMetrics.coalesced = metrics->counter("qmlviewer_unix_send_coalesced_total",
+                                                "Messages replaced by a newer one in unix socket client send queues.", labels);
+}
+
+
+LocalServer::~LocalServer()
+{
+    if (m_server)
+    {
+        m_server->close();
+        delete m_server;
+    }
+}
+
+
+bool LocalServer::Start()
+{
+    /* A socket file left behind by a previous run would make listen() fail */
+    QLocalServer::removeServer(m_path);
+
+    if (m_server->listen(m_path))
+    {
+        qCInfo(lcLocal) << "[QMLVIEWER] Unix socket server listening on" << m_server->fullServerName();
+        connect(m_server, SIGNAL(newConnection()), this, SLOT(onClientConnected()));
+        if (m_primaryConnection)
+            emit PrimaryConnectionAvailable();
+        return true;
+    }
+    else
+    {
+        qCWarning(lcLocal) << "[QMLVIEWER] Error: unix socket server cannot listen on" << m_path << ":" << m_server->errorString();
+        return false;
+    }
+}
+
+
+bool LocalServer::Send(QString msg)
+{
+    /* The sockets belong to the I/O thread when there is one, write from there. */
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "Send", Qt::QueuedConnection, Q_ARG(QString, msg));
+        return true;
+    }
+
+    m_clients->send(msg);
+    return true;
+}
+
+
+void LocalServer::setIoThread(IoThread *ioThread)
+{
+    m_ioThread = ioThread;
+}
+
+
+void LocalServer::setSendQueue(qint64 maxBytes, int maxMessages, SendQueue::Policy policy)
+{
+    m_clients->setSendQueue(maxBytes, maxMessages, policy);
+}
+
+
+void LocalServer::dispatchMessage(const QByteArray &ba)
+{
+    emit MessageAvailable(ba, m_parseJson, m_translate, m_translateID);
+}
+
+
+void LocalServer::deliver(const QByteArray &ba)
+{
+    if (m_ioThread)
+        m_ioThread->post(ba);
+    else
+        dispatchMessage(ba);
+}
+
+
+QString LocalServer::getPath()
+{
+    return m_path;
+}
+
+bool LocalServer::getTranslate()
+{
+    return m_translate;
+}
+
+QString LocalServer::getTranslateID()
+{
+    return m_translateID;
+}
+
+
+void LocalServer::onClientConnected()
+{
+    QLocalSocket *s = m_server->nextPendingConnection();
+    if (!s)
+        return;
+
+    connect(s, SIGNAL(disconnected()), this, SLOT(onClientDisconnected()));
+
+    QString peer = "client " + QString::number(m_nextClient++);
+    qCInfo(lcLocal) << "[QMLVIEWER] New connection on" << m_path << ":" << peer;
+
+    m_clients->add(s, peer, m_queueMetrics);
+    m_clientCount->set(m_clients->count());
+    emit ClientConnected();
+}
+
+
+void LocalServer::onClientDisconnected()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket*>(sender());
+    QString peer;
+    if (!m_clients->remove(socket, &peer))
+        return;
+
+    qCInfo(lcLocal) << "[QMLVIEWER] Removing" << peer << "from" << m_path;
+    disconnect(socket, SIGNAL(disconnected()), this, SLOT(onClientDisconnected()));
+
+    socket->deleteLater();
+    m_clientCount->set(m_clients->count());
+    emit ClientDisconnected();
+}
@@ -0,0 +1,72 @@
+#ifndef LOCALSERVER_H
+#define LOCALSERVER_H
+
+#include <QObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include "metrics.h"
+#include "sendqueue.h"
+#include "streamclients.h"
+
+class IoThread;
+
+/*
+ * Line based server on a unix domain socket, for producers running on the
+ * same module. It speaks the same protocol as StringServer and emits the same
+ * signals, without the TCP stack in between. The clients are handled by the
+ * same StreamClients.
+ */
+class LocalServer : public QObject
+{
+    Q_OBJECT
+
+    Q_PROPERTY(QString portName READ getPortName)
+
+public:
+    explicit LocalServer(QObject *parent = 0, QString path = "", bool parseJson = false, bool translate = false, QString translateID = "",
+                         bool primaryConnection = false);
+    ~LocalServer();
+
+    QString getPortName() {
+           return m_path;
+    }
+
+    void setIoThread(IoThread *ioThread);
+    void setSendQueue(qint64 maxBytes, int maxMessages, SendQueue::Policy policy);
+
+signals:
+    void MessageAvailable(QByteArray ba, bool parseJson, bool translate, QString translateID);
+    void ClientConnected(void);
+    void ClientDisconnected(void);
+    void PrimaryConnectionAvailable();
+
+public slots:
+    bool Send(QString msg);
+    QString getPath();
+    bool getTranslate();
+    QString getTranslateID();
+    bool Start();
+    void dispatchMessage(const QByteArray &ba);
+
+private slots:
+    void onClientConnected(void);
+    void onClientDisconnected(void);
+
+private:
+    QLocalServer *m_server;
+    StreamClients *m_clients;
+    QString m_path;
+    bool m_parseJson;
+    bool m_translate;
+    QString m_translateID;
+    bool m_primaryConnection;
+    IoThread *m_ioThread;
+    int m_nextClient;
+    MetricGauge *m_clientCount;
+    /* Clients have no address to tell them apart, they share one set of send queue series */
+    StreamClients::QueueMetrics m_queueMetrics;
+
+    void deliver(const QByteArray &ba);
+};
+
+#endif // LOCALSERVER_H
@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <QDateTime>
+#include <QLoggingCategory>
+#include "logger.h"
+#include "systemdefs.h"
+#include "logging.h"
+
+Logger *Logger::s_instance = 0;
+
+Logger::Logger(int ringSize, QObject *parent) :
+    QThread(parent)
+  ,m_queueSize(LOG_QUEUE_SIZE)
+  ,m_dropped(0)
+  ,m_quit(false)
+  ,m_ring(qMax(ringSize, 1))
+  ,m_ringHead(0)
+  ,m_ringCount(0)
+  ,m_fileMaxSize(0)
+  ,m_fileCount(0)
+  ,m_level("debug")
+  ,m_previousHandler(0)
+{
+    setObjectName("logger");
+}
+
+
+Logger::~Logger()
+{
+    stopSink();
+}
+
+
+void Logger::setFile(const QString &fileName, qint64 maxSize, int fileCount)
+{
+    /* Must be called before the sink is started */
+    m_fileName = fileName;
+    m_fileMaxSize = maxSize;
+    m_fileCount = fileCount;
+}
+
+
+void Logger::startSink()
+{
+    if (isRunning())
+        return;
+
+    if (!m_fileName.isEmpty())
+    {
+        m_file.setFileName(m_fileName);
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+            fprintf(stderr, "[LOGGER] unable to open log file %s\n", qPrintable(m_fileName));
+    }
+
+    m_quit = false;
+    start(QThread::LowPriority);
+
+    s_instance = this;
+    m_previousHandler = qInstallMessageHandler(messageHandler);
+}
+
+
+void Logger::stopSink()
+{
+    if (!isRunning())
+        return;
+
+    qInstallMessageHandler(m_previousHandler);
+    s_instance = 0;
+
+    m_mutex.lock();
+    m_quit = true;
+    m_wakeUp.wakeOne();
+    m_mutex.unlock();
+
+    /* The writer empties the queue before it returns */
+    wait();
+
+    if (m_file.isOpen())
+        m_file.close();
+}
+
+
+bool Logger::setLevel(QString level)
+{
+    QString rules;
+    level = level.toLower();
+
+    if (level == "debug")
+        rules = "qmlviewer.*=true";
+    else if (level == "info")
+        rules = "qmlviewer.*.debug=false";
+    else if (level == "warning")
+        rules = "qmlviewer.*.debug=false\nqmlviewer.*.info=false";
+    else if (level == "critical")
+        rules = "qmlviewer.*.debug=false\nqmlviewer.*.info=false\nqmlviewer.*.warning=false";
+    else if (level == "off")
+        rules = "qmlviewer.*=false";
+    else
+    {
+        qCWarning(lcMain) << "[LOGGER] unknown log level" << level;
+        return false;
+    }
+
+    QLoggingCategory::setFilterRules(rules);
+    m_level = level;
+    return true;
+}
+
+
+QString Logger::level() const
+{
+    return m_level;
+}
+
+
+QStringList Logger::recentLines() const
+{
+    QStringList lines;
+    QMutexLocker locker(&m_ringMutex);
+
+    /* Oldest first */
+    int start = (m_ringHead - m_ringCount + m_ring.size()) % m_ring.size();
+    for (int i = 0; i < m_ringCount; i++)
+        lines << m_ring.at((start + i) % m_ring.size());
+
+    return lines;
+}
+
+
+int Logger::droppedCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_dropped;
+}
+
+
+void Logger::messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+{
+    Logger *logger = s_instance;
+
+    /* A fatal message aborts right after the handler returns, write it now */
+    if (type == QtFatalMsg || !logger)
+    {
+        Entry entry;
+        entry.type = type;
+        entry.timestamp = QDateTime::currentMSecsSinceEpoch();
+        entry.category = context.category;
+        entry.text = msg;
+        fprintf(stderr, "%s\n", format(entry).toLocal8Bit().constData());
+        fflush(stderr);
+        return;
+    }
+
+    logger->enqueue(type, context.category, msg);
+}
+
+
+QString Logger::format(const Entry &entry)
+{
+    const char *level;
+    switch (entry.type)
+    {
+    case QtDebugMsg: level = "D"; break;
+    case QtInfoMsg: level = "I"; break;
+    case QtWarningMsg: level = "W"; break;
+    case QtCriticalMsg: level = "C"; break;
+    default: level = "F"; break;
+    }
+
+    return QString("%1 %2 %3: %4")
+            .arg(QDateTime::fromMSecsSinceEpoch(entry.timestamp).toString("yyyy-MM-dd hh:mm:ss.zzz"))
+            .arg(level)
+            .arg(QString::fromLatin1(entry.category))
+            .arg(entry.text);
+}
+
+
+void Logger::enqueue(QtMsgType type, const char *category, const QString &msg)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_queue.count() >= m_queueSize)
+    {
+        m_dropped++;
+        return;
+    }
+
+    /* Only copy here, formatting is left to the writer thread */
+    Entry entry;
+    entry.type = type;
+    entry.timestamp = QDateTime::currentMSecsSinceEpoch();
+    entry.category = QByteArray(category ? category : "default");
+    entry.text = msg;
+    m_queue.enqueue(entry);
+
+    if (m_queue.count() == 1)
+        m_wakeUp.wakeOne();
+}
+
+
+void Logger::run()
+{
+    QQueue<Entry> batch;
+    int reportedDropped = 0;
+
+    forever
+    {
+        int dropped;
+
+        m_mutex.lock();
+        while (m_queue.isEmpty() && !m_quit)
+            m_wakeUp.wait(&m_mutex);
+
+        if (m_queue.isEmpty() && m_quit)
+        {
+            m_mutex.unlock();
+            break;
+        }
+
+        batch.swap(m_queue);
+        dropped = m_dropped;
+        m_mutex.unlock();
+
+        if (dropped != reportedDropped)
+        {
+            write(QString("[LOGGER] queue full, %1 messages dropped").arg(dropped - reportedDropped));
+            reportedDropped = dropped;
+        }
+
+        while (!batch.isEmpty())
+            write(format(batch.dequeue()));
+
+        fflush(stderr);
+        if (m_file.isOpen())
+            m_file.flush();
+    }
+}
+
+
+void Logger::write(const QString &line)
+{
+    fprintf(stderr, "%s\n", line.toLocal8Bit().constData());
+
+    if (m_file.isOpen())
+    {
+        m_file.write(line.toUtf8());
+        m_file.write("\n", 1);
+        rotate();
+    }
+
+    QMutexLocker locker(&m_ringMutex);
+    m_ring[m_ringHead] = line;
+    m_ringHead = (m_ringHead + 1) % m_ring.size();
+    if (m_ringCount < m_ring.size())
+        m_ringCount++;
+}
+
+
+void Logger::rotate()
+{
+    if (m_fileMaxSize <= 0 || m_file.size() < m_fileMaxSize)
+        return;
+
+    m_file.close();
+
+    /* file -> file.1 -> file.2 ... the oldest one is removed */
+    if (m_fileCount > 0)
+    {
+        QFile::remove(QString("%1.%2").arg(m_fileName).arg(m_fileCount));
+        for (int i = m_fileCount - 1; i > 0; i--)
+            QFile::rename(QString("%1.%2").arg(m_fileName).arg(i), QString("%1.%2").arg(m_fileName).arg(i + 1));
+        QFile::rename(m_fileName, m_fileName + ".1");
+    }
+    else
+        QFile::remove(m_fileName);
+
+    m_file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
+}
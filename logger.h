@@ -0,0 +1,87 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QVector>
+#include <QStringList>
+#include <QFile>
+
+/*
+ * Log level control and optional asynchronous log sink.
+ *
+ * setLevel() maps a level name (debug, info, warning, critical, off) onto
+ * QLoggingCategory filter rules for the qmlviewer.* categories, so disabled
+ * levels are rejected before any formatting happens.
+ *
+ * When started, a message handler is installed that only copies the message
+ * into a bounded queue. A writer thread formats the entries, keeps the last
+ * lines in a fixed-size ring (recentLines()), writes them to stderr and to an
+ * optional file that is rotated to file.1 ... file.N when it grows too big.
+ * When the queue is full new entries are dropped and counted.
+ */
+class Logger : public QThread
+{
+    Q_OBJECT
+public:
+    explicit Logger(int ringSize, QObject *parent = 0);
+    ~Logger();
+
+    void setFile(const QString &fileName, qint64 maxSize, int fileCount);
+    void startSink();
+    void stopSink();
+
+    Q_INVOKABLE bool setLevel(QString level);
+    Q_INVOKABLE QString level() const;
+    Q_INVOKABLE QStringList recentLines() const;
+    Q_INVOKABLE int droppedCount() const;
+
+protected:
+    void run();
+
+private:
+    struct Entry
+    {
+        QtMsgType type;
+        qint64 timestamp;
+        QByteArray category;
+        QString text;
+    };
+
+    static void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg);
+    static QString format(const Entry &entry);
+
+    void enqueue(QtMsgType type, const char *category, const QString &msg);
+    void write(const QString &line);
+    void rotate();
+
+    static Logger *s_instance;
+
+    /* Guarded by m_mutex */
+    mutable QMutex m_mutex;
+    QWaitCondition m_wakeUp;
+    QQueue<Entry> m_queue;
+    int m_queueSize;
+    int m_dropped;
+    bool m_quit;
+
+    /* Guarded by m_ringMutex */
+    mutable QMutex m_ringMutex;
+    QVector<QString> m_ring;
+    int m_ringHead;
+    int m_ringCount;
+
+    /* Writer thread only */
+    QFile m_file;
+    QString m_fileName;
+    qint64 m_fileMaxSize;
+    int m_fileCount;
+
+    QString m_level;
+    QtMessageHandler m_previousHandler;
+};
+
+#endif // LOGGER_H
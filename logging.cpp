@@ -0,0 +1,13 @@
+#include "logging.h"
+
+Q_LOGGING_CATEGORY(lcMain, "qmlviewer.main")
+Q_LOGGING_CATEGORY(lcSettings, "qmlviewer.settings")
+Q_LOGGING_CATEGORY(lcTranslator, "qmlviewer.translator")
+Q_LOGGING_CATEGORY(lcSerial, "qmlviewer.serial")
+Q_LOGGING_CATEGORY(lcTcp, "qmlviewer.tcp")
+Q_LOGGING_CATEGORY(lcLocal, "qmlviewer.local")
+Q_LOGGING_CATEGORY(lcUdp, "qmlviewer.udp")
+Q_LOGGING_CATEGORY(lcShm, "qmlviewer.shm")
+Q_LOGGING_CATEGORY(lcBeep, "qmlviewer.beep")
+Q_LOGGING_CATEGORY(lcWatchdog, "qmlviewer.watchdog")
+Q_LOGGING_CATEGORY(lcScreen, "qmlviewer.screen")
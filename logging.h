@@ -0,0 +1,23 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <QLoggingCategory>
+
+/*
+ * Logging categories of the viewer. Disabled levels cost a single check, the
+ * message is not formatted at all. Levels are set with "log_level" in
+ * settings.json, logger.setLevel() from QML, or QT_LOGGING_RULES.
+ */
+Q_DECLARE_LOGGING_CATEGORY(lcMain)
+Q_DECLARE_LOGGING_CATEGORY(lcSettings)
+Q_DECLARE_LOGGING_CATEGORY(lcTranslator)
+Q_DECLARE_LOGGING_CATEGORY(lcSerial)
+Q_DECLARE_LOGGING_CATEGORY(lcTcp)
+Q_DECLARE_LOGGING_CATEGORY(lcLocal)
+Q_DECLARE_LOGGING_CATEGORY(lcUdp)
+Q_DECLARE_LOGGING_CATEGORY(lcShm)
+Q_DECLARE_LOGGING_CATEGORY(lcBeep)
+Q_DECLARE_LOGGING_CATEGORY(lcWatchdog)
+Q_DECLARE_LOGGING_CATEGORY(lcScreen)
+
+#endif // LOGGING_H
@@ -2,25 +2,66 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QSettings>
+#include <QQmlEngine>
+#include <QSocketNotifier>
 #include "mainview.h"
 #include "maincontroller.h"
 #include "systemdefs.h"
 #include "applicationsettings.h"
+#include "logging.h"
+#include "jsonlistmodel.h"
 #include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
-void unixSignalHandler(int signum) {
-    qDebug("[QMLVIEWER] main.cpp::unixSignalHandler(). signal = %s", strsignal(signum));
+/* Written to by the signal handler, read by the event loop, see main() */
+static int signalPipe[2] = { -1, -1 };
 
+void unixSignalHandler(int signum) {
     /*
-     * Make sure your Qt application gracefully quits.
-     * NOTE - purpose for calling qApp->exit(0):
-     *      1. Forces the Qt framework's "main event loop `qApp->exec()`" to quit looping.
-     *      2. Also emits the QGuiApplication::aboutToQuit() signal. This signal is used for cleanup code.
+     * Only async-signal-safe calls here. Logging may take the async logger's
+     * mutex and qApp->exit() is not safe either, so the signal number is
+     * handed to the event loop through a pipe and handled there.
      */
-    qApp->exit(0);
+    int savedErrno = errno;
+    char sig = (char)signum;
+    /* A full pipe already holds a pending quit */
+    if (write(signalPipe[1], &sig, 1) < 0 && errno != EAGAIN) {
+        static const char msg[] = "[QMLVIEWER] unable to forward a signal, exiting\n";
+        if (write(STDERR_FILENO, msg, sizeof(msg) - 1) < 0) {}
+        _exit(1);
+    }
+    errno = savedErrno;
 }
 
 
+/*
+ * Reads the signal number back on the GUI thread. A slot connected through
+ * SIGNAL(activated(int)), &QSocketNotifier::activated is overloaded since Qt 5.15.
+ */
+class SignalReader : public QObject
+{
+    Q_OBJECT
+public slots:
+    void onActivated(int fd)
+    {
+        char sig;
+        if (read(fd, &sig, 1) != 1)
+            return;
+        qCInfo(lcMain, "[QMLVIEWER] main.cpp::unixSignalHandler(). signal = %s", strsignal(sig));
+
+        /*
+         * Make sure your Qt application gracefully quits.
+         * NOTE - purpose for calling qApp->exit(0):
+         *      1. Forces the Qt framework's "main event loop `qApp->exec()`" to quit looping.
+         *      2. Also emits the QGuiApplication::aboutToQuit() signal. This signal is used for cleanup code.
+         */
+        qApp->exit(0);
+    }
+};
+
+
 int main(int argc, char *argv[])
 {
     QGuiApplication app(argc, argv);
@@ -29,6 +70,13 @@ int main(int argc, char *argv[])
     QGuiApplication::setApplicationName("Qml-Viewer");
     QGuiApplication::setApplicationVersion(APP_VERSION);
 
+    /* The handler only writes the signal number, the notifier does the rest on the GUI thread */
+    if (pipe2(signalPipe, O_CLOEXEC | O_NONBLOCK) < 0)
+        qCWarning(lcMain) << "[QMLVIEWER] unable to create the signal pipe:" << strerror(errno);
+    QSocketNotifier signalNotifier(signalPipe[0], QSocketNotifier::Read);
+    SignalReader signalReader;
+    QObject::connect(&signalNotifier, SIGNAL(activated(int)), &signalReader, SLOT(onActivated(int)));
+
     /* Set a signal handler for a quit or a control-c for clean up purposes */
     struct sigaction actInt, actQuit;
     memset((void*)&actInt, 0, sizeof(struct sigaction));
@@ -41,6 +89,9 @@ int main(int argc, char *argv[])
     actQuit.sa_handler = &unixSignalHandler;
     sigaction(SIGQUIT, &actQuit, NULL);
 
+    /* Models the protocol updates row by row, see JsonListModel */
+    qmlRegisterType<JsonListModel>("Reach.Models", 1, 0, "JsonListModel");
+
     MainView view;
 
     QFileInfo settingsFile;
@@ -49,7 +100,7 @@ int main(int argc, char *argv[])
     QStringList args = app.arguments();
     foreach (QString item, args) {
         if(item == "--version" || item == "-v") {
-            qDebug() << "QML Viewer " << APP_VERSION;
+            qCInfo(lcMain) << "QML Viewer " << APP_VERSION;
             return 0;
         }
     }
@@ -60,7 +111,7 @@ int main(int argc, char *argv[])
         sb = args[1];
         QFileInfo f(sb);
         sb = f.path();
-        qDebug() << sb << endl;
+        qCDebug(lcMain) << sb << endl;
     }
 
     sb.append(QDir::separator());
@@ -71,7 +122,7 @@ int main(int argc, char *argv[])
     QFileInfo file(sb.toLatin1());
     if (file.exists())
     {
-        qDebug() << "[QMLVIEWER] using local settings file:" << sb;
+        qCInfo(lcMain) << "[QMLVIEWER] using local settings file:" << sb;
         settingsFile.setFile(file.filePath());
     }
     else
@@ -80,18 +131,18 @@ int main(int argc, char *argv[])
         file.setFile(SYSTEM_SETTINGS_FILE);
         if (file.exists())
         {
-            qDebug() << "[QMLVIEWER] using system defined settings file:" << SYSTEM_SETTINGS_FILE;
+            qCInfo(lcMain) << "[QMLVIEWER] using system defined settings file:" << SYSTEM_SETTINGS_FILE;
             settingsFile.setFile(SYSTEM_SETTINGS_FILE);
         }
         else
         {
             if (QFile::copy(":/settings.json", SYSTEM_SETTINGS_FILE))
             {
-                 qDebug() << "[QMLVIEWER] created a settings.json file:" << SYSTEM_SETTINGS_FILE;
+                 qCInfo(lcMain) << "[QMLVIEWER] created a settings.json file:" << SYSTEM_SETTINGS_FILE;
                  settingsFile.setFile(SYSTEM_SETTINGS_FILE);
             }
             else
-                qDebug() << "[QMLVIEWER] error creating a settings.json file:" << SYSTEM_SETTINGS_FILE;
+                qCWarning(lcMain) << "[QMLVIEWER] error creating a settings.json file:" << SYSTEM_SETTINGS_FILE;
         }
     }
 
@@ -118,7 +169,7 @@ int main(int argc, char *argv[])
     //If there is trouble opening up a serial port don't open the main qml file
     if (controller.getStartUpError().length() == 0)
     {
-        qDebug() << "[QMLVIEWER] Loading main qml file:" << controller.getMainViewPath();
+        qCInfo(lcMain) << "[QMLVIEWER] Loading main qml file:" << controller.getMainViewPath();
         view.setSource(QUrl::fromLocalFile(controller.getMainViewPath()));
         view.setResizeMode(QQuickView::SizeRootObjectToView);
 
@@ -134,3 +185,5 @@ int main(int argc, char *argv[])
 
     return app.exec();
 }
+
+#include "main.moc"
@@ -1,6 +1,9 @@
+#include <string.h>
 #include <QQuickItem>
 #include <QQmlContext>
+#include <QElapsedTimer>
 #include "maincontroller.h"
+#include "logging.h"
 
 MainController::MainController(MainView *view, QString settingsFilePath,
                                QObject *parent) :
@@ -9,16 +12,50 @@ MainController::MainController(MainView *view, QString settingsFilePath,
   ,m_settings(new Settings(this))
   ,m_heartbeatText(HEARTBEAT_TEXT)
   ,m_heartbeatResponseText(HEARTBEAT_RESPONSE_TEXT)
+  ,m_heartbeatResponseBytes(HEARTBEAT_RESPONSE_TEXT)
   ,m_heartbeat_interval(0)
   ,m_hearbeatTimer(new QTimer(this))
   ,m_errorTimer(new QTimer(this))
   ,m_appSettings(new ApplicationSettings(this))
+  ,m_objectIndex(new ObjectIndex(this))
+  ,m_propertyCache(new PropertyCache(this))
+  ,m_coalescer(new UpdateCoalescer(view, this))
+  ,m_jsonConverter(new JsonConverter(view->engine(), this))
+  ,m_logger(0)
+  ,m_metricsServer(0)
+  ,m_ackWindowMode(false)
 {
+    Metrics *metrics = Metrics::instance();
+    m_syntaxErrors = metrics->counter("qmlviewer_parse_errors_total", "Inbound lines that could not be parsed.", "kind=\"syntax\"");
+    m_invalidMessages = metrics->counter("qmlviewer_parse_errors_total", "Inbound lines that could not be parsed.", "kind=\"invalid\"");
+    m_lookupNoObject = metrics->counter("qmlviewer_lookup_failures_total", "Assignments that could not be applied.", "reason=\"no_object\"");
+    m_lookupNoProperty = metrics->counter("qmlviewer_lookup_failures_total", "Assignments that could not be applied.", "reason=\"no_property\"");
+    m_propertyWrites = metrics->counter("qmlviewer_property_writes_total", "Property writes, applied or queued for the next frame.");
+    m_modelUpdates = metrics->counter("qmlviewer_model_updates_total", "Row operations applied to JsonListModel objects.");
+    m_ackOk = metrics->counter("qmlviewer_acks_sent_total", "Acks sent to the connection the lines came from, or the primary connection.", "ack=\"LUOK\"");
+    m_ackNoObject = metrics->counter("qmlviewer_acks_sent_total", "Acks sent to the connection the lines came from, or the primary connection.", "ack=\"LUNO\"");
+    m_ackNoProperty = metrics->counter("qmlviewer_acks_sent_total", "Acks sent to the connection the lines came from, or the primary connection.", "ack=\"LUNP\"");
+    m_ackSyntaxError = metrics->counter("qmlviewer_acks_sent_total", "Acks sent to the connection the lines came from, or the primary connection.", "ack=\"SYNERR\"");
+    m_ackWindowAcks = metrics->counter("qmlviewer_acks_sent_total", "Acks sent to the connection the lines came from, or the primary connection.", "ack=\"ACK\"");
+    m_ackWindowNaks = metrics->counter("qmlviewer_acks_sent_total", "Acks sent to the connection the lines came from, or the primary connection.", "ack=\"NAK\"");
+    m_heartbeatsSent = metrics->counter("qmlviewer_heartbeats_sent_total", "Heartbeats sent to the primary connection.");
+    m_heartbeatsReceived = metrics->counter("qmlviewer_heartbeats_received_total", "Heartbeat responses received.");
+    m_heartbeatsMissed = metrics->counter("qmlviewer_heartbeats_missed_total", "Heartbeat intervals without a response.");
+
     connect(m_appSettings, SIGNAL(error(QString)),this, SLOT(onAppSettingsError(QString)));
 
     /* load setting from the json file */
     if (m_appSettings->parseJSON(settingsFilePath))
     {
+        /* Set the log level first, optionally move log output off the GUI thread */
+        m_logger = new Logger(m_appSettings->logRingSize(), this);
+        m_logger->setLevel(m_appSettings->logLevel());
+        if (m_appSettings->logAsync())
+        {
+            m_logger->setFile(m_appSettings->logFile(), m_appSettings->logFileMaxSize(), m_appSettings->logFileCount());
+            m_logger->startSink();
+        }
+
         m_screen = new Screen(view, m_appSettings->screenSaverTimeout(), m_appSettings->screenOriginalBrigtness(),
                               m_appSettings->screenDimBrigtness(), this);
         m_watchdog = new Watchdog(this, m_appSettings->enableWatchdog());
@@ -30,6 +67,22 @@ MainController::MainController(MainView *view, QString settingsFilePath,
         m_view->rootContext()->setContextProperty("screen", m_screen);
         m_view->rootContext()->setContextProperty("watchdog", m_watchdog);
         m_view->rootContext()->setContextProperty("beeper", m_beep);
+        m_view->rootContext()->setContextProperty("logger", m_logger);
+        m_view->rootContext()->setContextProperty("metrics", Metrics::instance());
+
+        /* Optional read-only stats endpoint */
+        if (m_appSettings->metricsPort() > 0 || !m_appSettings->metricsSocket().isEmpty())
+        {
+            m_metricsServer = new MetricsServer(this);
+            if (m_appSettings->metricsPort() > 0)
+                m_metricsServer->listenTcp(m_appSettings->metricsPort());
+            if (!m_appSettings->metricsSocket().isEmpty())
+                m_metricsServer->listenLocal(m_appSettings->metricsSocket());
+        }
+
+        /* Sequence numbered lines are acked per window, lines without one keep the per line acks.
+           The windows are created per connection as lines arrive, see ackWindow(). */
+        m_ackWindowMode = m_appSettings->ackMode() == "window";
 
         /* Enable or disable ack */
         if (m_appSettings->enableAck())
@@ -55,9 +108,17 @@ MainController::MainController(MainView *view, QString settingsFilePath,
         int i = 0;
         foreach(const StringServerSetting &server, m_appSettings->stringServers())
         {
-            StringServer *stringServer =  new StringServer(this, server.port(), server.parseJson(),
+            /* A server that runs on an I/O thread can't have a parent, its IoThread owns it. */
+            StringServer *stringServer =  new StringServer(server.ioThread() ? 0 : this, server.port(), server.parseJson(),
                                                            server.translate(), server.translateId(),
                                                            server.primaryConnection());
+            stringServer->setSendQueue(server.sendQueueBytes(), server.sendQueueMessages(), server.sendQueuePolicy());
+            IoThread *ioThread = 0;
+            if (server.ioThread())
+            {
+                ioThread = new IoThread(stringServer, server.ioRingSize(), this);
+                stringServer->setIoThread(ioThread);
+            }
             if (server.translate())
                 m_enableTranslator = true;
             connect(stringServer, SIGNAL(PrimaryConnectionAvailable()), this, SLOT(onPrimaryConnectionAvailable()));
@@ -66,11 +127,19 @@ MainController::MainController(MainView *view, QString settingsFilePath,
             connect(stringServer, SIGNAL(ClientConnected()), this, SLOT(onClientConnected()));
             connect(stringServer, SIGNAL(ClientDisconnected()), this, SLOT(onClientDisconnected()));
 
-            if (stringServer->Start())
+            if (ioThread ? ioThread->start() : stringServer->Start())
             {
                 m_stringServerList.append(stringServer);
+                if (server.coalesce())
+                    m_coalescingServers.insert(stringServer);
+                if (ioThread)
+                    m_ioThreads.append(ioThread);
                 i += 1;
             }
+            else if (ioThread)
+            {
+                delete ioThread;
+            }
             else
             {
                 delete stringServer;
@@ -78,11 +147,114 @@ MainController::MainController(MainView *view, QString settingsFilePath,
         }
 
 
+        /* Create the unix socket servers, they work like the TCP servers */
+        foreach(const LocalServerSetting &server, m_appSettings->localServers())
+        {
+            LocalServer *localServer = new LocalServer(server.ioThread() ? 0 : this, server.path(), server.parseJson(),
+                                                       server.translate(), server.translateId(),
+                                                       server.primaryConnection());
+            localServer->setSendQueue(server.sendQueueBytes(), server.sendQueueMessages(), server.sendQueuePolicy());
+            IoThread *ioThread = 0;
+            if (server.ioThread())
+            {
+                ioThread = new IoThread(localServer, server.ioRingSize(), this);
+                localServer->setIoThread(ioThread);
+            }
+            if (server.translate())
+                m_enableTranslator = true;
+            connect(localServer, SIGNAL(PrimaryConnectionAvailable()), this, SLOT(onPrimaryConnectionAvailable()));
+            connect(localServer, SIGNAL(MessageAvailable(QByteArray, bool, bool, QString))
+                    , this, SLOT(onMessageAvailable(QByteArray, bool, bool, QString)));
+            connect(localServer, SIGNAL(ClientConnected()), this, SLOT(onClientConnected()));
+            connect(localServer, SIGNAL(ClientDisconnected()), this, SLOT(onClientDisconnected()));
+
+            if (ioThread ? ioThread->start() : localServer->Start())
+            {
+                m_localServerList.append(localServer);
+                if (server.coalesce())
+                    m_coalescingServers.insert(localServer);
+                if (ioThread)
+                    m_ioThreads.append(ioThread);
+            }
+            else if (ioThread)
+            {
+                delete ioThread;
+            }
+            else
+            {
+                delete localServer;
+            }
+        }
+
+
+        /* Create the UDP servers, they only receive */
+        foreach(const UdpServerSetting &server, m_appSettings->udpServers())
+        {
+            UdpServer *udpServer = new UdpServer(server, server.ioThread() ? 0 : this);
+            IoThread *ioThread = 0;
+            if (server.ioThread())
+            {
+                ioThread = new IoThread(udpServer, server.ioRingSize(), this);
+                udpServer->setIoThread(ioThread);
+            }
+            if (server.translate())
+                m_enableTranslator = true;
+            connect(udpServer, SIGNAL(MessageAvailable(QByteArray, bool, bool, QString))
+                    , this, SLOT(onMessageAvailable(QByteArray, bool, bool, QString)));
+
+            if (ioThread ? ioThread->start() : udpServer->Start())
+            {
+                m_udpServerList.append(udpServer);
+                if (server.coalesce())
+                    m_coalescingServers.insert(udpServer);
+                if (ioThread)
+                    m_ioThreads.append(ioThread);
+            }
+            else if (ioThread)
+            {
+                delete ioThread;
+            }
+            else
+            {
+                delete udpServer;
+            }
+        }
+
+
+        /* Create the shared memory rings, they only receive */
+        foreach(const ShmServerSetting &server, m_appSettings->shmServers())
+        {
+            ShmServer *shmServer = new ShmServer(this, server.name(), server.size(), server.parseJson(),
+                                                 server.translate(), server.translateId());
+            if (server.translate())
+                m_enableTranslator = true;
+            connect(shmServer, SIGNAL(MessageAvailable(QByteArray, bool, bool, QString))
+                    , this, SLOT(onMessageAvailable(QByteArray, bool, bool, QString)));
+
+            if (shmServer->Start())
+            {
+                m_shmServerList.append(shmServer);
+                if (server.coalesce())
+                    m_coalescingServers.insert(shmServer);
+            }
+            else
+            {
+                delete shmServer;
+            }
+        }
+
+
         /* Create the Serial Servers and add the connections */
         i = 0;
         foreach(const SerialServerSetting &server, m_appSettings->serialServers())
         {
-            SerialServer *serialServer = new SerialServer(server, this);
+            SerialServer *serialServer = new SerialServer(server, server.ioThread() ? 0 : this);
+            IoThread *ioThread = 0;
+            if (server.ioThread())
+            {
+                ioThread = new IoThread(serialServer, server.ioRingSize(), this);
+                serialServer->setIoThread(ioThread);
+            }
             connect(serialServer, SIGNAL(ClientConnected()), this, SLOT(onClientConnected()));
             connect(serialServer, SIGNAL(PrimaryConnectionAvailable()), this, SLOT(onPrimaryConnectionAvailable()));
             connect(serialServer, SIGNAL(MessageAvailable(QByteArray, bool, bool, QString))
@@ -92,11 +264,19 @@ MainController::MainController(MainView *view, QString settingsFilePath,
             if (server.translate())
                 m_enableTranslator = true;
 
-            if (serialServer->Start())
+            if (ioThread ? ioThread->start() : serialServer->Start())
             {
                 m_serialServerList.append(serialServer);
+                if (server.coalesce())
+                    m_coalescingServers.insert(serialServer);
+                if (ioThread)
+                    m_ioThreads.append(ioThread);
                 i += 1;
             }
+            else if (ioThread)
+            {
+                delete ioThread;
+            }
             else
             {
                 delete serialServer;
@@ -131,12 +311,31 @@ MainController::~MainController()
     if (m_settings)
         delete m_settings;
 
+    /* Servers running on an I/O thread are deleted when their thread finishes. */
+    foreach (IoThread *ioThread, m_ioThreads)
+    {
+        m_stringServerList.removeAll(qobject_cast<StringServer*>(ioThread->server()));
+        m_serialServerList.removeAll(qobject_cast<SerialServer*>(ioThread->server()));
+        m_localServerList.removeAll(qobject_cast<LocalServer*>(ioThread->server()));
+        m_udpServerList.removeAll(qobject_cast<UdpServer*>(ioThread->server()));
+    }
+    qDeleteAll(m_ioThreads);
+
     if(!m_stringServerList.isEmpty())
         qDeleteAll(m_stringServerList);
 
     if (!m_serialServerList.isEmpty())
         qDeleteAll(m_serialServerList);
 
+    if (!m_localServerList.isEmpty())
+        qDeleteAll(m_localServerList);
+
+    if (!m_udpServerList.isEmpty())
+        qDeleteAll(m_udpServerList);
+
+    if (!m_shmServerList.isEmpty())
+        qDeleteAll(m_shmServerList);
+
     if (m_enableTranslator && m_transLator)
         delete m_transLator;
 
@@ -154,6 +353,10 @@ MainController::~MainController()
 
     if (m_beep)
         delete(m_beep);
+
+    /* Last, so everything logged during shutdown is written */
+    if (m_logger)
+        delete m_logger;
 }
 
 
@@ -175,7 +378,7 @@ bool MainController::sendTCPMessage(QString msg, int port)
     if (numServer == -1)
     {
         /* Show message that the server with port was not found */
-        qDebug() << "[QMLVIEWER] Error Could not sendTCPMessage.  TCP Server on port " << port << " was not found.";
+        qCWarning(lcMain) << "[QMLVIEWER] Error Could not sendTCPMessage.  TCP Server on port " << port << " was not found.";
         return false;
     }
 
@@ -186,7 +389,7 @@ bool MainController::sendTCPMessage(QString msg, int port)
         translatedMessage = m_transLator->translateGuiMessage(msg);
         if (translatedMessage.length() == 0)
         {
-            qDebug() << "[QMLVIEWER] Unable to translate message:" << msg;
+            qCWarning(lcMain) << "[QMLVIEWER] Unable to translate message:" << msg;
             return false;
         }
     }
@@ -215,7 +418,7 @@ bool MainController::sendSerialMessage(QString msg, QString portName)
     if (numServer == -1)
     {
         /* Show message that the server with port was not found */
-        qDebug() << "[QMLVIEWER] Error Could not sendSerialMessage.  Serial Server on port " << portName << "was not found.";
+        qCWarning(lcMain) << "[QMLVIEWER] Error Could not sendSerialMessage.  Serial Server on port " << portName << "was not found.";
         return false;
     }
 
@@ -225,7 +428,7 @@ bool MainController::sendSerialMessage(QString msg, QString portName)
         translatedMessage = m_transLator->translateGuiMessage(msg);
         if (translatedMessage.length() == 0)
         {
-            qDebug() << "[QMLVIEWER] Unable to translate message:" << msg;
+            qCWarning(lcMain) << "[QMLVIEWER] Unable to translate message:" << msg;
             return false;
         }
     }
@@ -235,116 +438,231 @@ bool MainController::sendSerialMessage(QString msg, QString portName)
 }
 
 
-bool MainController::sendMessage(QString msg)
+bool MainController::sendLocalMessage(QString msg, QString path)
 {
     QString translatedMessage = msg;
+    LocalServer *localServer = 0;
 
-    if (m_primaryConnectionClassName == "StringServer")
+    /* Find the server */
+    foreach (LocalServer *server, m_localServerList)
     {
-        /* Translate the message if we need to. */
-        if (m_enableTranslator && qobject_cast<StringServer*>(m_primaryConnection)->getTranslate())
+        if (server->getPath() == path)
         {
-            translatedMessage = m_transLator->translateGuiMessage(msg);
-            if (translatedMessage.length() == 0)
-            {
-                qDebug() << "[QMLVIEWER] Unable to translate message:" << msg;
-                return false;
-            }
+            localServer = server;
+            break;
         }
+    }
 
-        qobject_cast<StringServer*>(m_primaryConnection)->Send(translatedMessage);
-        return true;
+    if (!localServer)
+    {
+        qCWarning(lcMain) << "[QMLVIEWER] Error Could not sendLocalMessage.  Unix socket server on " << path << " was not found.";
+        return false;
     }
-    else if (m_primaryConnectionClassName == "SerialServer")
+
+    /* Translate the message if we need to. */
+    if (m_enableTranslator && localServer->getTranslate())
     {
-        /* Translate the message if we need to. */
-        if (m_enableTranslator && qobject_cast<SerialServer*>(m_primaryConnection)->getTranslate())
+        translatedMessage = m_transLator->translateGuiMessage(msg);
+        if (translatedMessage.length() == 0)
         {
-            translatedMessage = m_transLator->translateGuiMessage(msg);
-            if (translatedMessage.length() == 0)
-            {
-                qDebug() << "[QMLVIEWER] Unable to translate message:" << msg;
-                return false;
-            }
+            qCWarning(lcMain) << "[QMLVIEWER] Unable to translate message:" << msg;
+            return false;
         }
+    }
 
-        qobject_cast<SerialServer*>(m_primaryConnection)->Send(translatedMessage);
-        return true;
+    localServer->Send(translatedMessage);
+    return true;
+}
+
+
+bool MainController::sendMessage(QString msg)
+{
+    return sendToConnection(m_primaryConnection, msg);
+}
+
+
+bool MainController::sendToConnection(QObject *connection, const QString &msg)
+{
+    QString translatedMessage = msg;
+    StringServer *stringServer = qobject_cast<StringServer*>(connection);
+    SerialServer *serialServer = qobject_cast<SerialServer*>(connection);
+    LocalServer *localServer = qobject_cast<LocalServer*>(connection);
+
+    /* Only these have a way back to the sender */
+    bool translate;
+    if (stringServer)
+        translate = stringServer->getTranslate();
+    else if (serialServer)
+        translate = serialServer->getTranslate();
+    else if (localServer)
+        translate = localServer->getTranslate();
+    else
+        return false;
+
+    /* Translate the message if we need to. */
+    if (m_enableTranslator && translate)
+    {
+        translatedMessage = m_transLator->translateGuiMessage(msg);
+        if (translatedMessage.length() == 0)
+        {
+            qCWarning(lcMain) << "[QMLVIEWER] Unable to translate message:" << msg;
+            return false;
+        }
     }
 
-    return false;
+    if (stringServer)
+        stringServer->Send(translatedMessage);
+    else if (serialServer)
+        serialServer->Send(translatedMessage);
+    else
+        localServer->Send(translatedMessage);
+    return true;
 }
 
 
 void MainController::onMessageAvailable(QByteArray ba, bool parseJson, bool translate, QString translateID)
 {
-    QString message(ba);
-    message.replace('\r', "");
-    message.replace('\n', "");
-    if (message.length() == 0) {
+    QElapsedTimer timer;
+    timer.start();
+    ConnectionMetrics metrics = connectionMetrics(QObject::sender());
+    metrics.messages->add();
+
+    /* The line is tokenized in place, see MessageParser. */
+    const char *data = ba.constData();
+    int length = ba.length();
+    MessageParser::stripLineEnding(&data, &length);
+    quint32 sequence = 0;
+    AckWindow *window = m_ackWindowMode ? ackWindow(QObject::sender()) : 0;
+    bool sequenced = window && MessageParser::takeSequence(&data, &length, &sequence);
+    if (length == 0) {
+        if (sequenced && m_enableAck)
+            window->received(sequence, true);
         return;
     }
 
     /* check for hearbeat - must be a pong */
-    if(message.trimmed() == m_heartbeatResponseText) {
-        qDebug() << "[QMLVIEWER] got " << m_heartbeatResponseText;
+    if(MessageParser::isHeartbeat(data, length, m_heartbeatResponseBytes)) {
+        qCDebug(lcMain) << "[QMLVIEWER] got " << m_heartbeatResponseText;
+        m_heartbeatsReceived->add();
         if(m_hearbeatTimer->isActive()) {
             m_enableHearbeat = true;
+            if (sequenced && m_enableAck)
+                window->received(sequence, true);
             emit heartbeat();
             return;
         }
     }
 
     /* Translate the the message if we have to. */
+    QByteArray translated;
     if (translate)
     {
-        message = m_transLator->translateMCUMessage(translateID, message);
+        translated = m_transLator->translateMCUMessage(translateID, QString::fromUtf8(data, length)).toUtf8();
+        data = translated.constData();
+        length = translated.length();
     }
 
-    /* Our protocol is obj.prop=value, so split message. */
-    if (message.contains("=") && message.contains("."))
+    /* Our protocol is obj.prop=value, so split message. JSON values may contain ';' and '{' so
+       lines from parse_json servers always hold a single assignment. */
+    ParsedMessage msgs[MessageParser::MaxAssignments];
+    int count;
+    switch (MessageParser::parse(data, length, !parseJson, msgs, &count))
+    {
+    case MessageParser::Assignment:
     {
+        /* Servers with coalesce set have their writes applied once per frame. */
+        bool coalesce = m_coalescingServers.contains(QObject::sender());
+        QObject *obj = 0;
+        LookupResult ack = LookupOk;
 
-        QString value;
-        int pos = message.indexOf("=");
-        value = message.mid(pos + 1, message.length());
-        QString item = message.mid(0, pos);
-        QStringList items = item.split('.');
+        for (int i = 0; i < count; i++)
+        {
+            const ParsedMessage &msg = msgs[i];
+            qCDebug(lcMain) << "[MCU " << translateID << "]: " << QLatin1String(msg.object, msg.objectLength) << "."
+                     << QLatin1String(msg.property, msg.propertyLength) << ": " << QLatin1String(msg.value, msg.valueLength);
+
+            /* Each object is only looked up once when a line addresses it several times in a row. */
+            if (i == 0 || msg.objectLength != msgs[i - 1].objectLength
+                    || memcmp(msg.object, msgs[i - 1].object, msg.objectLength) != 0)
+                obj = m_objectIndex->find(msg.object, msg.objectLength);
+
+            LookupResult result;
+            JsonListModel::Operation operation;
+            if (!obj) {
+                qCWarning(lcMain) << "[QMLVIEWER] no item with objectName:" << QByteArray(msg.object, msg.objectLength);
+                result = LookupNoObject;
+            }
+            else if ((operation = JsonListModel::operation(msg.property, msg.propertyLength)) != JsonListModel::NoOperation
+                     && qobject_cast<JsonListModel*>(obj))
+                result = updateModel(static_cast<JsonListModel*>(obj), operation, msg);
+            else if (parseJson)
+                result = setJsonProperty(obj, msg, coalesce);
+            else
+                result = setProperty(obj, msg, coalesce);
 
-        if (value.length() == 0 || items.count() != 2) {
-            qDebug() << "[QMLVIEWER] Message syntax error." << message;
-            if (m_enableAck)
-                sendMessage("SYNERR");
+            if (result == LookupNoObject)
+                m_lookupNoObject->add();
+            else if (result == LookupNoProperty)
+                m_lookupNoProperty->add();
+
+            /* One ack per line, the first failure wins. */
+            if (ack == LookupOk)
+                ack = result;
         }
-        else
+
+        if (m_enableAck && sequenced)
+            window->received(sequence, ack == LookupOk);
+        else if (m_enableAck && ack != LookupInvalid)
         {
-            qDebug() << "[MCU " << translateID << "]: " << items[0] << "." << items[1] << ": " << value;
-            if (parseJson)
-                setJsonProperty(items[0], items[1], value);
+            sendMessage(ack == LookupOk ? "LUOK" : ack == LookupNoObject ? "LUNO" : "LUNP");
+            if (ack == LookupOk)
+                m_ackOk->add();
+            else if (ack == LookupNoObject)
+                m_ackNoObject->add();
             else
-                setProperty(items[0], items[1], value);
+                m_ackNoProperty->add();
         }
+        break;
     }
-    else {
-        qDebug() << "[QMLVIEWER] Invalid message:" << message << " from " << ba;
-        if (m_enableAck)
+    case MessageParser::SyntaxError:
+        qCWarning(lcMain) << "[QMLVIEWER] Message syntax error." << QByteArray(data, length);
+        m_syntaxErrors->add();
+        if (m_enableAck && sequenced)
+            window->received(sequence, false);
+        else if (m_enableAck)
+        {
             sendMessage("SYNERR");
+            m_ackSyntaxError->add();
+        }
+        break;
+    case MessageParser::Invalid:
+        qCWarning(lcMain) << "[QMLVIEWER] Invalid message:" << QByteArray(data, length) << " from " << ba;
+        m_invalidMessages->add();
+        if (m_enableAck && sequenced)
+            window->received(sequence, false);
+        else if (m_enableAck)
+        {
+            sendMessage("SYNERR");
+            m_ackSyntaxError->add();
+        }
+        break;
     }
 
+    metrics.latency->observe(timer.nsecsElapsed() / 1000);
+
 }
 
 
 void MainController::onPrimaryConnectionAvailable()
 {
     m_primaryConnection = QObject::sender();
-    m_primaryConnectionClassName = QObject::sender()->metaObject()->className();
-    qDebug() << "[QMLVIEWER] Primary connection set to" << QObject::sender()->metaObject()->className() << ":" << QObject::sender()->property("portName").toString();
+    qCInfo(lcMain) << "[QMLVIEWER] Primary connection set to" << QObject::sender()->metaObject()->className() << ":" << QObject::sender()->property("portName").toString();
 }
 
 
 void MainController::enableHeartbeat(int interval)
 {
-    qDebug() << "[QMLVIEWER] hearbeat enabled ";
+    qCInfo(lcMain) << "[QMLVIEWER] hearbeat enabled ";
     m_heartbeat_interval = interval;
     m_hearbeatTimer->stop();
     m_hearbeatTimer->start((m_heartbeat_interval * 1000));
@@ -353,9 +671,10 @@ void MainController::enableHeartbeat(int interval)
 
 void MainController::enableHeartbeat(int interval, QString heartbeatText, QString heartbeatResponseText)
 {
-    qDebug() << "[QMLVIEWER] hearbeat enabled ";
+    qCInfo(lcMain) << "[QMLVIEWER] hearbeat enabled ";
     m_heartbeatText = heartbeatText;
     m_heartbeatResponseText = heartbeatResponseText;
+    m_heartbeatResponseBytes = heartbeatResponseText.toUtf8();
     m_heartbeat_interval = interval;
     m_hearbeatTimer->stop();
     m_hearbeatTimer->start((m_heartbeat_interval * 1000));
@@ -364,7 +683,7 @@ void MainController::enableHeartbeat(int interval, QString heartbeatText, QStrin
 
 void MainController::disableHeartbeat()
 {
-    qDebug() << "[QMLVIEWER] hearbeat disabled ";
+    qCInfo(lcMain) << "[QMLVIEWER] hearbeat disabled ";
     if(m_hearbeatTimer->isActive()) {
         m_hearbeatTimer->stop();
     }
@@ -375,16 +694,55 @@ void MainController::onHeartbeatTimerTimeout()
 {
     /* if we have not received a pong emit signal*/
     if(!m_enableHearbeat) {
+        m_heartbeatsMissed->add();
         emit noHeartbeat();
     }
     m_enableHearbeat = false;
     sendMessage(m_heartbeatText);
+    m_heartbeatsSent->add();
+}
+
+
+void MainController::onAckWindowSend(QString msg)
+{
+    /* The report goes back to the connection whose numbers it covers, UDP and
+       shared memory have no way back and use the primary connection like line acks */
+    AckWindow *window = qobject_cast<AckWindow*>(QObject::sender());
+    QObject *connection = m_ackWindows.key(window);
+    if (!qobject_cast<StringServer*>(connection) && !qobject_cast<SerialServer*>(connection)
+            && !qobject_cast<LocalServer*>(connection))
+        connection = m_primaryConnection;
+
+    if (!sendToConnection(connection, msg))
+        return;
+
+    if (msg.startsWith("NAK"))
+        m_ackWindowNaks->add();
+    else
+        m_ackWindowAcks->add();
+}
+
+
+AckWindow *MainController::ackWindow(QObject *connection)
+{
+    /* Every connection numbers its own lines, one shared window would see
+       the other's numbers as gaps and restarts */
+    AckWindow *window = m_ackWindows.value(connection);
+    if (!window)
+    {
+        window = new AckWindow(m_appSettings->ackWindowCount(), m_appSettings->ackWindowInterval(), this);
+        connect(window, SIGNAL(send(QString)), this, SLOT(onAckWindowSend(QString)));
+        m_ackWindows.insert(connection, window);
+    }
+    return window;
 }
 
 
 void MainController::disableLookupAck()
 {
     m_enableAck = false;
+    foreach (AckWindow *window, m_ackWindows)
+        window->flush();
     emit lookupAckChanged(false);
 }
 
@@ -395,6 +753,26 @@ QString MainController::getStartUpError()
 }
 
 
+QVariantMap MainController::getSerialLinkStats(QString portName)
+{
+    /* Link quality of serial ports with binary framing. */
+    QVariantMap stats;
+    foreach (SerialServer *serialServer, m_serialServerList)
+    {
+        const FrameCodec *codec = serialServer->frameCodec();
+        if (serialServer->getPortName() == portName && codec)
+        {
+            stats.insert("framesReceived", codec->framesReceived());
+            stats.insert("frameErrors", codec->frameErrors());
+            stats.insert("resyncs", codec->resyncs());
+            stats.insert("droppedBytes", codec->droppedBytes());
+        }
+    }
+
+    return stats;
+}
+
+
 void MainController::handleSigTerm()
 {
     // shut down the watchdog timer if it was started
@@ -440,7 +818,7 @@ void MainController::onClientConnected()
     m_clients++;
     m_mutex.unlock();
     emit readyToSend();
-    qDebug() << "[QMLVIEWER] Clients connected:" << m_clients;
+    qCInfo(lcMain) << "[QMLVIEWER] Clients connected:" << m_clients;
 }
 
 
@@ -453,82 +831,126 @@ void MainController::onClientDisconnected()
     if (m_clients == 0)
         emit notReadyToSend();
 
-    qDebug() << "[QMLVIEWER] Clients connected:" << m_clients;
+    qCInfo(lcMain) << "[QMLVIEWER] Clients connected:" << m_clients;
 }
 
 
-void MainController::setJsonProperty(QString object, QString property, QString value)
+MainController::LookupResult MainController::setJsonProperty(QObject *obj, const ParsedMessage &msg, bool coalesce)
 {
-    QQuickItem *obj =  m_view->rootObject()->findChild<QQuickItem*>(object);
-    if (!obj) {
-        qDebug() << "[QMLVIEWER] no item with objectName:" << object;
-        if (m_enableAck)
-            sendMessage("LUNO");
-        return;
-    }
-
-    //Now lets parse the json
-    QJsonDocument doc(QJsonDocument::fromJson(value.toUtf8()));
+    /* A var property takes the engine's own value, anything else gets the QVariant tree */
+    QMetaProperty metaProperty = m_propertyCache->resolve(obj, msg.property, msg.propertyLength);
     QVariant jsonVariant;
+    bool parsed;
+    if (metaProperty.isValid() && metaProperty.userType() == QMetaType::QVariant)
+        parsed = m_jsonConverter->toScriptValue(msg.value, msg.valueLength, &jsonVariant);
+    else
+        parsed = JsonConverter::toVariant(msg.value, msg.valueLength, &jsonVariant);
 
-    if(!doc.isNull())
+    if (!parsed)
     {
-        if(doc.isObject() || doc.isArray())
-        {
-            jsonVariant = doc.toVariant();
-        }
-        else
-        {
-            qDebug() << "[QMLVIEWER] Document is not an object" << endl;
-            return;
-        }
+        qCWarning(lcMain) << "[QMLVIEWER] Invalid JSON, an object or array is expected...\n" << QByteArray(msg.value, msg.valueLength) << endl;
+        return LookupInvalid;
     }
-    else
-    {
-        qDebug() << "[QMLVIEWER] Invalid JSON...\n" << value << endl;
-        return;
+
+    if (!writeProperty(obj, metaProperty, jsonVariant, coalesce)) {
+        qCWarning(lcMain) << "[QMLVIEWER] no property on objectName:" << QByteArray(msg.property, msg.propertyLength);
+        return LookupNoProperty;
     }
 
-    bool found = obj->setProperty(property.toLatin1(), jsonVariant);
+    return LookupOk;
+}
 
-    if (!found) {
-        if (m_enableAck)
-            sendMessage("LUNP");
-        qDebug() << "[QMLVIEWER] no property on objectName:" << property;
-    }
 
-    if (m_enableAck)
-        sendMessage("LUOK");
+MainController::LookupResult MainController::updateModel(JsonListModel *model, JsonListModel::Operation operation, const ParsedMessage &msg)
+{
+    /* Row operations build on each other, so unlike property values they are never coalesced */
+    QString error;
+    if (!model->apply(operation, msg.value, msg.valueLength, &error)) {
+        qCWarning(lcMain) << "[QMLVIEWER] model update failed on objectName:" << model->objectName() << "."
+                          << QByteArray(msg.property, msg.propertyLength) << ":" << error;
+        return LookupInvalid;
+    }
 
+    m_modelUpdates->add();
+    return LookupOk;
 }
 
 
-void MainController::setProperty(QString object, QString property, QString value)
+MainController::LookupResult MainController::setProperty(QObject *obj, const ParsedMessage &msg, bool coalesce)
 {
-    QQuickItem *obj =  m_view->rootObject()->findChild<QQuickItem*>(object);
-    if (!obj) {
-        qDebug() << "[QMLVIEWER] no item with objectName:" << object;
-        if (m_enableAck)
-            sendMessage("LUNO");
-        return;
+    /* The value is only converted once we know the type of the property. */
+    QMetaProperty metaProperty = m_propertyCache->resolve(obj, msg.property, msg.propertyLength);
+    QVariant value;
+    if (metaProperty.isValid())
+        value = MessageParser::toVariant(msg.value, msg.valueLength, metaProperty.userType());
+
+    if (!writeProperty(obj, metaProperty, value, coalesce)) {
+        qCWarning(lcMain) << "[QMLVIEWER] no property on objectName:" << QByteArray(msg.property, msg.propertyLength);
+        return LookupNoProperty;
     }
 
-    bool found = obj->setProperty(property.toLatin1(), value);
+    return LookupOk;
+}
+
 
-    if (!found) {
-        if (m_enableAck)
-            sendMessage("LUNP");
-        qDebug() << "[QMLVIEWER] no property on objectName:" << property;
+bool MainController::writeProperty(QObject *obj, const QMetaProperty &metaProperty, const QVariant &value, bool coalesce)
+{
+    /* Only declared, writable properties are set. No dynamic properties are created. */
+    if (!metaProperty.isValid())
+        return false;
+
+    m_propertyWrites->add();
+    if (coalesce)
+    {
+        m_coalescer->enqueue(obj, metaProperty, value);
+        return true;
     }
 
-    if (m_enableAck)
-        sendMessage("LUOK");
+    return metaProperty.write(obj, value);
+}
 
+
+MainController::ConnectionMetrics MainController::connectionMetrics(QObject *connection)
+{
+    QHash<QObject*, ConnectionMetrics>::const_iterator it = m_connectionMetrics.constFind(connection);
+    if (it != m_connectionMetrics.constEnd())
+        return it.value();
+
+    /* First message from this connection, register its series. */
+    QString name;
+    if (qobject_cast<SerialServer*>(connection))
+        name = "serial:" + connection->property("portName").toString();
+    else if (qobject_cast<StringServer*>(connection))
+        name = "tcp:" + connection->property("portName").toString();
+    else if (qobject_cast<LocalServer*>(connection))
+        name = "unix:" + connection->property("portName").toString();
+    else if (qobject_cast<UdpServer*>(connection))
+        name = "udp:" + connection->property("portName").toString();
+    else if (qobject_cast<ShmServer*>(connection))
+        name = "shm:" + connection->property("portName").toString();
+    else
+        name = connection ? connection->metaObject()->className() : "direct";
+
+    Metrics *metrics = Metrics::instance();
+    QString labels = Metrics::label("connection", name);
+    ConnectionMetrics entry;
+    entry.messages = metrics->counter("qmlviewer_messages_received_total", "Messages received from a connection.", labels);
+    entry.latency = metrics->histogram("qmlviewer_message_latency_seconds",
+                                                   "Time to handle a message, from dispatch to property write or ack.", labels);
+    m_connectionMetrics.insert(connection, entry);
+    return entry;
 }
 
 
 void MainController::onViewStatusChanged(QQuickView::Status status)
 {
+    /* Index the objectNames of the new scene so lookups don't walk the tree. */
+    if (status == QQuickView::Ready)
+        m_objectIndex->rebuild(m_view->rootObject());
+    else
+        m_objectIndex->clear();
+    m_propertyCache->clear();
+
     /* Emit the signal right away if the serialserver list is greater than 0.                       */
     /* If the serial server list is zero, we wait for TCP/IP connections before we emit the signal. */
     if (status == 1 && m_serialServerList.count() > 0)
@@ -542,6 +964,7 @@ void MainController::showError(QString errorMessage)
 {
     //Load error.qml file and show the user an error message
     m_startUpError = errorMessage;
+    m_objectIndex->clear();
     m_view->setSource(QUrl(QStringLiteral("qrc:/error.qml")));
 #ifdef Q_OS_WIN
     connect(m_errorTimer, SIGNAL(timeout()), this, SLOT(onErrorTimerTimeOut()));
@@ -552,6 +975,7 @@ void MainController::showError(QString errorMessage)
 void MainController::onErrorTimerTimeOut()
 {
     m_errorTimer->stop();
+    m_objectIndex->clear();
     m_view->setSource(QUrl::fromLocalFile(m_mainViewPath));
 #ifdef Q_OS_WIN
     emit readyToSend();
@@ -568,7 +992,7 @@ void MainController::onAppSettingsError(QString msg)
     m_view->rootContext()->setContextProperty("connection",this);
     m_view->rootContext()->setContextProperty("screen", m_screen);
 
-    qDebug() << qPrintable(msg.trimmed());
+    qCWarning(lcMain) << qPrintable(msg.trimmed());
     m_startUpError = msg.trimmed();
     m_view->setSource(QUrl(QStringLiteral("qrc:/error.qml")));
     m_view->show();
@@ -579,12 +1003,12 @@ void MainController::loadLanguageTranslator(QString languageFile)
 {
     QTranslator languageTranslator;
     if (languageTranslator.load(languageFile)) {
-        qDebug() << "[QML] translation file loaded" << languageFile;
+        qCInfo(lcMain) << "[QML] translation file loaded" << languageFile;
         QGuiApplication::installTranslator(&languageTranslator);
         // clear the component cache to allow for translations
         m_view->engine()->clearComponentCache();
     }
     else
-        qDebug() << "[QML] translation file load failed for" << languageFile;
+        qCWarning(lcMain) << "[QML] translation file load failed for" << languageFile;
 
 }
@@ -9,8 +9,12 @@
 #include <QTimer>
 #include <QTranslator>
 #include <QQmlEngine>
+#include <QSet>
 #include "mainview.h"
 #include "stringserver.h"
+#include "localserver.h"
+#include "udpserver.h"
+#include "shmserver.h"
 #include "serialserver.h"
 #include "translator.h"
 #include "systemdefs.h"
@@ -19,6 +23,17 @@
 #include "watchdog.h"
 #include "applicationsettings.h"
 #include "beep.h"
+#include "objectindex.h"
+#include "propertycache.h"
+#include "updatecoalescer.h"
+#include "messageparser.h"
+#include "jsonconverter.h"
+#include "jsonlistmodel.h"
+#include "iothread.h"
+#include "logger.h"
+#include "metrics.h"
+#include "metricsserver.h"
+#include "ackwindow.h"
 
 class MainController : public QObject
 {
@@ -39,6 +54,7 @@ signals:
 public slots:
     Q_INVOKABLE bool sendTCPMessage(QString msg, int port);
     Q_INVOKABLE bool sendSerialMessage(QString msg, QString portName);
+    Q_INVOKABLE bool sendLocalMessage(QString msg, QString path);
     Q_INVOKABLE bool sendMessage(QString msg);
     Q_INVOKABLE void enableHeartbeat(int);
     Q_INVOKABLE void enableHeartbeat(int, QString, QString);
@@ -46,6 +62,7 @@ public slots:
     Q_INVOKABLE void enableLookupAck();
     Q_INVOKABLE void disableLookupAck();
     Q_INVOKABLE QString getStartUpError();
+    Q_INVOKABLE QVariantMap getSerialLinkStats(QString portName);
 
     // Qt signal handler.
     void handleSigTerm();
@@ -60,12 +77,11 @@ private slots:
     void onClientConnected(void);
     void onClientDisconnected(void);
     void onHeartbeatTimerTimeout();
-    void setJsonProperty(QString object, QString property, QString value);
-    void setProperty(QString object, QString property, QString value);
     void onViewStatusChanged(QQuickView::Status status);
     void showError(QString errorMessage);
     void onErrorTimerTimeOut();
     void onAppSettingsError(QString msg);
+    void onAckWindowSend(QString msg);
     void loadLanguageTranslator(QString languageFile);
 
 private:
@@ -75,16 +91,20 @@ private:
     Translator *m_transLator;
     QList<StringServer*> m_stringServerList;\
     QList<SerialServer*> m_serialServerList;
+    QList<LocalServer*> m_localServerList;
+    QList<UdpServer*> m_udpServerList;
+    QList<ShmServer*> m_shmServerList;
+    QList<IoThread*> m_ioThreads;
     qint32 m_clients;
     QMutex m_mutex;
     bool m_parseJSON;
     QObject *m_primaryConnection;
-    QString m_primaryConnectionClassName;
     bool m_enableAck;
     bool m_enableHearbeat;
     bool m_enableTranslator;
     QString m_heartbeatText;
     QString m_heartbeatResponseText;
+    QByteArray m_heartbeatResponseBytes;
     int     m_heartbeat_interval;
     QTimer  *m_hearbeatTimer;
     QString m_startUpError;
@@ -93,6 +113,52 @@ private:
     QString m_mainViewPath;
     ApplicationSettings *m_appSettings;
     Beep *m_beep;
+    ObjectIndex *m_objectIndex;
+    PropertyCache *m_propertyCache;
+    UpdateCoalescer *m_coalescer;
+    JsonConverter *m_jsonConverter;
+    QSet<QObject*> m_coalescingServers;
+    Logger *m_logger;
+    MetricsServer *m_metricsServer;
+    bool m_ackWindowMode;
+    QHash<QObject*, AckWindow*> m_ackWindows;
+
+    struct ConnectionMetrics {
+        MetricCounter *messages;
+        MetricHistogram *latency;
+    };
+
+    QHash<QObject*, ConnectionMetrics> m_connectionMetrics;
+    MetricCounter *m_syntaxErrors;
+    MetricCounter *m_invalidMessages;
+    MetricCounter *m_lookupNoObject;
+    MetricCounter *m_lookupNoProperty;
+    MetricCounter *m_propertyWrites;
+    MetricCounter *m_modelUpdates;
+    MetricCounter *m_ackOk;
+    MetricCounter *m_ackNoObject;
+    MetricCounter *m_ackNoProperty;
+    MetricCounter *m_ackSyntaxError;
+    MetricCounter *m_ackWindowAcks;
+    MetricCounter *m_ackWindowNaks;
+    MetricCounter *m_heartbeatsSent;
+    MetricCounter *m_heartbeatsReceived;
+    MetricCounter *m_heartbeatsMissed;
+
+    enum LookupResult {
+        LookupOk,
+        LookupNoObject,
+        LookupNoProperty,
+        LookupInvalid
+    };
+
+    LookupResult setJsonProperty(QObject *obj, const ParsedMessage &msg, bool coalesce);
+    LookupResult updateModel(JsonListModel *model, JsonListModel::Operation operation, const ParsedMessage &msg);
+    LookupResult setProperty(QObject *obj, const ParsedMessage &msg, bool coalesce);
+    bool writeProperty(QObject *obj, const QMetaProperty &metaProperty, const QVariant &value, bool coalesce);
+    ConnectionMetrics connectionMetrics(QObject *connection);
+    AckWindow *ackWindow(QObject *connection);
+    bool sendToConnection(QObject *connection, const QString &msg);
 };
 
 #endif // MAINCONTROLLER_H
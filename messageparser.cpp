@@ -0,0 +1,351 @@
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <locale.h>
+#include <limits.h>
+#include <QString>
+#include "messageparser.h"
+
+/* Numbers are at most this long, anything longer is handed over as a string. */
+#define MAX_NUMBER_LENGTH 64
+
+static bool isLineEnding(char c)
+{
+    return c == '\r' || c == '\n';
+}
+
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+
+static bool copyNumber(const char *data, int length, char *buffer)
+{
+    if (length == 0 || length >= MAX_NUMBER_LENGTH)
+        return false;
+
+    /* strtol() and friends skip leading blanks and accept hex, we don't. */
+    char c = data[0];
+    if (!(c >= '0' && c <= '9') && c != '-' && c != '+' && c != '.')
+        return false;
+
+    memcpy(buffer, data, length);
+    buffer[length] = '\0';
+    return true;
+}
+
+
+static bool parseLongLong(const char *data, int length, qlonglong *result)
+{
+    char buffer[MAX_NUMBER_LENGTH];
+    if (!copyNumber(data, length, buffer))
+        return false;
+
+    char *end;
+    errno = 0;
+    *result = strtoll(buffer, &end, 10);
+    return errno == 0 && end == buffer + length;
+}
+
+
+static bool parseULongLong(const char *data, int length, qulonglong *result)
+{
+    char buffer[MAX_NUMBER_LENGTH];
+    if (!copyNumber(data, length, buffer) || buffer[0] == '-')
+        return false;
+
+    char *end;
+    errno = 0;
+    *result = strtoull(buffer, &end, 10);
+    return errno == 0 && end == buffer + length;
+}
+
+
+static bool parseDouble(const char *data, int length, double *result)
+{
+    /* QGuiApplication sets the locale from the environment, numbers on the wire always use a '.' */
+    static locale_t cLocale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+
+    char buffer[MAX_NUMBER_LENGTH];
+    if (!copyNumber(data, length, buffer))
+        return false;
+
+    char *end;
+    errno = 0;
+    *result = strtod_l(buffer, &end, cLocale);
+    return errno == 0 && end == buffer + length;
+}
+
+
+static bool equals(const char *data, int length, const char *text)
+{
+    int textLength = strlen(text);
+    return length == textLength && memcmp(data, text, length) == 0;
+}
+
+
+void MessageParser::stripLineEnding(const char **data, int *length)
+{
+    const char *begin = *data;
+    const char *end = begin + *length;
+
+    while (begin < end && isLineEnding(*begin))
+        begin++;
+    while (end > begin && isLineEnding(*(end - 1)))
+        end--;
+
+    *data = begin;
+    *length = end - begin;
+}
+
+
+bool MessageParser::isHeartbeat(const char *data, int length, const QByteArray &response)
+{
+    const char *begin = data;
+    const char *end = data + length;
+
+    while (begin < end && isSpace(*begin))
+        begin++;
+    while (end > begin && isSpace(*(end - 1)))
+        end--;
+
+    return (end - begin) == response.length() && memcmp(begin, response.constData(), end - begin) == 0;
+}
+
+
+bool MessageParser::takeSequence(const char **data, int *length, quint32 *sequence)
+{
+    const char *p = *data;
+    const char *end = p + *length;
+
+    if (p == end || *p != '@')
+        return false;
+    p++;
+
+    /* Up to 10 digits followed by a space or the end of the line */
+    const char *digits = p;
+    quint64 value = 0;
+    while (p < end && *p >= '0' && *p <= '9' && p - digits < 10)
+    {
+        value = value * 10 + (*p - '0');
+        p++;
+    }
+
+    if (p == digits || value > 0xFFFFFFFFu || (p < end && !isSpace(*p)))
+        return false;
+
+    while (p < end && isSpace(*p))
+        p++;
+
+    *sequence = quint32(value);
+    *data = p;
+    *length = end - p;
+    return true;
+}
+
+
+MessageParser::Result MessageParser::parse(const char *data, int length, bool multi, ParsedMessage *msgs, int *count)
+{
+    Result result;
+    *count = 0;
+
+    if (multi)
+    {
+        if (parseBlock(data, length, msgs, count, &result))
+            return result;
+
+        if (parseList(data, length, msgs, count))
+            return Assignment;
+    }
+
+    result = parseAssignment(data, length, msgs);
+    if (result == Assignment)
+        *count = 1;
+    return result;
+}
+
+
+MessageParser::Result MessageParser::parseAssignment(const char *data, int length, ParsedMessage *msg)
+{
+    /* Our protocol is obj.prop=value, the line must contain a '=' and a '.' */
+    const char *equal = static_cast<const char*>(memchr(data, '=', length));
+    if (!equal || !memchr(data, '.', length))
+        return Invalid;
+
+    /* The part before the '=' must have exactly one '.' */
+    int itemLength = equal - data;
+    const char *dot = static_cast<const char*>(memchr(data, '.', itemLength));
+    if (!dot || memchr(dot + 1, '.', itemLength - (dot - data) - 1))
+        return SyntaxError;
+
+    msg->object = data;
+    msg->objectLength = dot - data;
+    msg->property = dot + 1;
+    msg->propertyLength = equal - dot - 1;
+    msg->value = equal + 1;
+    msg->valueLength = length - itemLength - 1;
+
+    if (msg->valueLength == 0)
+        return SyntaxError;
+
+    return Assignment;
+}
+
+
+bool MessageParser::parseBlock(const char *data, int length, ParsedMessage *msgs, int *count, Result *result)
+{
+    /* obj{a=1;b=2}, the '{' must come before any '=' and the object name has no '.' */
+    const char *brace = static_cast<const char*>(memchr(data, '{', length));
+    if (!brace)
+        return false;
+
+    int objectLength = brace - data;
+    if (memchr(data, '=', objectLength) || memchr(data, '.', objectLength))
+        return false;
+
+    *result = SyntaxError;
+    if (objectLength == 0 || data[length - 1] != '}')
+        return true;
+
+    const char *segment = brace + 1;
+    const char *end = data + length - 1;
+
+    while (segment < end)
+    {
+        const char *separator = static_cast<const char*>(memchr(segment, ';', end - segment));
+        if (!separator)
+            separator = end;
+
+        /* Allow a trailing ';' */
+        int segmentLength = separator - segment;
+        if (segmentLength > 0)
+        {
+            const char *equal = static_cast<const char*>(memchr(segment, '=', segmentLength));
+            if (!equal || equal == segment || equal == separator - 1 || memchr(segment, '.', equal - segment))
+                return true;
+
+            if (*count == MaxAssignments)
+                return true;
+
+            ParsedMessage &msg = msgs[*count];
+            msg.object = data;
+            msg.objectLength = objectLength;
+            msg.property = segment;
+            msg.propertyLength = equal - segment;
+            msg.value = equal + 1;
+            msg.valueLength = separator - equal - 1;
+            *count += 1;
+        }
+
+        segment = separator + 1;
+    }
+
+    if (*count > 0)
+        *result = Assignment;
+    return true;
+}
+
+
+bool MessageParser::parseList(const char *data, int length, ParsedMessage *msgs, int *count)
+{
+    /* a.x=1;b.y=2, only if every part is an assignment of its own */
+    if (!memchr(data, ';', length))
+        return false;
+
+    const char *segment = data;
+    const char *end = data + length;
+
+    while (segment < end)
+    {
+        const char *separator = static_cast<const char*>(memchr(segment, ';', end - segment));
+        if (!separator)
+            separator = end;
+
+        int segmentLength = separator - segment;
+        if (segmentLength > 0)
+        {
+            if (*count == MaxAssignments || parseAssignment(segment, segmentLength, &msgs[*count]) != Assignment)
+            {
+                *count = 0;
+                return false;
+            }
+            *count += 1;
+        }
+
+        segment = separator + 1;
+    }
+
+    /* A single assignment with a trailing ';' keeps the ';' in its value like it always did. */
+    if (*count < 2)
+    {
+        *count = 0;
+        return false;
+    }
+
+    return true;
+}
+
+
+QVariant MessageParser::toVariant(const char *data, int length, int userType)
+{
+    /* Numbers are converted here without going through a QString. Anything that
+       doesn't parse cleanly falls back to a string and QMetaProperty::write()
+       does the conversion as it always did. */
+    switch (userType)
+    {
+    case QMetaType::Int:
+    {
+        qlonglong v;
+        if (parseLongLong(data, length, &v) && v >= INT_MIN && v <= INT_MAX)
+            return QVariant(static_cast<int>(v));
+        break;
+    }
+    case QMetaType::UInt:
+    {
+        qulonglong v;
+        if (parseULongLong(data, length, &v) && v <= UINT_MAX)
+            return QVariant(static_cast<uint>(v));
+        break;
+    }
+    case QMetaType::LongLong:
+    {
+        qlonglong v;
+        if (parseLongLong(data, length, &v))
+            return QVariant(v);
+        break;
+    }
+    case QMetaType::ULongLong:
+    {
+        qulonglong v;
+        if (parseULongLong(data, length, &v))
+            return QVariant(v);
+        break;
+    }
+    case QMetaType::Double:
+    {
+        double v;
+        if (parseDouble(data, length, &v))
+            return QVariant(v);
+        break;
+    }
+    case QMetaType::Float:
+    {
+        double v;
+        if (parseDouble(data, length, &v))
+            return QVariant(static_cast<float>(v));
+        break;
+    }
+    case QMetaType::Bool:
+        if (equals(data, length, "true") || equals(data, length, "1"))
+            return QVariant(true);
+        if (equals(data, length, "false") || equals(data, length, "0"))
+            return QVariant(false);
+        break;
+    default:
+        break;
+    }
+
+    return QVariant(QString::fromUtf8(data, length));
+}
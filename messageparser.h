@@ -0,0 +1,61 @@
+#ifndef MESSAGEPARSER_H
+#define MESSAGEPARSER_H
+
+#include <QByteArray>
+#include <QVariant>
+
+/*
+ * Views into an inbound obj.prop=value line. The pointers point into the
+ * buffer that was parsed and are only valid as long as that buffer is.
+ */
+struct ParsedMessage
+{
+    const char *object;
+    int objectLength;
+    const char *property;
+    int propertyLength;
+    const char *value;
+    int valueLength;
+};
+
+/*
+ * Tokenizer for the inbound protocol that works on the raw bytes read from a
+ * server. Nothing is copied or allocated while parsing, the value is only
+ * materialized by toVariant() once the type of the target property is known.
+ *
+ * Besides obj.prop=value a line can carry several assignments when multi is
+ * set:
+ *   obj{a=1;b=2;c=3}    several properties of one object
+ *   a.x=1;b.y=2         several obj.prop=value separated by ';'
+ * A ';' separated line is only taken apart when every part is a valid
+ * obj.prop=value, otherwise it is one assignment whose value contains ';'.
+ *
+ * With windowed acks a line may start with a sequence number, "@1042 a.x=1",
+ * takeSequence() removes it.
+ */
+class MessageParser
+{
+public:
+    enum Result {
+        Assignment,
+        SyntaxError,
+        Invalid
+    };
+
+    enum {
+        MaxAssignments = 64
+    };
+
+    static void stripLineEnding(const char **data, int *length);
+    static bool isHeartbeat(const char *data, int length, const QByteArray &response);
+    static bool takeSequence(const char **data, int *length, quint32 *sequence);
+    static Result parse(const char *data, int length, bool multi, ParsedMessage *msgs, int *count);
+    static QVariant toVariant(const char *data, int length, int userType);
+
+private:
+    static Result parseAssignment(const char *data, int length, ParsedMessage *msg);
+    static bool parseBlock(const char *data, int length, ParsedMessage *msgs, int *count, Result *result);
+    static bool parseList(const char *data, int length, ParsedMessage *msgs, int *count);
+};
+
+#endif // MESSAGEPARSER_H
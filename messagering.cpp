@@ -0,0 +1,60 @@
+#include "messagering.h"
+
+MessageRing::MessageRing(int capacity) :
+    m_head(0)
+  ,m_tail(0)
+{
+    /* One slot is always left empty to tell a full ring from an empty one. */
+    m_size = qMax(capacity, 1) + 1;
+    m_slots = new QByteArray[m_size];
+}
+
+
+MessageRing::~MessageRing()
+{
+    delete[] m_slots;
+}
+
+
+bool MessageRing::push(const QByteArray &ba)
+{
+    int head = m_head.load();
+    int next = (head + 1) % m_size;
+
+    if (next == m_tail.loadAcquire())
+        return false;
+
+    m_slots[head] = ba;
+    m_head.storeRelease(next);
+    return true;
+}
+
+
+bool MessageRing::pop(QByteArray *ba)
+{
+    int tail = m_tail.load();
+
+    if (tail == m_head.loadAcquire())
+        return false;
+
+    /* Release the slot's reference right away, the producer owns the slot after the store. */
+    *ba = m_slots[tail];
+    m_slots[tail] = QByteArray();
+    m_tail.storeRelease((tail + 1) % m_size);
+    return true;
+}
+
+
+int MessageRing::capacity() const
+{
+    return m_size - 1;
+}
+
+
+int MessageRing::count() const
+{
+    int count = m_head.loadAcquire() - m_tail.loadAcquire();
+    if (count < 0)
+        count += m_size;
+    return count;
+}
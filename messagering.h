@@ -0,0 +1,35 @@
+#ifndef MESSAGERING_H
+#define MESSAGERING_H
+
+#include <QByteArray>
+#include <QAtomicInt>
+
+/*
+ * Bounded single-producer/single-consumer ring of messages.
+ *
+ * push() may only be called from one thread and pop() from one other thread.
+ * No locks are taken, the head is only written by the producer and the tail
+ * only by the consumer. QByteArray reference counting is atomic so a message
+ * can be handed from one thread to the other without a deep copy.
+ */
+class MessageRing
+{
+public:
+    explicit MessageRing(int capacity);
+    ~MessageRing();
+
+    bool push(const QByteArray &ba);
+    bool pop(QByteArray *ba);
+    int capacity() const;
+    int count() const;
+
+private:
+    Q_DISABLE_COPY(MessageRing)
+
+    QByteArray *m_slots;
+    int m_size;
+    QAtomicInt m_head;
+    QAtomicInt m_tail;
+};
+
+#endif // MESSAGERING_H
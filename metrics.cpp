@@ -0,0 +1,291 @@
+#include <QGlobalStatic>
+#include "metrics.h"
+
+Q_GLOBAL_STATIC(Metrics, s_metrics)
+
+/* Upper bounds of the histogram buckets in microseconds, the last bucket is +Inf */
+static const qint64 s_bucketBounds[METRIC_HISTOGRAM_BUCKETS] = {
+    50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000
+};
+
+
+int MetricCounter::nextShard()
+{
+    static QAtomicInt next;
+    return next.fetchAndAddRelaxed(1) % METRIC_SHARDS;
+}
+
+
+quint64 MetricCounter::value() const
+{
+    quint64 total = 0;
+    for (int i = 0; i < METRIC_SHARDS; i++)
+        total += m_shards[i].value.loadAcquire();
+    return total;
+}
+
+
+void MetricHistogram::observe(qint64 usecs)
+{
+    int bucket = 0;
+    while (bucket < METRIC_HISTOGRAM_BUCKETS && usecs > s_bucketBounds[bucket])
+        bucket++;
+
+    m_buckets[bucket].fetchAndAddRelaxed(1);
+    m_sum.fetchAndAddRelaxed(usecs > 0 ? quint64(usecs) : 0);
+}
+
+
+quint64 MetricHistogram::count() const
+{
+    quint64 total = 0;
+    for (int i = 0; i <= METRIC_HISTOGRAM_BUCKETS; i++)
+        total += m_buckets[i].loadAcquire();
+    return total;
+}
+
+
+qint64 MetricHistogram::quantile(double q) const
+{
+    /* Upper bound of the bucket holding the quantile, -1 for +Inf or no data */
+    quint64 total = count();
+    if (total == 0)
+        return -1;
+
+    quint64 rank = quint64(q * total + 0.5);
+    quint64 seen = 0;
+    for (int i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += m_buckets[i].loadAcquire();
+        if (seen >= rank && seen > 0)
+            return s_bucketBounds[i];
+    }
+
+    return -1;
+}
+
+
+qint64 MetricHistogram::bucketBound(int bucket)
+{
+    return bucket < METRIC_HISTOGRAM_BUCKETS ? s_bucketBounds[bucket] : -1;
+}
+
+
+Metrics *Metrics::instance()
+{
+    return s_metrics();
+}
+
+
+QString Metrics::label(const QString &key, const QString &value)
+{
+    QString escaped = value;
+    escaped.replace("\\", "\\\\").replace("\"", "\\\"").replace("\n", "\\n");
+    return QString("%1=\"%2\"").arg(key).arg(escaped);
+}
+
+
+Metrics::Metrics(QObject *parent) :
+    QObject(parent)
+{
+}
+
+
+Metrics::~Metrics()
+{
+    foreach (const Family &family, m_families)
+    {
+        foreach (const Series &series, family.series)
+        {
+            if (family.type == Counter)
+                delete static_cast<MetricCounter*>(series.metric);
+            else if (family.type == Gauge)
+                delete static_cast<MetricGauge*>(series.metric);
+            else
+                delete static_cast<MetricHistogram*>(series.metric);
+        }
+    }
+}
+
+
+MetricCounter *Metrics::counter(const QString &name, const QString &help, const QString &labels)
+{
+    QMutexLocker locker(&m_mutex);
+    MetricCounter *metric = static_cast<MetricCounter*>(find(name, labels, Counter));
+    if (!metric)
+    {
+        metric = new MetricCounter;
+        add(name, help, labels, Counter, metric);
+    }
+    return metric;
+}
+
+
+MetricGauge *Metrics::gauge(const QString &name, const QString &help, const QString &labels)
+{
+    QMutexLocker locker(&m_mutex);
+    MetricGauge *metric = static_cast<MetricGauge*>(find(name, labels, Gauge));
+    if (!metric)
+    {
+        metric = new MetricGauge;
+        add(name, help, labels, Gauge, metric);
+    }
+    return metric;
+}
+
+
+MetricHistogram *Metrics::histogram(const QString &name, const QString &help, const QString &labels)
+{
+    QMutexLocker locker(&m_mutex);
+    MetricHistogram *metric = static_cast<MetricHistogram*>(find(name, labels, Histogram));
+    if (!metric)
+    {
+        metric = new MetricHistogram;
+        add(name, help, labels, Histogram, metric);
+    }
+    return metric;
+}
+
+
+QByteArray Metrics::prometheusText() const
+{
+    QString out;
+    QMutexLocker locker(&m_mutex);
+
+    QMap<QString, Family>::const_iterator it;
+    for (it = m_families.constBegin(); it != m_families.constEnd(); ++it)
+    {
+        const QString &name = it.key();
+        const Family &family = it.value();
+
+        out += QString("# HELP %1 %2\n").arg(name).arg(family.help);
+        out += QString("# TYPE %1 %2\n").arg(name)
+                .arg(family.type == Counter ? "counter" : family.type == Gauge ? "gauge" : "histogram");
+
+        foreach (const Series &series, family.series)
+        {
+            QString labels = series.labels.isEmpty() ? QString() : "{" + series.labels + "}";
+
+            if (family.type == Counter)
+                out += QString("%1%2 %3\n").arg(name).arg(labels).arg(static_cast<MetricCounter*>(series.metric)->value());
+            else if (family.type == Gauge)
+                out += QString("%1%2 %3\n").arg(name).arg(labels).arg(static_cast<MetricGauge*>(series.metric)->value());
+            else
+            {
+                /* Prometheus buckets are cumulative and in seconds */
+                const MetricHistogram *histogram = static_cast<MetricHistogram*>(series.metric);
+                QString prefix = series.labels.isEmpty() ? QString() : series.labels + ",";
+                quint64 cumulative = 0;
+
+                for (int i = 0; i <= METRIC_HISTOGRAM_BUCKETS; i++)
+                {
+                    cumulative += histogram->bucketCount(i);
+                    QString bound = i < METRIC_HISTOGRAM_BUCKETS
+                            ? QString::number(MetricHistogram::bucketBound(i) / 1e6, 'g', 6) : QString("+Inf");
+                    out += QString("%1_bucket{%2le=\"%3\"} %4\n").arg(name).arg(prefix).arg(bound).arg(cumulative);
+                }
+                out += QString("%1_sum%2 %3\n").arg(name).arg(labels).arg(QString::number(histogram->sum() / 1e6, 'g', 12));
+                out += QString("%1_count%2 %3\n").arg(name).arg(labels).arg(cumulative);
+            }
+        }
+    }
+
+    return out.toUtf8();
+}
+
+
+QVariantMap Metrics::snapshot() const
+{
+    QVariantMap map;
+    QMutexLocker locker(&m_mutex);
+
+    QMap<QString, Family>::const_iterator it;
+    for (it = m_families.constBegin(); it != m_families.constEnd(); ++it)
+    {
+        foreach (const Series &series, it.value().series)
+        {
+            QString key = series.labels.isEmpty() ? it.key() : it.key() + "{" + series.labels + "}";
+
+            if (it.value().type == Counter)
+                map.insert(key, double(static_cast<MetricCounter*>(series.metric)->value()));
+            else if (it.value().type == Gauge)
+                map.insert(key, double(static_cast<MetricGauge*>(series.metric)->value()));
+            else
+            {
+                const MetricHistogram *histogram = static_cast<MetricHistogram*>(series.metric);
+                QVariantMap values;
+                values.insert("count", double(histogram->count()));
+                values.insert("sum_us", double(histogram->sum()));
+                values.insert("p50_us", double(histogram->quantile(0.5)));
+                values.insert("p99_us", double(histogram->quantile(0.99)));
+                map.insert(key, values);
+            }
+        }
+    }
+
+    return map;
+}
+
+
+double Metrics::value(QString name, QString labels) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    QMap<QString, Family>::const_iterator it = m_families.constFind(name);
+    if (it == m_families.constEnd())
+        return 0;
+
+    foreach (const Series &series, it.value().series)
+    {
+        if (series.labels != labels)
+            continue;
+
+        if (it.value().type == Counter)
+            return double(static_cast<MetricCounter*>(series.metric)->value());
+        else if (it.value().type == Gauge)
+            return double(static_cast<MetricGauge*>(series.metric)->value());
+        else
+            return double(static_cast<MetricHistogram*>(series.metric)->count());
+    }
+
+    return 0;
+}
+
+
+QString Metrics::text() const
+{
+    return QString::fromUtf8(prometheusText());
+}
+
+
+void *Metrics::find(const QString &name, const QString &labels, Type type) const
+{
+    QMap<QString, Family>::const_iterator it = m_families.constFind(name);
+    if (it == m_families.constEnd() || it.value().type != type)
+        return 0;
+
+    foreach (const Series &series, it.value().series)
+    {
+        if (series.labels == labels)
+            return series.metric;
+    }
+
+    return 0;
+}
+
+
+void Metrics::add(const QString &name, const QString &help, const QString &labels, Type type, void *metric)
+{
+    Family &family = m_families[name];
+    Q_ASSERT(family.series.isEmpty() || family.type == type);
+    if (family.series.isEmpty())
+    {
+        family.help = help;
+        family.type = type;
+    }
+
+    Series series;
+    series.labels = labels;
+    series.metric = metric;
+    family.series.append(series);
+}
@@ -0,0 +1,132 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QObject>
+#include <QAtomicInteger>
+#include <QMutex>
+#include <QMap>
+#include <QList>
+#include <QVariantMap>
+
+#define METRIC_SHARDS 8
+#define METRIC_HISTOGRAM_BUCKETS 12
+
+/*
+ * Counter split in per-thread shards, each on its own cache line. Adding is a
+ * relaxed atomic add on the calling thread's shard, reading sums the shards.
+ */
+class MetricCounter
+{
+public:
+    void add(quint64 n = 1) { m_shards[shardIndex()].value.fetchAndAddRelaxed(n); }
+    quint64 value() const;
+
+private:
+    struct alignas(64) Shard
+    {
+        QAtomicInteger<quint64> value;
+    };
+
+    Shard m_shards[METRIC_SHARDS];
+
+    static int nextShard();
+    static int shardIndex()
+    {
+        static thread_local int index = nextShard();
+        return index;
+    }
+};
+
+
+class MetricGauge
+{
+public:
+    void set(qint64 value) { m_value.storeRelease(value); }
+    void add(qint64 n) { m_value.fetchAndAddRelaxed(n); }
+    qint64 value() const { return m_value.loadAcquire(); }
+
+private:
+    QAtomicInteger<qint64> m_value;
+};
+
+
+/*
+ * Latency histogram in microseconds with fixed buckets
+ * (50us ... 250ms and +Inf), buckets are kept non cumulative.
+ */
+class MetricHistogram
+{
+public:
+    void observe(qint64 usecs);
+    quint64 count() const;
+    quint64 sum() const { return m_sum.loadAcquire(); }
+    quint64 bucketCount(int bucket) const { return m_buckets[bucket].loadAcquire(); }
+    qint64 quantile(double q) const;
+
+    static qint64 bucketBound(int bucket);
+
+private:
+    QAtomicInteger<quint64> m_buckets[METRIC_HISTOGRAM_BUCKETS + 1];
+    QAtomicInteger<quint64> m_sum;
+};
+
+
+/*
+ * Process wide registry of metrics.
+ *
+ * Metrics are registered once (that takes a lock) and the returned pointer is
+ * kept by the caller, so updating a metric never locks. Registering the same
+ * name and labels twice returns the same metric. Names follow the Prometheus
+ * conventions, labels are given preformatted, see label().
+ *
+ * Exposed to QML as "metrics" and in Prometheus text format by MetricsServer.
+ */
+class Metrics : public QObject
+{
+    Q_OBJECT
+public:
+    static Metrics *instance();
+    static QString label(const QString &key, const QString &value);
+
+    explicit Metrics(QObject *parent = 0);
+    ~Metrics();
+
+    MetricCounter *counter(const QString &name, const QString &help, const QString &labels = QString());
+    MetricGauge *gauge(const QString &name, const QString &help, const QString &labels = QString());
+    MetricHistogram *histogram(const QString &name, const QString &help, const QString &labels = QString());
+
+    QByteArray prometheusText() const;
+
+public slots:
+    Q_INVOKABLE QVariantMap snapshot() const;
+    Q_INVOKABLE double value(QString name, QString labels = QString()) const;
+    Q_INVOKABLE QString text() const;
+
+private:
+    enum Type {
+        Counter,
+        Gauge,
+        Histogram
+    };
+
+    struct Series
+    {
+        QString labels;
+        void *metric;
+    };
+
+    struct Family
+    {
+        QString help;
+        Type type;
+        QList<Series> series;
+    };
+
+    void *find(const QString &name, const QString &labels, Type type) const;
+    void add(const QString &name, const QString &help, const QString &labels, Type type, void *metric);
+
+    mutable QMutex m_mutex;
+    QMap<QString, Family> m_families;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,113 @@
+#include <QTcpSocket>
+#include <QLocalSocket>
+#include "metricsserver.h"
+#include "metrics.h"
+#include "logging.h"
+
+MetricsServer::MetricsServer(QObject *parent) :
+    QObject(parent)
+  ,m_tcpServer(new QTcpServer(this))
+  ,m_localServer(new QLocalServer(this))
+{
+    connect(m_tcpServer, SIGNAL(newConnection()), this, SLOT(onTcpConnection()));
+    connect(m_localServer, SIGNAL(newConnection()), this, SLOT(onLocalConnection()));
+}
+
+
+MetricsServer::~MetricsServer()
+{
+    m_tcpServer->close();
+    m_localServer->close();
+}
+
+
+bool MetricsServer::listenTcp(int port)
+{
+    /* Never reachable from the outside */
+    if (m_tcpServer->listen(QHostAddress::LocalHost, port))
+    {
+        qCInfo(lcMain) << "[QMLVIEWER] Metrics available on 127.0.0.1 port" << port;
+        return true;
+    }
+
+    qCWarning(lcMain) << "[QMLVIEWER] Error: Metrics server cannot listen on port" << port << m_tcpServer->errorString();
+    return false;
+}
+
+
+bool MetricsServer::listenLocal(const QString &path)
+{
+    /* A stale socket file is left behind when the viewer is killed */
+    QLocalServer::removeServer(path);
+
+    if (m_localServer->listen(path))
+    {
+        qCInfo(lcMain) << "[QMLVIEWER] Metrics available on" << path;
+        return true;
+    }
+
+    qCWarning(lcMain) << "[QMLVIEWER] Error: Metrics server cannot listen on" << path << m_localServer->errorString();
+    return false;
+}
+
+
+void MetricsServer::onTcpConnection()
+{
+    while (m_tcpServer->hasPendingConnections())
+    {
+        QTcpSocket *client = m_tcpServer->nextPendingConnection();
+        connect(client, SIGNAL(disconnected()), client, SLOT(deleteLater()));
+        accept(client);
+    }
+}
+
+
+void MetricsServer::onLocalConnection()
+{
+    while (m_localServer->hasPendingConnections())
+    {
+        QLocalSocket *client = m_localServer->nextPendingConnection();
+        connect(client, SIGNAL(disconnected()), client, SLOT(deleteLater()));
+        accept(client);
+    }
+}
+
+
+void MetricsServer::accept(QIODevice *client)
+{
+    /* Answer once the request comes in, closing before reading it would reset the connection */
+    connect(client, SIGNAL(readyRead()), this, SLOT(onClientReadyRead()));
+    /* Already buffered data doesn't fire readyRead again */
+    if (client->bytesAvailable() > 0)
+        respond(client);
+}
+
+
+void MetricsServer::onClientReadyRead()
+{
+    QIODevice *client = qobject_cast<QIODevice*>(QObject::sender());
+    if (client)
+        respond(client);
+}
+
+
+void MetricsServer::respond(QIODevice *client)
+{
+    client->readAll();
+    disconnect(client, SIGNAL(readyRead()), this, SLOT(onClientReadyRead()));
+
+    QByteArray body = Metrics::instance()->prometheusText();
+    QByteArray response("HTTP/1.0 200 OK\r\n"
+                        "Content-Type: text/plain; version=0.0.4\r\n"
+                        "Connection: close\r\n");
+    response.append("Content-Length: ").append(QByteArray::number(body.size())).append("\r\n\r\n");
+    response.append(body);
+    client->write(response);
+
+    /* Pending data is still written before the connection goes down */
+    QTcpSocket *tcpClient = qobject_cast<QTcpSocket*>(client);
+    if (tcpClient)
+        tcpClient->disconnectFromHost();
+    else
+        static_cast<QLocalSocket*>(client)->disconnectFromServer();
+}
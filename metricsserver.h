@@ -0,0 +1,40 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QLocalServer>
+
+/*
+ * Read-only stats endpoint.
+ *
+ * Listens on a localhost TCP port and/or a Unix socket and answers every
+ * request with the Metrics registry in Prometheus text format wrapped in a
+ * minimal HTTP/1.0 response, then closes the connection. Whatever the client
+ * sends is ignored, so "curl http://127.0.0.1:port/metrics" and
+ * "curl --unix-socket path http://localhost/metrics" both work.
+ */
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MetricsServer(QObject *parent = 0);
+    ~MetricsServer();
+
+    bool listenTcp(int port);
+    bool listenLocal(const QString &path);
+
+private slots:
+    void onTcpConnection();
+    void onLocalConnection();
+    void onClientReadyRead();
+
+private:
+    QTcpServer *m_tcpServer;
+    QLocalServer *m_localServer;
+
+    void accept(QIODevice *client);
+    void respond(QIODevice *client);
+};
+
+#endif // METRICSSERVER_H
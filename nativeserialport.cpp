@@ -0,0 +1,400 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include "nativeserialport.h"
+#include "systemdefs.h"
+#include "logging.h"
+
+static speed_t baudConstant(int baudRate)
+{
+    switch (baudRate)
+    {
+    case 1200: return B1200;
+    case 2400: return B2400;
+    case 4800: return B4800;
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 500000: return B500000;
+    case 921600: return B921600;
+    case 1000000: return B1000000;
+    case 1500000: return B1500000;
+    case 2000000: return B2000000;
+    case 3000000: return B3000000;
+    case 4000000: return B4000000;
+    default: return B0;
+    }
+}
+
+
+NativeSerialPort::NativeSerialPort(const QString &device, const SerialServerSetting &setting, QObject *owner, const char *drainSlot,
+                                   const char *errorSlot, MetricCounter *bytesReceived, MetricCounter *lineOverflows) :
+    m_device(device)
+  ,m_setting(setting)
+  ,m_owner(owner)
+  ,m_drainSlot(drainSlot)
+  ,m_errorSlot(errorSlot)
+  ,m_fd(-1)
+  ,m_epoll(-1)
+  ,m_wake(-1)
+  ,m_fill(0)
+  ,m_scanned(0)
+  ,m_maxLineLength(setting.maxLineLength())
+  ,m_ring(setting.ioRingSize())
+  ,m_drainPending(0)
+  ,m_stop(0)
+  ,m_maxWriteBuffer(setting.sendQueueBytes())
+  ,m_writeArmed(false)
+  ,m_bytesReceived(bytesReceived)
+  ,m_lineOverflows(lineOverflows)
+{
+    /* Room for the longest partial line we keep plus one read, nothing is allocated per read */
+    m_buffer.resize(m_maxLineLength + NATIVE_SERIAL_READ_SIZE);
+
+    m_overflows = Metrics::instance()->counter("qmlviewer_io_ring_overflows_total", "Messages dropped because an I/O ring was full.",
+                                               Metrics::label("thread", "serial-" + m_setting.portName()));
+}
+
+
+NativeSerialPort::~NativeSerialPort()
+{
+    stop();
+
+    if (m_wake >= 0)
+        ::close(m_wake);
+    if (m_epoll >= 0)
+        ::close(m_epoll);
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+
+bool NativeSerialPort::open(QString *error)
+{
+    m_fd = ::open(m_device.toLocal8Bit().constData(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (m_fd < 0)
+    {
+        *error = strerror(errno);
+        return false;
+    }
+
+    /* Like QSerialPort, nobody else may open the port while we have it */
+    ioctl(m_fd, TIOCEXCL);
+
+    if (!configure(error))
+        return false;
+
+    m_epoll = epoll_create1(EPOLL_CLOEXEC);
+    m_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_epoll < 0 || m_wake < 0)
+    {
+        *error = strerror(errno);
+        return false;
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = m_fd;
+    epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_fd, &event);
+    event.data.fd = m_wake;
+    epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake, &event);
+
+    setObjectName("serial-" + m_setting.portName());
+    return true;
+}
+
+
+int NativeSerialPort::handle() const
+{
+    return m_fd;
+}
+
+
+bool NativeSerialPort::configure(QString *error)
+{
+    struct termios tio;
+    if (tcgetattr(m_fd, &tio) < 0)
+    {
+        *error = strerror(errno);
+        return false;
+    }
+
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    /* Readable as soon as a byte is there, vmin and vtime in the settings are applied after this */
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+
+    speed_t speed = baudConstant(m_setting.baudRate());
+    if (speed == B0)
+    {
+        *error = "unsupported baud_rate " + QString::number(m_setting.baudRate());
+        return false;
+    }
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+
+    tio.c_cflag &= ~CSIZE;
+    tio.c_cflag |= m_setting.dataBits() == 7 ? CS7 : CS8;
+
+    tio.c_cflag &= ~(PARENB | PARODD | CMSPAR);
+    QString parity = m_setting.parity();
+    if (parity == "even")
+        tio.c_cflag |= PARENB;
+    else if (parity == "odd")
+        tio.c_cflag |= PARENB | PARODD;
+    else if (parity == "mark")
+        tio.c_cflag |= PARENB | PARODD | CMSPAR;
+    else if (parity == "space")
+        tio.c_cflag |= PARENB | CMSPAR;
+    else if (parity != "none")
+    {
+        *error = "unsupported parity " + parity;
+        return false;
+    }
+
+    if (m_setting.stopBits() == 2)
+        tio.c_cflag |= CSTOPB;
+    else
+        tio.c_cflag &= ~CSTOPB;
+
+    /* Same names as the QSerialPort backend maps them, see SerialServer::getFlowControlEnum() */
+    tio.c_cflag &= ~CRTSCTS;
+    tio.c_iflag &= ~(IXON | IXOFF | IXANY);
+    if (m_setting.flowControl() == "on")
+        tio.c_iflag |= IXON | IXOFF;
+    else if (m_setting.flowControl() == "xon/xoff")
+        tio.c_cflag |= CRTSCTS;
+
+    if (tcsetattr(m_fd, TCSANOW, &tio) < 0)
+    {
+        *error = strerror(errno);
+        return false;
+    }
+
+    return true;
+}
+
+
+void NativeSerialPort::stop()
+{
+    if (!isRunning())
+        return;
+
+    m_stop.storeRelease(1);
+    quint64 one = 1;
+    if (::write(m_wake, &one, sizeof(one)) < 0)
+        qCWarning(lcSerial) << "[QMLVIEWER] Cannot wake the reader of" << m_setting.portName() << ":" << strerror(errno);
+    wait();
+}
+
+
+void NativeSerialPort::run()
+{
+    struct epoll_event events[4];
+
+    while (!m_stop.loadAcquire())
+    {
+        int count = epoll_wait(m_epoll, events, 4, -1);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            fail(QString("epoll_wait failed: ") + strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            if (events[i].data.fd == m_wake)
+            {
+                quint64 value;
+                if (::read(m_wake, &value, sizeof(value)) > 0)
+                    flushWrites();
+                continue;
+            }
+
+            /* A hangup still has data to read, the read then sees the end */
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                readAvailable();
+            if (events[i].events & EPOLLOUT)
+                flushWrites();
+        }
+    }
+}
+
+
+void NativeSerialPort::readAvailable()
+{
+    while (!m_stop.loadAcquire())
+    {
+        ssize_t n = ::read(m_fd, m_buffer.data() + m_fill, m_buffer.size() - m_fill);
+        if (n > 0)
+        {
+            m_bytesReceived->add(n);
+            m_fill += n;
+            frameLines();
+
+            /* One drain is queued at a time, it picks up everything pushed until it runs */
+            if (m_ring.count() > 0 && m_drainPending.testAndSetOrdered(0, 1))
+                QMetaObject::invokeMethod(m_owner, m_drainSlot, Qt::QueuedConnection);
+            continue;
+        }
+
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && errno == EAGAIN)
+            return;
+
+        fail(n == 0 ? QString("hangup") : QString(strerror(errno)));
+        return;
+    }
+}
+
+
+void NativeSerialPort::fail(const QString &reason)
+{
+    /* Nothing reads or writes the tty from here on, the owner counts and logs it */
+    m_stop.storeRelease(1);
+    QMetaObject::invokeMethod(m_owner, m_errorSlot, Qt::QueuedConnection, Q_ARG(QString, reason));
+}
+
+
+void NativeSerialPort::frameLines()
+{
+    char *data = m_buffer.data();
+    int start = 0;
+
+    const char *newline;
+    while ((newline = (const char *)memchr(data + m_scanned, '\n', m_fill - m_scanned)))
+    {
+        int end = newline - data;
+        publish(data + start, end + 1 - start);
+        start = end + 1;
+        m_scanned = start;
+    }
+
+    /* Only the partial line is moved, it is never longer than m_maxLineLength */
+    if (start > 0)
+    {
+        memmove(data, data + start, m_fill - start);
+        m_fill -= start;
+    }
+    m_scanned = m_fill;
+
+    if (m_fill > m_maxLineLength)
+    {
+        qCWarning(lcSerial) << "[QMLVIEWER] Line longer than" << m_maxLineLength << "bytes on" << m_setting.portName() << ", discarded";
+        m_lineOverflows->add();
+        m_fill = 0;
+        m_scanned = 0;
+    }
+}
+
+
+void NativeSerialPort::publish(const char *data, int length)
+{
+    if (!m_ring.push(QByteArray(data, length)))
+    {
+        quint64 before = m_overflows->value();
+        m_overflows->add();
+        /* Don't flood the log, report the first one, the counter has the rest */
+        if (before == 0)
+            qCWarning(lcSerial) << "[QMLVIEWER]" << m_setting.portName() << "ring full, messages dropped";
+    }
+}
+
+
+bool NativeSerialPort::pop(QByteArray *line)
+{
+    return m_ring.pop(line);
+}
+
+
+void NativeSerialPort::drained()
+{
+    /* Reset before popping, anything pushed after this point queues a new drain */
+    m_drainPending.storeRelease(0);
+}
+
+
+qint64 NativeSerialPort::write(const QByteArray &data)
+{
+    QMutexLocker locker(&m_writeMutex);
+
+    /* Nobody flushes for a stopped thread, and a tty that stopped taking bytes doesn't get more than the bound */
+    if (m_stop.loadAcquire() || m_writeBuffer.size() + data.size() > m_maxWriteBuffer)
+        return -1;
+
+    /* Behind bytes the tty didn't take yet, keep the order */
+    if (!m_writeBuffer.isEmpty())
+    {
+        m_writeBuffer.append(data);
+        return data.size();
+    }
+
+    ssize_t n = ::write(m_fd, data.constData(), data.size());
+    if (n < 0 && errno != EAGAIN && errno != EINTR)
+        return -1;
+    if (n < 0)
+        n = 0;
+
+    if (n < data.size())
+    {
+        m_writeBuffer.append(data.constData() + n, data.size() - n);
+        quint64 one = 1;
+        if (::write(m_wake, &one, sizeof(one)) < 0)
+            qCWarning(lcSerial) << "[QMLVIEWER] Cannot wake the writer of" << m_setting.portName() << ":" << strerror(errno);
+    }
+
+    return data.size();
+}
+
+
+void NativeSerialPort::flushWrites()
+{
+    QMutexLocker locker(&m_writeMutex);
+
+    while (!m_writeBuffer.isEmpty())
+    {
+        ssize_t n = ::write(m_fd, m_writeBuffer.constData(), m_writeBuffer.size());
+        if (n > 0)
+            m_writeBuffer.remove(0, n);
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else if (n < 0 && errno == EAGAIN)
+            break;
+        else
+        {
+            qCWarning(lcSerial) << "[QMLVIEWER] Error: write failed on" << m_setting.portName() << ":" << strerror(errno)
+                                << "," << m_writeBuffer.size() << "bytes dropped";
+            m_writeBuffer.clear();
+        }
+    }
+
+    armWrite(!m_writeBuffer.isEmpty());
+}
+
+
+void NativeSerialPort::armWrite(bool enable)
+{
+    if (enable == m_writeArmed)
+        return;
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | (enable ? EPOLLOUT : 0);
+    event.data.fd = m_fd;
+    epoll_ctl(m_epoll, EPOLL_CTL_MOD, m_fd, &event);
+    m_writeArmed = enable;
+}
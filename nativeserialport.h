@@ -0,0 +1,75 @@
+#ifndef NATIVESERIALPORT_H
+#define NATIVESERIALPORT_H
+
+#include <QThread>
+#include <QMutex>
+#include <QAtomicInt>
+#include "applicationsettings.h"
+#include "messagering.h"
+#include "metrics.h"
+
+/*
+ * Serial port backend without QSerialPort, "backend": "native".
+ *
+ * The tty is opened and configured with termios directly. A thread waits in
+ * epoll_wait(), reads into one fixed buffer, splits lines in place and pushes
+ * them into a MessageRing; one drain per batch is queued to the owner, which
+ * pops the ring on its own thread. Writes are tried directly from the caller,
+ * what the tty doesn't take is handed to the thread and written on EPOLLOUT,
+ * up to send_queue_bytes. Once the thread stopped on a hangup or read error
+ * write() fails and the owner's error slot is queued with the reason.
+ *
+ * Line framing only, binary framing stays on the QSerialPort backend.
+ */
+class NativeSerialPort : public QThread
+{
+public:
+    NativeSerialPort(const QString &device, const SerialServerSetting &setting, QObject *owner, const char *drainSlot,
+                     const char *errorSlot, MetricCounter *bytesReceived, MetricCounter *lineOverflows);
+    ~NativeSerialPort();
+
+    bool open(QString *error);
+    int handle() const;
+    void stop();
+
+    qint64 write(const QByteArray &data);
+    bool pop(QByteArray *line);
+    void drained();
+
+protected:
+    void run();
+
+private:
+    QString m_device;
+    SerialServerSetting m_setting;
+    QObject *m_owner;
+    const char *m_drainSlot;
+    const char *m_errorSlot;
+    int m_fd;
+    int m_epoll;
+    int m_wake;
+    QByteArray m_buffer;
+    int m_fill;
+    int m_scanned;
+    int m_maxLineLength;
+    MessageRing m_ring;
+    QAtomicInt m_drainPending;
+    QAtomicInt m_stop;
+    QMutex m_writeMutex;
+    QByteArray m_writeBuffer;
+    qint64 m_maxWriteBuffer;
+    bool m_writeArmed;
+    MetricCounter *m_bytesReceived;
+    MetricCounter *m_lineOverflows;
+    MetricCounter *m_overflows;
+
+    bool configure(QString *error);
+    void readAvailable();
+    void frameLines();
+    void publish(const char *data, int length);
+    void flushWrites();
+    void armWrite(bool enable);
+    void fail(const QString &reason);
+};
+
+#endif // NATIVESERIALPORT_H
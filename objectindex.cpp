@@ -0,0 +1,161 @@
+#include <string.h>
+#include <QQuickItem>
+#include <QDebug>
+#include "objectindex.h"
+#include "logging.h"
+
+ObjectIndex::ObjectIndex(QObject *parent) :
+    QObject(parent)
+{
+}
+
+
+ObjectIndex::~ObjectIndex()
+{
+    clear();
+}
+
+
+void ObjectIndex::rebuild(QObject *root)
+{
+    clear();
+
+    if (!root)
+        return;
+
+    track(root);
+    qCInfo(lcMain) << "[QMLVIEWER] Object index built," << m_index.count() << "named objects.";
+}
+
+
+void ObjectIndex::clear()
+{
+    foreach (QObject *obj, m_tracked)
+        disconnect(obj, 0, this, 0);
+
+    m_tracked.clear();
+    m_names.clear();
+    m_index.clear();
+}
+
+
+QObject *ObjectIndex::find(const char *objectName, int length) const
+{
+    uint hash = qHashBits(objectName, length);
+    QMultiHash<uint, QObject*>::const_iterator it = m_index.constFind(hash);
+
+    while (it != m_index.constEnd() && it.key() == hash)
+    {
+        const QByteArray &name = m_names.constFind(it.value()).value();
+        if (name.length() == length && memcmp(name.constData(), objectName, length) == 0)
+            return it.value();
+        ++it;
+    }
+
+    return 0;
+}
+
+
+int ObjectIndex::count() const
+{
+    return m_index.count();
+}
+
+
+void ObjectIndex::onChildrenChanged()
+{
+    /* Only new children need to be tracked, removed ones report through destroyed() */
+    QObject *obj = QObject::sender();
+    if (obj)
+        scanChildren(obj);
+}
+
+
+void ObjectIndex::onObjectNameChanged(const QString &objectName)
+{
+    QObject *obj = QObject::sender();
+    if (!obj)
+        return;
+
+    removeName(obj);
+    if (!objectName.isEmpty())
+        addName(obj, objectName);
+}
+
+
+void ObjectIndex::onObjectDestroyed(QObject *obj)
+{
+    /* The object is half destroyed at this point, only use it as a key. */
+    m_tracked.remove(obj);
+    removeName(obj);
+}
+
+
+void ObjectIndex::track(QObject *obj)
+{
+    if (!obj || m_tracked.contains(obj))
+        return;
+
+    m_tracked.insert(obj);
+    connect(obj, SIGNAL(destroyed(QObject*)), this, SLOT(onObjectDestroyed(QObject*)));
+    connect(obj, SIGNAL(objectNameChanged(QString)), this, SLOT(onObjectNameChanged(QString)));
+
+    if (qobject_cast<QQuickItem*>(obj))
+        connect(obj, SIGNAL(childrenChanged()), this, SLOT(onChildrenChanged()));
+
+    if (!obj->objectName().isEmpty())
+        addName(obj, obj->objectName());
+
+    scanChildren(obj);
+}
+
+
+void ObjectIndex::scanChildren(QObject *obj)
+{
+    foreach (QObject *child, obj->children())
+        track(child);
+
+    /* Visual children are not always QObject children (Repeater delegates). */
+    QQuickItem *item = qobject_cast<QQuickItem*>(obj);
+    if (item)
+    {
+        foreach (QQuickItem *child, item->childItems())
+            track(child);
+    }
+}
+
+
+void ObjectIndex::addName(QObject *obj, const QString &objectName)
+{
+    QByteArray name = objectName.toUtf8();
+    m_names.insert(obj, name);
+
+    /* Like findChild() the first object with a name wins. */
+    if (!find(name.constData(), name.length()))
+        m_index.insert(qHashBits(name.constData(), name.length()), obj);
+}
+
+
+void ObjectIndex::removeName(QObject *obj)
+{
+    QHash<QObject*, QByteArray>::iterator it = m_names.find(obj);
+    if (it == m_names.end())
+        return;
+
+    QByteArray name = it.value();
+    m_names.erase(it);
+
+    uint hash = qHashBits(name.constData(), name.length());
+    if (m_index.remove(hash, obj) == 0)
+        return;
+
+    /* Promote another object with the same name if there is one. */
+    for (it = m_names.begin(); it != m_names.end(); ++it)
+    {
+        if (it.value() == name)
+        {
+            m_index.insert(hash, it.key());
+            break;
+        }
+    }
+}
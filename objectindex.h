@@ -0,0 +1,50 @@
+#ifndef OBJECTINDEX_H
+#define OBJECTINDEX_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QByteArray>
+
+/*
+ * Index of objectName -> QObject for the loaded QML scene.
+ *
+ * The index is built from the root object when the view is ready and is kept
+ * up to date by watching childrenChanged (Loader, Repeater), objectNameChanged
+ * and destroyed on every tracked object. Non-visual objects (QtObject, timers,
+ * models...) are indexed as well since the whole QObject tree is walked.
+ *
+ * Names are hashed as UTF-8 so a lookup can be done straight from the bytes of
+ * an inbound message without building a QString.
+ */
+class ObjectIndex : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ObjectIndex(QObject *parent = 0);
+    ~ObjectIndex();
+
+    void rebuild(QObject *root);
+    void clear();
+    QObject *find(const char *objectName, int length) const;
+    int count() const;
+
+private slots:
+    void onChildrenChanged();
+    void onObjectNameChanged(const QString &objectName);
+    void onObjectDestroyed(QObject *obj);
+
+private:
+    void track(QObject *obj);
+    void scanChildren(QObject *obj);
+    void addName(QObject *obj, const QString &objectName);
+    void removeName(QObject *obj);
+
+    /* hash of the name -> first object with that name */
+    QMultiHash<uint, QObject*> m_index;
+    QHash<QObject*, QByteArray> m_names;
+    QSet<QObject*> m_tracked;
+};
+
+#endif // OBJECTINDEX_H
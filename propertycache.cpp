@@ -0,0 +1,53 @@
+#include <string.h>
+#include "propertycache.h"
+
+PropertyCache::PropertyCache(QObject *parent) :
+    QObject(parent)
+{
+}
+
+
+QMetaProperty PropertyCache::resolve(QObject *obj, const char *property, int length)
+{
+    QHash<QObject*, QVector<CachedProperty> >::iterator objIt = m_cache.find(obj);
+    if (objIt == m_cache.end())
+    {
+        objIt = m_cache.insert(obj, QVector<CachedProperty>());
+        connect(obj, SIGNAL(destroyed(QObject*)), this, SLOT(onObjectDestroyed(QObject*)));
+    }
+
+    const QVector<CachedProperty> &cached = objIt.value();
+    for (int i = 0; i < cached.count(); i++)
+    {
+        const CachedProperty &entry = cached.at(i);
+        if (entry.name.length() == length && memcmp(entry.name.constData(), property, length) == 0)
+            return entry.property;
+    }
+
+    /* Misses are cached as an invalid QMetaProperty. */
+    CachedProperty entry;
+    entry.name = QByteArray(property, length);
+
+    const QMetaObject *metaObject = obj->metaObject();
+    int index = metaObject->indexOfProperty(entry.name.constData());
+    if (index >= 0 && metaObject->property(index).isWritable())
+        entry.property = metaObject->property(index);
+
+    objIt.value().append(entry);
+    return entry.property;
+}
+
+
+void PropertyCache::clear()
+{
+    foreach (QObject *obj, m_cache.keys())
+        disconnect(obj, SIGNAL(destroyed(QObject*)), this, SLOT(onObjectDestroyed(QObject*)));
+
+    m_cache.clear();
+}
+
+
+void PropertyCache::onObjectDestroyed(QObject *obj)
+{
+    m_cache.remove(obj);
+}
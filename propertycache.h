@@ -0,0 +1,42 @@
+#ifndef PROPERTYCACHE_H
+#define PROPERTYCACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QByteArray>
+#include <QMetaProperty>
+
+/*
+ * Cache of (object, property name) -> QMetaProperty.
+ *
+ * Resolving a property name through the meta-object is a string search, so the
+ * result (including misses) is remembered per object until the object is
+ * destroyed. Writes go straight through QMetaProperty::write() which, unlike
+ * QObject::setProperty(), never creates dynamic properties.
+ *
+ * An object only ever gets a handful of its properties addressed, so they are
+ * kept in a small vector that is scanned with the raw name bytes.
+ */
+class PropertyCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PropertyCache(QObject *parent = 0);
+
+    QMetaProperty resolve(QObject *obj, const char *property, int length);
+    void clear();
+
+private slots:
+    void onObjectDestroyed(QObject *obj);
+
+private:
+    struct CachedProperty {
+        QByteArray name;
+        QMetaProperty property;
+    };
+
+    QHash<QObject*, QVector<CachedProperty> > m_cache;
+};
+
+#endif // PROPERTYCACHE_H
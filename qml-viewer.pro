@@ -1,9 +1,12 @@
 TEMPLATE = app
 
-QT += qml quick network serialport
+QT += qml quick network serialport concurrent
 CONFIG += c++11
 
-LIBS += -lasound
+LIBS += -lasound -lrt
+
+# Shared memory ring, the same files producers build with
+INCLUDEPATH += tools/shmring
 
 VERSION = 2.0.3
 TARGET = qml-viewer
@@ -17,13 +20,37 @@ SOURCES += main.cpp \
     maincontroller.cpp \
     mainview.cpp \
     stringserver.cpp \
+    localserver.cpp \
+    udpserver.cpp \
+    shmserver.cpp \
+    tools/shmring/shmring.c \
+    sendqueue.cpp \
+    streamclients.cpp \
     serialserver.cpp \
+    nativeserialport.cpp \
     translator.cpp \
+    translationrules.cpp \
+    ruleimage.cpp \
+    wildcardrules.cpp \
     screen.cpp \
     settings.cpp \
     watchdog.cpp \
     applicationsettings.cpp \
-    beep.cpp
+    beep.cpp \
+    objectindex.cpp \
+    propertycache.cpp \
+    updatecoalescer.cpp \
+    messageparser.cpp \
+    jsonconverter.cpp \
+    jsonlistmodel.cpp \
+    ackwindow.cpp \
+    messagering.cpp \
+    iothread.cpp \
+    framecodec.cpp \
+    logging.cpp \
+    logger.cpp \
+    metrics.cpp \
+    metricsserver.cpp
 
 RESOURCES += \
     qt.qrc
@@ -35,14 +62,38 @@ HEADERS += \
     maincontroller.h \
     mainview.h \
     stringserver.h \
+    localserver.h \
+    udpserver.h \
+    shmserver.h \
+    tools/shmring/shmring.h \
+    sendqueue.h \
+    streamclients.h \
     systemdefs.h \
     serialserver.h \
+    nativeserialport.h \
     translator.h \
+    translationrules.h \
+    ruleimage.h \
+    wildcardrules.h \
     screen.h \
     settings.h \
     watchdog.h \
     applicationsettings.h \
-    beep.h
+    beep.h \
+    objectindex.h \
+    propertycache.h \
+    updatecoalescer.h \
+    messageparser.h \
+    jsonconverter.h \
+    jsonlistmodel.h \
+    ackwindow.h \
+    messagering.h \
+    iothread.h \
+    framecodec.h \
+    logging.h \
+    logger.h \
+    metrics.h \
+    metricsserver.h
 
 
 OTHER_FILES +=
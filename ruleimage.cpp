@@ -0,0 +1,417 @@
+#include <string.h>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QtEndian>
+#include "ruleimage.h"
+#include "logging.h"
+
+#define RULE_IMAGE_MAGIC "QVTR"
+#define RULE_IMAGE_VERSION 2
+#define RULE_IMAGE_HEADER_SIZE 48
+#define RULE_RECORD_HEADER_SIZE 12
+
+/* Header field offsets */
+#define OFFSET_VERSION 4
+#define OFFSET_SOURCE_SIZE 8
+#define OFFSET_SOURCE_MODIFIED 16
+#define OFFSET_RULE_COUNT 24
+#define OFFSET_BUCKET_COUNT 28
+#define OFFSET_BUCKETS 32
+#define OFFSET_DEFAULTS 36
+#define OFFSET_IMAGE_SIZE 40
+#define OFFSET_WILDCARDS 44
+
+
+static quint32 ruleHash(const QChar *origin, int originLength, const QChar *key, int keyLength)
+{
+    /* FNV-1a over the UTF-16 units of origin, a separator and key, 0 marks an empty bucket */
+    quint32 hash = 2166136261u;
+    for (int i = 0; i < originLength; i++)
+        hash = (hash ^ origin[i].unicode()) * 16777619u;
+    hash = (hash ^ 0xFFFF) * 16777619u;
+    for (int i = 0; i < keyLength; i++)
+        hash = (hash ^ key[i].unicode()) * 16777619u;
+    return hash ? hash : 1;
+}
+
+
+static void appendU16(QByteArray *ba, quint16 value)
+{
+    uchar buf[2];
+    qToLittleEndian(value, buf);
+    ba->append(reinterpret_cast<const char*>(buf), 2);
+}
+
+
+static void appendU32(QByteArray *ba, quint32 value)
+{
+    uchar buf[4];
+    qToLittleEndian(value, buf);
+    ba->append(reinterpret_cast<const char*>(buf), 4);
+}
+
+
+static void appendString(QByteArray *ba, const QString &s)
+{
+    for (int i = 0; i < s.length(); i++)
+        appendU16(ba, s.at(i).unicode());
+}
+
+
+static bool readString(const uchar *data, quint32 size, quint32 *offset, QString *s)
+{
+    if (*offset + 2 > size)
+        return false;
+    quint16 length = qFromLittleEndian<quint16>(data + *offset);
+    *offset += 2;
+    if (*offset + length * 2 > size)
+        return false;
+    *s = QString(reinterpret_cast<const QChar*>(data + *offset), length);
+    *offset += length * 2;
+    return true;
+}
+
+
+static void setU32(QByteArray *ba, int offset, quint32 value)
+{
+    qToLittleEndian(value, reinterpret_cast<uchar*>(ba->data() + offset));
+}
+
+
+RuleImage::RuleImage() :
+    m_data(0)
+  ,m_size(0)
+  ,m_ruleCount(0)
+  ,m_bucketMask(0)
+  ,m_buckets(0)
+{
+}
+
+
+RuleImage::~RuleImage()
+{
+    close();
+}
+
+
+QString RuleImage::imageFileName(const QString &sourceFile)
+{
+    return sourceFile + ".bin";
+}
+
+
+QByteArray RuleImage::build(const TranslationRules &rules, qint64 sourceSize, qint64 sourceModified)
+{
+    QByteArray records;
+    QList<QPair<quint32, quint32> > entries;
+    QStringList defaults;
+    QByteArray wildcards;
+    quint32 wildcardCount = 0;
+
+    QHash<QString, TranslationRules::OriginTable>::const_iterator it;
+    for (it = rules.m_origins.constBegin(); it != rules.m_origins.constEnd(); ++it)
+    {
+        const QString &origin = it.key();
+        if (it.value().hasDefault)
+            defaults << origin;
+
+        foreach (const WildcardRules::Entry &entry, it.value().wildcards.entries())
+        {
+            appendU16(&wildcards, origin.length());
+            appendString(&wildcards, origin);
+            appendU16(&wildcards, entry.pattern.length());
+            appendString(&wildcards, entry.pattern);
+            appendU16(&wildcards, entry.message.length());
+            appendString(&wildcards, entry.message);
+            wildcardCount += 1;
+        }
+
+        foreach (const TranslationRules::Rule &rule, it.value().rules)
+        {
+            /* Offsets are relative to the records section for now */
+            entries << qMakePair(ruleHash(origin.constData(), origin.length(), rule.key.constData(), rule.key.length()),
+                                 quint32(records.size()));
+
+            appendU16(&records, origin.length());
+            appendU16(&records, rule.key.length());
+            appendU16(&records, rule.literals.count());
+            appendU16(&records, 0);
+            appendU32(&records, rule.literalLength);
+            appendString(&records, origin);
+            appendString(&records, rule.key);
+            foreach (const QString &literal, rule.literals)
+            {
+                appendU16(&records, literal.length());
+                appendString(&records, literal);
+            }
+
+            while (records.size() % 4)
+                records.append('\0');
+        }
+    }
+
+    quint32 bucketCount = 8;
+    while (bucketCount < quint32(entries.count()) * 2)
+        bucketCount *= 2;
+
+    quint32 bucketsOffset = RULE_IMAGE_HEADER_SIZE;
+    quint32 recordsOffset = bucketsOffset + bucketCount * 8;
+    quint32 defaultsOffset = recordsOffset + records.size();
+
+    QByteArray image(RULE_IMAGE_HEADER_SIZE, '\0');
+    memcpy(image.data(), RULE_IMAGE_MAGIC, 4);
+    setU32(&image, OFFSET_VERSION, RULE_IMAGE_VERSION);
+    qToLittleEndian(sourceSize, reinterpret_cast<uchar*>(image.data() + OFFSET_SOURCE_SIZE));
+    qToLittleEndian(sourceModified, reinterpret_cast<uchar*>(image.data() + OFFSET_SOURCE_MODIFIED));
+    setU32(&image, OFFSET_RULE_COUNT, entries.count() + wildcardCount);
+    setU32(&image, OFFSET_BUCKET_COUNT, bucketCount);
+    setU32(&image, OFFSET_BUCKETS, bucketsOffset);
+    setU32(&image, OFFSET_DEFAULTS, defaultsOffset);
+
+    /* Linear probing, the table is at most half full */
+    QByteArray buckets(bucketCount * 8, '\0');
+    for (int i = 0; i < entries.count(); i++)
+    {
+        quint32 bucket = entries.at(i).first & (bucketCount - 1);
+        while (qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(buckets.constData() + bucket * 8 + 4)) != 0)
+            bucket = (bucket + 1) & (bucketCount - 1);
+
+        setU32(&buckets, bucket * 8, entries.at(i).first);
+        setU32(&buckets, bucket * 8 + 4, recordsOffset + entries.at(i).second);
+    }
+
+    image.append(buckets);
+    image.append(records);
+
+    appendU32(&image, defaults.count());
+    foreach (const QString &origin, defaults)
+    {
+        appendU16(&image, origin.length());
+        appendString(&image, origin);
+    }
+
+    setU32(&image, OFFSET_WILDCARDS, image.size());
+    appendU32(&image, wildcardCount);
+    image.append(wildcards);
+
+    setU32(&image, OFFSET_IMAGE_SIZE, image.size());
+    return image;
+}
+
+
+bool RuleImage::open(const QString &imageFile, const QString &sourceFile)
+{
+    close();
+
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    /* Strings in the image are compared as raw UTF-16LE */
+    return false;
+#endif
+
+    QFileInfo image(imageFile);
+    QFileInfo source(sourceFile);
+    if (!image.exists() || !source.exists())
+        return false;
+
+    m_file.setFileName(imageFile);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return false;
+
+    qint64 size = m_file.size();
+    if (size < RULE_IMAGE_HEADER_SIZE || size > 0x7FFFFFFF)
+    {
+        close();
+        return false;
+    }
+
+    m_data = m_file.map(0, size);
+    if (!m_data)
+    {
+        close();
+        return false;
+    }
+    m_size = quint32(size);
+
+    quint32 bucketCount = qFromLittleEndian<quint32>(m_data + OFFSET_BUCKET_COUNT);
+    quint32 bucketsOffset = qFromLittleEndian<quint32>(m_data + OFFSET_BUCKETS);
+    quint32 defaultsOffset = qFromLittleEndian<quint32>(m_data + OFFSET_DEFAULTS);
+    quint32 wildcardsOffset = qFromLittleEndian<quint32>(m_data + OFFSET_WILDCARDS);
+
+    bool valid = memcmp(m_data, RULE_IMAGE_MAGIC, 4) == 0
+            && qFromLittleEndian<quint32>(m_data + OFFSET_VERSION) == RULE_IMAGE_VERSION
+            && qFromLittleEndian<quint32>(m_data + OFFSET_IMAGE_SIZE) == m_size
+            && bucketCount > 0 && (bucketCount & (bucketCount - 1)) == 0
+            && bucketsOffset >= RULE_IMAGE_HEADER_SIZE
+            && quint64(bucketsOffset) + quint64(bucketCount) * 8 <= defaultsOffset
+            && quint64(defaultsOffset) + 4 <= wildcardsOffset
+            && quint64(wildcardsOffset) + 4 <= m_size;
+
+    if (!valid)
+    {
+        qCWarning(lcTranslator) << "[TRANSLATE] Ignoring invalid compiled rules" << imageFile;
+        close();
+        return false;
+    }
+
+    /* Rebuild the image when the translate file changed since it was compiled */
+    if (qFromLittleEndian<qint64>(m_data + OFFSET_SOURCE_SIZE) != source.size()
+            || qFromLittleEndian<qint64>(m_data + OFFSET_SOURCE_MODIFIED) != source.lastModified().toMSecsSinceEpoch())
+    {
+        qCWarning(lcTranslator) << "[TRANSLATE] Compiled rules" << imageFile << "are stale, using" << sourceFile;
+        close();
+        return false;
+    }
+
+    m_ruleCount = qFromLittleEndian<quint32>(m_data + OFFSET_RULE_COUNT);
+    m_bucketMask = bucketCount - 1;
+    m_buckets = m_data + bucketsOffset;
+
+    /* Only a handful of origins, read them once */
+    quint32 offset = defaultsOffset;
+    quint32 defaults = qFromLittleEndian<quint32>(m_data + offset);
+    offset += 4;
+    for (quint32 i = 0; i < defaults; i++)
+    {
+        QString origin;
+        if (!readString(m_data, m_size, &offset, &origin))
+            break;
+        m_defaults.insert(origin);
+    }
+
+    /* Wildcard rules are few by nature, their trie is rebuilt in memory */
+    offset = wildcardsOffset;
+    quint32 wildcards = qFromLittleEndian<quint32>(m_data + offset);
+    offset += 4;
+    for (quint32 i = 0; i < wildcards; i++)
+    {
+        QString origin, pattern, message, error;
+        if (!readString(m_data, m_size, &offset, &origin)
+                || !readString(m_data, m_size, &offset, &pattern)
+                || !readString(m_data, m_size, &offset, &message))
+            break;
+        m_wildcards[origin].add(pattern, message, &error);
+    }
+
+    return true;
+}
+
+
+void RuleImage::close()
+{
+    if (m_data)
+        m_file.unmap(const_cast<uchar*>(m_data));
+    if (m_file.isOpen())
+        m_file.close();
+
+    m_data = 0;
+    m_size = 0;
+    m_ruleCount = 0;
+    m_bucketMask = 0;
+    m_buckets = 0;
+    m_defaults.clear();
+    m_wildcards.clear();
+}
+
+
+bool RuleImage::isOpen() const
+{
+    return m_data != 0;
+}
+
+
+int RuleImage::count() const
+{
+    return m_ruleCount;
+}
+
+
+TranslationRules::Result RuleImage::translate(const QString &origin, const QString &message, QString *out) const
+{
+    if (!m_data)
+        return TranslationRules::Miss;
+
+    int pos = message.indexOf('=');
+    QStringRef key = message.leftRef(pos + 1);
+
+    if (!key.isEmpty())
+    {
+        quint32 hash = ruleHash(origin.constData(), origin.length(), key.constData(), key.length());
+
+        quint32 bucket = hash & m_bucketMask;
+        for (quint32 probe = 0; probe <= m_bucketMask; probe++, bucket = (bucket + 1) & m_bucketMask)
+        {
+            const uchar *entry = m_buckets + bucket * 8;
+            quint32 offset = qFromLittleEndian<quint32>(entry + 4);
+            if (offset == 0)
+                break;
+
+            const uchar *record;
+            if (qFromLittleEndian<quint32>(entry) == hash && match(offset, origin, key, &record))
+            {
+                render(record, message.midRef(pos + 1), out);
+                return TranslationRules::Translated;
+            }
+        }
+
+        QHash<QString, WildcardRules>::const_iterator wildcards = m_wildcards.constFind(origin);
+        if (wildcards != m_wildcards.constEnd() && wildcards.value().translate(key, message.midRef(pos + 1), out))
+            return TranslationRules::Translated;
+    }
+
+    if (m_defaults.contains(origin))
+    {
+        *out = message;
+        return TranslationRules::Default;
+    }
+
+    return TranslationRules::Miss;
+}
+
+
+bool RuleImage::match(quint32 offset, const QString &origin, const QStringRef &key, const uchar **record) const
+{
+    if (quint64(offset) + RULE_RECORD_HEADER_SIZE > m_size)
+        return false;
+
+    const uchar *data = m_data + offset;
+    quint16 originLength = qFromLittleEndian<quint16>(data);
+    quint16 keyLength = qFromLittleEndian<quint16>(data + 2);
+    if (originLength != origin.length() || keyLength != key.length())
+        return false;
+
+    const uchar *strings = data + RULE_RECORD_HEADER_SIZE;
+    if (quint64(offset) + RULE_RECORD_HEADER_SIZE + (originLength + keyLength) * 2 > m_size)
+        return false;
+
+    if (memcmp(strings, origin.constData(), originLength * 2) != 0
+            || memcmp(strings + originLength * 2, key.constData(), keyLength * 2) != 0)
+        return false;
+
+    *record = data;
+    return true;
+}
+
+
+void RuleImage::render(const uchar *record, const QStringRef &value, QString *out) const
+{
+    quint16 literalCount = qFromLittleEndian<quint16>(record + 4);
+    quint32 literalLength = qFromLittleEndian<quint32>(record + 8);
+    const uchar *p = record + RULE_RECORD_HEADER_SIZE
+            + (qFromLittleEndian<quint16>(record) + qFromLittleEndian<quint16>(record + 2)) * 2;
+    const uchar *end = m_data + m_size;
+
+    out->clear();
+    out->reserve(literalLength + (literalCount - 1) * value.length());
+    for (int i = 0; i < literalCount && p + 2 <= end; i++)
+    {
+        if (i > 0)
+            out->append(value);
+
+        quint16 length = qFromLittleEndian<quint16>(p);
+        p += 2;
+        if (p + length * 2 > end)
+            break;
+        out->append(reinterpret_cast<const QChar*>(p), length);
+        p += length * 2;
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef RULEIMAGE_H
+#define RULEIMAGE_H
+
+#include <QFile>
+#include <QSet>
+#include <QHash>
+#include <QString>
+#include "translationrules.h"
+
+/*
+ * Compiled translate.txt image, written by tools/translatec and memory-mapped
+ * by the viewer. Nothing is parsed or copied when it is opened, lookups run
+ * straight on the mapped pages, so startup does not depend on the number of
+ * rules and the pages are shared through the page cache.
+ *
+ * Layout, little endian, strings are UTF-16 so they compare against QString
+ * data without conversion:
+ *
+ *   header    "QVTR", version, source size and mtime, rule count,
+ *             bucket count, section offsets, image size
+ *   buckets   open addressing table of {hash, record offset}, at most half full
+ *   records   origin, key and the template split into literals
+ *   defaults  origins that have a default (pass through) rule
+ *   wildcards origin, key and template of the wildcard rules
+ *
+ * The image records the size and modification time of the translate file it
+ * was built from and is ignored when they don't match.
+ */
+class RuleImage
+{
+public:
+    RuleImage();
+    ~RuleImage();
+
+    static QString imageFileName(const QString &sourceFile);
+    static QByteArray build(const TranslationRules &rules, qint64 sourceSize, qint64 sourceModified);
+
+    bool open(const QString &imageFile, const QString &sourceFile);
+    void close();
+    bool isOpen() const;
+    int count() const;
+
+    TranslationRules::Result translate(const QString &origin, const QString &message, QString *out) const;
+
+private:
+    Q_DISABLE_COPY(RuleImage)
+
+    bool match(quint32 offset, const QString &origin, const QStringRef &key, const uchar **record) const;
+    void render(const uchar *record, const QStringRef &value, QString *out) const;
+
+    QFile m_file;
+    const uchar *m_data;
+    quint32 m_size;
+    quint32 m_ruleCount;
+    quint32 m_bucketMask;
+    const uchar *m_buckets;
+    QSet<QString> m_defaults;
+    QHash<QString, WildcardRules> m_wildcards;
+};
+
+#endif // RULEIMAGE_H
@@ -1,4 +1,5 @@
 #include "screen.h"
+#include "logging.h"
 #include <QDebug>
 
 Screen::Screen(QQuickView *view, int screenSaverTimeout, int screenOriginalBrightness, int screenDimBrightness, QObject *parent) :
@@ -53,10 +54,10 @@ bool Screen::save(const QString &path)
         if (!dir.exists())
         {
             if (dir.mkpath(folder))
-                qDebug() << "[QML] created folder" << folder << "for screen save.";
+                qCInfo(lcScreen) << "[QML] created folder" << folder << "for screen save.";
             else
             {
-                qDebug() << "{QML] unable to create folder for screen save." << folder << "make sure path is correct." << path;
+                qCWarning(lcScreen) << "{QML] unable to create folder for screen save." << folder << "make sure path is correct." << path;
                 return false;
             }
         }
@@ -64,18 +65,18 @@ bool Screen::save(const QString &path)
         QImage image = m_view->grabWindow();
         if (image.save(path, 0, 80))
         {
-            qDebug() << "[QML] screen save successful:" << path;
+            qCInfo(lcScreen) << "[QML] screen save successful:" << path;
             return true;
         }
         else
         {
-            qDebug() << "[QML] screen save failed:" << path;
+            qCWarning(lcScreen) << "[QML] screen save failed:" << path;
             return false;
         }
     }
     else
     {
-        qDebug() << "[QML] screen save failed.  Need to provide a folder path:" << path;
+        qCWarning(lcScreen) << "[QML] screen save failed.  Need to provide a folder path:" << path;
         return false;
     }
 }
@@ -155,7 +156,7 @@ void Screen::onTakeSnapShot()
 
     QImage image = m_view->grabWindow();
     if (image.save(path, 0, 100))
-        qDebug() << "[QMLVIEWER] saving snapshot " << SCREENSHOT_PATH << path;
+        qCInfo(lcScreen) << "[QMLVIEWER] saving snapshot " << SCREENSHOT_PATH << path;
 }
 
 
@@ -0,0 +1,129 @@
+#include "sendqueue.h"
+
+SendQueue::SendQueue(qint64 maxBytes, int maxMessages, Policy policy) :
+    m_head(0)
+  ,m_bytes(0)
+  ,m_maxBytes(maxBytes)
+  ,m_maxMessages(maxMessages)
+  ,m_policy(policy)
+  ,m_dropped(0)
+  ,m_coalesced(0)
+{
+}
+
+
+bool SendQueue::policyFromString(const QString &name, Policy *policy)
+{
+    if (name == "drop_oldest")
+        *policy = DropOldest;
+    else if (name == "drop_newest")
+        *policy = DropNewest;
+    else if (name == "coalesce")
+        *policy = Coalesce;
+    else if (name == "disconnect")
+        *policy = Disconnect;
+    else
+        return false;
+
+    return true;
+}
+
+
+bool SendQueue::enqueue(const QByteArray &message)
+{
+    if (m_policy == Coalesce)
+    {
+        QByteArray messageKey = key(message);
+        QHash<QByteArray, qint64>::const_iterator it = messageKey.isEmpty() ? m_keys.constEnd() : m_keys.constFind(messageKey);
+        if (it != m_keys.constEnd())
+        {
+            /* Same key already waiting, only the newest value is worth sending */
+            QByteArray &queued = m_messages[it.value() - m_head];
+            m_bytes += message.size() - queued.size();
+            queued = message;
+            m_coalesced += 1;
+        }
+        else
+        {
+            if (!messageKey.isEmpty())
+                m_keys.insert(messageKey, m_head + m_messages.count());
+            m_messages.append(message);
+            m_bytes += message.size();
+        }
+    }
+    else
+    {
+        /* An empty queue takes any message, the policies are for a client that falls behind */
+        if (!m_messages.isEmpty() && !fits(message.size(), 1))
+        {
+            if (m_policy == Disconnect)
+                return false;
+
+            if (m_policy == DropNewest)
+            {
+                m_dropped += 1;
+                return true;
+            }
+        }
+
+        m_messages.append(message);
+        m_bytes += message.size();
+    }
+
+    /* A single message larger than the limit is still sent */
+    while (m_messages.count() > 1 && !fits(0, 0))
+    {
+        dropFirst();
+        m_dropped += 1;
+    }
+
+    return true;
+}
+
+
+QByteArray SendQueue::take(qint64 maxBytes, int *messages)
+{
+    /* At least one message, then as many whole messages as fit */
+    QByteArray data;
+    *messages = 0;
+    while (!m_messages.isEmpty()
+           && (data.isEmpty() || data.size() + m_messages.first().size() <= maxBytes))
+    {
+        data.append(m_messages.first());
+        dropFirst();
+        *messages += 1;
+    }
+
+    return data;
+}
+
+
+QByteArray SendQueue::key(const QByteArray &message)
+{
+    int pos = message.indexOf('=');
+    return pos > 0 ? message.left(pos + 1) : QByteArray();
+}
+
+
+bool SendQueue::fits(qint64 bytes, int messages) const
+{
+    return m_bytes + bytes <= m_maxBytes && m_messages.count() + messages <= m_maxMessages;
+}
+
+
+void SendQueue::dropFirst()
+{
+    const QByteArray &first = m_messages.first();
+
+    if (m_policy == Coalesce)
+    {
+        QByteArray firstKey = key(first);
+        QHash<QByteArray, qint64>::iterator it = m_keys.find(firstKey);
+        if (it != m_keys.end() && it.value() == m_head)
+            m_keys.erase(it);
+    }
+
+    m_bytes -= first.size();
+    m_messages.removeFirst();
+    m_head += 1;
+}
@@ -0,0 +1,65 @@
+#ifndef SENDQUEUE_H
+#define SENDQUEUE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QHash>
+#include <QString>
+
+/*
+ * Outbound messages of one TCP client that could not be handed to its socket
+ * yet, because the socket already holds as much as it is allowed to.
+ *
+ * The queue is bounded in bytes and in messages, what happens when a new
+ * message doesn't fit depends on the policy:
+ *
+ *   drop_oldest  the oldest queued messages are dropped
+ *   drop_newest  the new message is dropped
+ *   coalesce     a queued message with the same key (the text up to and
+ *                including '=') is replaced in place, then drop_oldest
+ *   disconnect   enqueue() fails and the client is disconnected
+ *
+ * A single message larger than the limits is still queued when the queue is
+ * empty, whatever the policy.
+ */
+class SendQueue
+{
+public:
+    enum Policy {
+        DropOldest,
+        DropNewest,
+        Coalesce,
+        Disconnect
+    };
+
+    SendQueue(qint64 maxBytes, int maxMessages, Policy policy);
+
+    static bool policyFromString(const QString &name, Policy *policy);
+
+    bool enqueue(const QByteArray &message);
+    QByteArray take(qint64 maxBytes, int *messages);
+
+    bool isEmpty() const { return m_messages.isEmpty(); }
+    qint64 bytes() const { return m_bytes; }
+    int count() const { return m_messages.count(); }
+    quint64 dropped() const { return m_dropped; }
+    quint64 coalesced() const { return m_coalesced; }
+
+private:
+    static QByteArray key(const QByteArray &message);
+    bool fits(qint64 bytes, int messages) const;
+    void dropFirst();
+
+    QList<QByteArray> m_messages;
+    /* Key to sequence number of the queued message, the first one is m_head */
+    QHash<QByteArray, qint64> m_keys;
+    qint64 m_head;
+    qint64 m_bytes;
+    qint64 m_maxBytes;
+    int m_maxMessages;
+    Policy m_policy;
+    quint64 m_dropped;
+    quint64 m_coalesced;
+};
+
+#endif // SENDQUEUE_H
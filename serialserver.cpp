@@ -1,9 +1,33 @@
 #include "serialserver.h"
+#include "iothread.h"
+#include "nativeserialport.h"
+#include "logging.h"
 #include <QTimer>
+#include <QThread>
+#include <QFile>
+#include <QFileInfo>
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <string.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+#endif
 
 SerialServer::SerialServer(const SerialServerSetting portInfo, QObject *parent) :
     QObject(parent)
    ,m_server(new QSerialPort(this))
+   ,m_ioThread(0)
+   ,m_binaryFraming(portInfo.framing() == "binary")
+   ,m_frameCodec(portInfo.maxFrameSize())
+   ,m_setting(portInfo)
+   ,m_native(0)
+   ,m_lowLatency(portInfo.lowLatency())
+   ,m_vmin(portInfo.vmin())
+   ,m_vtime(portInfo.vtime())
+   ,m_rxTriggerBytes(portInfo.rxTriggerBytes())
+   ,m_maxLineLength(portInfo.maxLineLength())
+   ,m_scanned(0)
 {
     m_parseJson = portInfo.parseJson();
     m_translate = portInfo.translate();
@@ -11,20 +35,33 @@ SerialServer::SerialServer(const SerialServerSetting portInfo, QObject *parent)
     m_primaryConnection = portInfo.primaryConnection();
     m_portName = portInfo.portName();
 
-    m_server->setPortName(portInfo.linuxVMPort());
-
-    if (QSysInfo::buildCpuArchitecture() == "arm")
-        m_server->setPortName(portInfo.linuxTargetPort());
+    m_device = QSysInfo::buildCpuArchitecture() == "arm" ? portInfo.linuxTargetPort() : portInfo.linuxVMPort();
+    m_server->setPortName(m_device);
 
     m_server->setBaudRate(portInfo.baudRate(), QSerialPort::AllDirections);
     m_server->setStopBits(getStopBitsEnum(portInfo.stopBits()));
     m_server->setParity(getParityEnum(portInfo.parity()));
     m_server->setDataBits(getDataBitsEnum(portInfo.dataBits()));
     m_server->setFlowControl(getFlowControlEnum(portInfo.flowControl()));
+    /* 0 is unlimited, we drain it on every readyRead anyway, a limit only bounds the chunk size */
+    m_server->setReadBufferSize(portInfo.readBufferSize());
+
+    Metrics *metrics = Metrics::instance();
+    QString labels = Metrics::label("connection", "serial:" + m_portName);
+    m_bytesReceived = metrics->counter("qmlviewer_bytes_received_total", "Bytes read from a connection.", labels);
+    m_bytesSent = metrics->counter("qmlviewer_bytes_sent_total", "Bytes written to a connection.", labels);
+    m_messagesSent = metrics->counter("qmlviewer_messages_sent_total", "Messages written to a connection.", labels);
+    m_sendErrors = metrics->counter("qmlviewer_send_errors_total", "Messages that could not be written.", labels);
+    m_portErrors = metrics->counter("qmlviewer_serial_errors_total", "Errors reported by a serial port.", labels);
+    m_frameErrors = metrics->gauge("qmlviewer_frame_errors", "Binary frames rejected by length or CRC.", labels);
+    m_droppedBytes = metrics->gauge("qmlviewer_frame_dropped_bytes", "Bytes discarded while resynchronizing binary frames.", labels);
+    m_lineOverflows = metrics->counter("qmlviewer_serial_line_overflows_total", "Partial lines discarded for exceeding max_line_length.", labels);
 }
 
 SerialServer::~SerialServer()
 {
+    delete m_native;
+
     if(m_server) {
         m_server->close();
         delete(m_server);
@@ -33,9 +70,13 @@ SerialServer::~SerialServer()
 
 bool SerialServer::Start()
 {
+    if (m_setting.backend() == "native")
+        return startNative();
+
     if (m_server->open((QIODevice::ReadWrite)))
     {
-        qDebug() << "[QMLVIEWER] Serial port opened:" << m_server->portName();
+        qCInfo(lcSerial) << "[QMLVIEWER] Serial port opened:" << m_server->portName();
+        applyTtyTuning(m_server->handle(), m_server->portName());
         emit ClientConnected();
         connect(m_server, SIGNAL(readyRead()), this, SLOT(onClientReadyRead()));
         connect(m_server, SIGNAL(error(QSerialPort::SerialPortError)), this, SLOT(onClientError(QSerialPort::SerialPortError)));
@@ -46,29 +87,123 @@ bool SerialServer::Start()
     else
     {
         emit Error("Error with the settings.json file.\nCould not open serial port " + m_server->portName());
-        qDebug() << "{QMLVIEWER] Error: Could not open serial port " << m_server->portName() << m_server->errorString();
+        qCWarning(lcSerial) << "{QMLVIEWER] Error: Could not open serial port " << m_server->portName() << m_server->errorString();
+        return false;
+    }
+
+}
+
+bool SerialServer::startNative()
+{
+    QString error;
+    m_native = new NativeSerialPort(m_device, m_setting, this, "drainNative", "onNativeError", m_bytesReceived, m_lineOverflows);
+    if (!m_native->open(&error))
+    {
+        emit Error("Error with the settings.json file.\nCould not open serial port " + m_device);
+        qCWarning(lcSerial) << "{QMLVIEWER] Error: Could not open serial port " << m_device << error;
+        delete m_native;
+        m_native = 0;
         return false;
     }
 
+    qCInfo(lcSerial) << "[QMLVIEWER] Serial port opened with the native backend:" << m_device;
+    applyTtyTuning(m_native->handle(), QFileInfo(m_device).fileName());
+    m_native->start();
+
+    emit ClientConnected();
+    if (m_primaryConnection)
+        emit PrimaryConnectionAvailable();
+    return true;
+}
+
+
+void SerialServer::drainNative()
+{
+    m_native->drained();
+
+    QByteArray line;
+    while (m_native->pop(&line))
+        deliver(line);
 }
 
+
 int SerialServer::Send(QString msg)
 {
-    msg.append("\r\n");
+    /* The port belongs to the I/O thread when there is one, write from there. */
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "Send", Qt::QueuedConnection, Q_ARG(QString, msg));
+        return msg.length();
+    }
+
     int bytes = 0;
-    if (m_server->isOpen())
+    if (m_native)
     {
-        bytes = m_server->write(msg.toUtf8());
+        bytes = m_native->write(msg.append("\r\n").toUtf8());
         if (bytes > 0)
-            qDebug() << "[QMLVIEWER " << m_portName << " SENT]" << msg;
+        {
+            m_bytesSent->add(bytes);
+            m_messagesSent->add();
+        }
         else
-            qDebug() << "[QMLVIEWER] Error: Message could not be sent:" << msg << ". Check connections.";
+        {
+            m_sendErrors->add();
+            qCWarning(lcSerial) << "[QMLVIEWER] Error: Message could not be sent:" << msg << ". Check connections.";
+        }
+    }
+    else if (m_server->isOpen())
+    {
+        if (m_binaryFraming)
+        {
+            QByteArray frame = FrameCodec::encode(msg.toUtf8());
+            bytes = frame.isEmpty() ? -1 : m_server->write(frame);
+        }
+        else
+            bytes = m_server->write(msg.append("\r\n").toUtf8());
+        if (bytes > 0)
+        {
+            m_bytesSent->add(bytes);
+            m_messagesSent->add();
+            qCDebug(lcSerial) << "[QMLVIEWER " << m_portName << " SENT]" << msg;
+        }
+        else
+        {
+            m_sendErrors->add();
+            qCWarning(lcSerial) << "[QMLVIEWER] Error: Message could not be sent:" << msg << ". Check connections.";
+        }
     }
 
     return bytes;
 }
 
 
+void SerialServer::setIoThread(IoThread *ioThread)
+{
+    m_ioThread = ioThread;
+}
+
+
+const FrameCodec *SerialServer::frameCodec() const
+{
+    return m_binaryFraming ? &m_frameCodec : 0;
+}
+
+
+void SerialServer::dispatchMessage(const QByteArray &ba)
+{
+    emit MessageAvailable(ba, m_parseJson, m_translate, m_translateID);
+}
+
+
+void SerialServer::deliver(const QByteArray &ba)
+{
+    if (m_ioThread)
+        m_ioThread->post(ba);
+    else
+        dispatchMessage(ba);
+}
+
+
 bool SerialServer::getParseJon()
 {
     return m_parseJson;
@@ -94,10 +229,112 @@ QString SerialServer::getPortName()
 
 void SerialServer::onClientReadyRead()
 {
-        while (m_server->bytesAvailable() && m_server->canReadLine()) {
-            QByteArray ba = m_server->readLine();
-            emit MessageAvailable(ba, m_parseJson, m_translate, m_translateID);
+    if (m_binaryFraming)
+    {
+        /* Frames are decoded from whatever arrived, they don't line up with reads. */
+        QByteArray chunk = m_server->readAll();
+        QList<QByteArray> frames;
+        int errors = m_frameCodec.frameErrors();
+        m_bytesReceived->add(chunk.size());
+        m_frameCodec.decode(chunk.constData(), chunk.size(), &frames);
+        m_droppedBytes->set(m_frameCodec.droppedBytes());
+
+        if (m_frameCodec.frameErrors() != errors)
+        {
+            m_frameErrors->set(m_frameCodec.frameErrors());
+            qCWarning(lcSerial) << "[QMLVIEWER]" << m_portName << "frame errors:" << m_frameCodec.frameErrors()
+                     << "resyncs:" << m_frameCodec.resyncs();
         }
+
+        foreach (const QByteArray &frame, frames)
+            deliver(frame);
+        return;
+    }
+
+    /* Read everything and split here, QSerialPort::canReadLine() rescans its whole buffer on every call */
+    QByteArray chunk = m_server->readAll();
+    m_bytesReceived->add(chunk.size());
+    m_readBuffer.append(chunk);
+
+    int start = 0;
+    int end = m_readBuffer.indexOf('\n', m_scanned);
+    while (end >= 0)
+    {
+        deliver(m_readBuffer.mid(start, end + 1 - start));
+        start = end + 1;
+        end = m_readBuffer.indexOf('\n', start);
+    }
+
+    if (start > 0)
+        m_readBuffer.remove(0, start);
+    m_scanned = m_readBuffer.size();
+
+    /* A device that never sends a newline must not grow the buffer forever */
+    if (m_readBuffer.size() > m_maxLineLength)
+    {
+        qCWarning(lcSerial) << "[QMLVIEWER] Line longer than" << m_maxLineLength << "bytes on" << m_portName << ", discarded";
+        m_lineOverflows->add();
+        m_readBuffer.clear();
+        m_scanned = 0;
+    }
+}
+
+
+void SerialServer::applyTtyTuning(int fd, const QString &portName)
+{
+#ifdef Q_OS_LINUX
+    /* Without it the driver may hold received bytes for a tick before pushing them to the tty layer */
+    if (m_lowLatency)
+    {
+        struct serial_struct serial;
+        if (ioctl(fd, TIOCGSERIAL, &serial) < 0)
+            qCWarning(lcSerial) << "[QMLVIEWER]" << portName << "does not support low_latency:" << strerror(errno);
+        else
+        {
+            serial.flags |= ASYNC_LOW_LATENCY;
+            if (ioctl(fd, TIOCSSERIAL, &serial) < 0)
+                qCWarning(lcSerial) << "[QMLVIEWER] Cannot set low_latency on" << portName << ":" << strerror(errno);
+        }
+    }
+
+    /*
+     * The port is non-blocking, VMIN and VTIME decide when the tty reports it readable, so how often readyRead fires.
+     * With a VTIME it is readable as soon as a byte is there and VMIN has no effect, VMIN above 1 without one is
+     * refused by the settings.
+     */
+    if (m_vmin >= 0 || m_vtime >= 0)
+    {
+        struct termios tio;
+        if (tcgetattr(fd, &tio) == 0)
+        {
+            if (m_vmin >= 0)
+                tio.c_cc[VMIN] = m_vmin;
+            if (m_vtime >= 0)
+                tio.c_cc[VTIME] = m_vtime;
+            if (tcsetattr(fd, TCSANOW, &tio) < 0)
+                qCWarning(lcSerial) << "[QMLVIEWER] Cannot set vmin/vtime on" << portName << ":" << strerror(errno);
+        }
+    }
+
+    /* UART receive FIFO interrupt threshold, only some drivers (8250) expose it */
+    if (m_rxTriggerBytes > 0)
+    {
+        QFile trigger("/sys/class/tty/" + QFileInfo(portName).fileName() + "/rx_trig_bytes");
+        if (!trigger.open(QIODevice::WriteOnly | QIODevice::Unbuffered) || trigger.write(QByteArray::number(m_rxTriggerBytes)) < 0)
+            qCWarning(lcSerial) << "[QMLVIEWER] Cannot set rx_trigger_bytes on" << portName << ":" << trigger.errorString();
+    }
+#else
+    Q_UNUSED(fd);
+    if (m_lowLatency || m_vmin >= 0 || m_vtime >= 0 || m_rxTriggerBytes > 0)
+        qCWarning(lcSerial) << "[QMLVIEWER] Tty tuning is only supported on Linux, ignored for" << portName;
+#endif
+}
+
+void SerialServer::onNativeError(const QString &reason)
+{
+    /* Queued from the reader thread once it stopped, writes fail from here on */
+    m_portErrors->add();
+    qCWarning(lcSerial) << "[QMLVIEWER] Serial port" << m_portName << "closed:" << reason;
 }
 
 void SerialServer::onClientError(QSerialPort::SerialPortError error)
@@ -109,7 +346,8 @@ void SerialServer::onClientError(QSerialPort::SerialPortError error)
 
         QString errStr(metaEnum.valueToKey(error));
 
-        qDebug() << errStr;
+        m_portErrors->add();
+        qCWarning(lcSerial) << errStr;
     }
 }
 
@@ -9,6 +9,11 @@
 #include <QMetaEnum>
 #include <QDebug>
 #include "applicationsettings.h"
+#include "framecodec.h"
+#include "metrics.h"
+
+class IoThread;
+class NativeSerialPort;
 
 class SerialServer : public QObject
 {
@@ -23,6 +28,10 @@ public:
     QString getPortName() const {
            return m_portName;
     }
+
+    void setIoThread(IoThread *ioThread);
+    const FrameCodec *frameCodec() const;
+
 signals:
     void MessageAvailable(QByteArray ba, bool parseJson, bool translate, QString translateID);
     void PrimaryConnectionAvailable();
@@ -36,6 +45,7 @@ public slots:
     QString getTranslateID();
     QString getPortName();
     bool Start();
+    void dispatchMessage(const QByteArray &ba);
 
 private slots:
     void onClientReadyRead(void);
@@ -44,6 +54,8 @@ private slots:
     QSerialPort::Parity getParityEnum(QString parity);
     QSerialPort::FlowControl getFlowControlEnum(QString flowControl);
     QSerialPort::DataBits getDataBitsEnum(int dataBits);
+    void drainNative();
+    void onNativeError(const QString &reason);
 
 private:
     QSerialPort *m_server;
@@ -53,7 +65,31 @@ private:
     QString m_translateID;
     bool m_primaryConnection;
     QString m_portName;
+    IoThread *m_ioThread;
+    bool m_binaryFraming;
+    FrameCodec m_frameCodec;
+    SerialServerSetting m_setting;
+    QString m_device;
+    NativeSerialPort *m_native;
+    bool m_lowLatency;
+    int m_vmin;
+    int m_vtime;
+    int m_rxTriggerBytes;
+    int m_maxLineLength;
+    QByteArray m_readBuffer;
+    int m_scanned;
+    MetricCounter *m_bytesReceived;
+    MetricCounter *m_bytesSent;
+    MetricCounter *m_messagesSent;
+    MetricCounter *m_sendErrors;
+    MetricCounter *m_portErrors;
+    MetricGauge *m_frameErrors;
+    MetricGauge *m_droppedBytes;
+    MetricCounter *m_lineOverflows;
 
+    void deliver(const QByteArray &ba);
+    bool startNative();
+    void applyTtyTuning(int fd, const QString &portName);
 };
 
 #endif // SERIALSERVER_H
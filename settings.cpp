@@ -1,4 +1,5 @@
 #include "settings.h"
+#include "logging.h"
 #include <QSettings>
 #include <QDebug>
 
@@ -9,7 +10,7 @@ Settings::Settings(QObject *parent) :
 
 Settings::~Settings()
 {
-    qDebug() << "settings destructor";
+    qCDebug(lcSettings) << "settings destructor";
 }
 
 void Settings::setValue(const QString &key, const QVariant &value)
@@ -17,7 +18,7 @@ void Settings::setValue(const QString &key, const QVariant &value)
     QSettings settings(APPLICATION_SETTINGS_FILE,QSettings::NativeFormat);
     settings.beginGroup(APPLICATION_SETTINGS_SECTION);
     settings.setValue(key, value);
-    qDebug() << "set setting key: " << key << ":" << value ;
+    qCDebug(lcSettings) << "set setting key: " << key << ":" << value ;
     settings.endGroup();
 }
 
@@ -27,7 +28,7 @@ QVariant Settings::getValue(const QString &key, const QVariant &defaultValue) co
     QSettings settings(APPLICATION_SETTINGS_FILE,QSettings::NativeFormat);
     settings.beginGroup(APPLICATION_SETTINGS_SECTION);
     val = settings.value(key, defaultValue);
-    qDebug() << "get setting key: " << key << ":" << val;
+    qCDebug(lcSettings) << "get setting key: " << key << ":" << val;
     settings.endGroup();
     return val;
 }
@@ -37,6 +38,6 @@ void Settings::remove(const QString &key)
     QSettings settings(APPLICATION_SETTINGS_FILE,QSettings::NativeFormat);
     settings.beginGroup(APPLICATION_SETTINGS_SECTION);
     settings.remove(key);
-    qDebug() << "remove setting key: " << key;
+    qCDebug(lcSettings) << "remove setting key: " << key;
     settings.endGroup();
 }
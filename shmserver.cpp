@@ -0,0 +1,166 @@
+#include <errno.h>
+#include <string.h>
+#include "shmserver.h"
+#include "systemdefs.h"
+#include "logging.h"
+
+ShmWaiter::ShmWaiter(ShmServer *server, shmring *ring) :
+    m_server(server)
+  ,m_ring(ring)
+  ,m_stop(0)
+{
+}
+
+
+void ShmWaiter::run()
+{
+    while (!m_stop.loadAcquire())
+    {
+        /* The timeout only bounds how long stop() can take, producers wake us */
+        if (shmring_wait(m_ring, SHM_WAIT_TIMEOUT) <= 0)
+            continue;
+
+        QMetaObject::invokeMethod(m_server, "drain", Qt::QueuedConnection);
+        m_drained.acquire();
+    }
+}
+
+
+void ShmWaiter::stop()
+{
+    m_stop.storeRelease(1);
+    shmring_wake(m_ring);
+    m_drained.release();
+    wait();
+}
+
+
+void ShmWaiter::drained()
+{
+    m_drained.release();
+}
+
+
+ShmServer::ShmServer(QObject *parent, QString name, quint32 size, bool parseJson, bool translate, QString translateID) : QObject(parent)
+  ,m_ring(0)
+  ,m_waiter(0)
+  ,m_continuing(false)
+  ,m_reportedDropped(0)
+  ,m_reportedCorrupt(0)
+{
+    m_name = name;
+    m_size = size;
+    m_parseJson = parseJson;
+    m_translate = translate;
+    m_translateID = translateID;
+
+    Metrics *metrics = Metrics::instance();
+    QString labels = Metrics::label("connection", "shm:" + m_name);
+    m_bytesReceived = metrics->counter("qmlviewer_bytes_received_total", "Bytes read from a connection.", labels);
+    m_wakeups = metrics->counter("qmlviewer_shm_wakeups_total", "Times a shared memory ring went from empty to non-empty.", labels);
+    m_dropped = metrics->counter("qmlviewer_shm_dropped_total", "Records a producer dropped because the shared memory ring was full.",
+                                 labels);
+    m_corrupt = metrics->counter("qmlviewer_shm_corrupt_total", "Invalid records that made the consumer skip a shared memory ring to the producer's head.",
+                                 labels);
+}
+
+
+ShmServer::~ShmServer()
+{
+    if (m_waiter)
+    {
+        m_waiter->stop();
+        delete m_waiter;
+    }
+
+    /* Marks the ring closed, a producer still writing to it reopens */
+    shmring_close(m_ring);
+}
+
+
+bool ShmServer::Start()
+{
+    m_ring = shmring_create(m_name.toLocal8Bit().constData(), m_size);
+    if (!m_ring)
+    {
+        qCWarning(lcShm) << "[QMLVIEWER] Error: cannot create shared memory ring" << m_name << ":" << strerror(errno);
+        return false;
+    }
+
+    m_waiter = new ShmWaiter(this, m_ring);
+    m_waiter->setObjectName("shm-" + m_name);
+    m_waiter->start();
+
+    qCInfo(lcShm) << "[QMLVIEWER] Shared memory ring" << m_name << "ready," << m_size << "bytes";
+    return true;
+}
+
+
+void ShmServer::drain()
+{
+    if (!m_ring)
+        return;
+
+    if (!m_continuing)
+        m_wakeups->add();
+
+    const char *data;
+    quint32 length;
+    qint64 bytes = 0;
+    int count = 0;
+
+    while (count < SHM_DRAIN_BUDGET && shmring_peek(m_ring, &data, &length) > 0)
+    {
+        /* Copied out before the slot runs, the producer reuses the space once it is consumed */
+        QByteArray ba(data, length);
+        shmring_consume(m_ring);
+        bytes += length;
+        count++;
+        emit MessageAvailable(ba, m_parseJson, m_translate, m_translateID);
+    }
+
+    m_bytesReceived->add(bytes);
+
+    quint64 dropped = shmring_dropped(m_ring);
+    if (dropped != m_reportedDropped)
+    {
+        m_dropped->add(dropped - m_reportedDropped);
+        /* Don't flood the log, the counter has the exact number */
+        if (m_reportedDropped == 0)
+            qCWarning(lcShm) << "[QMLVIEWER] Shared memory ring" << m_name << "full, the producer is dropping records";
+        m_reportedDropped = dropped;
+    }
+
+    /* The records up to the producer's head are lost, whatever wrote them can't be trusted */
+    quint64 corrupt = shmring_corrupt(m_ring);
+    if (corrupt != m_reportedCorrupt)
+    {
+        m_corrupt->add(corrupt - m_reportedCorrupt);
+        if (m_reportedCorrupt == 0)
+            qCWarning(lcShm) << "[QMLVIEWER] Shared memory ring" << m_name << "holds an invalid record, skipped to the producer's head";
+        m_reportedCorrupt = corrupt;
+    }
+
+    /* Let the view paint between chunks of a large burst, the waiter stays blocked until the ring is empty */
+    m_continuing = count == SHM_DRAIN_BUDGET;
+    if (m_continuing)
+        QMetaObject::invokeMethod(this, "drain", Qt::QueuedConnection);
+    else
+        m_waiter->drained();
+}
+
+
+QString ShmServer::getName()
+{
+    return m_name;
+}
+
+bool ShmServer::getTranslate()
+{
+    return m_translate;
+}
+
+QString ShmServer::getTranslateID()
+{
+    return m_translateID;
+}
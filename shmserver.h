@@ -0,0 +1,88 @@
+#ifndef SHMSERVER_H
+#define SHMSERVER_H
+
+#include <QObject>
+#include <QThread>
+#include <QAtomicInt>
+#include <QSemaphore>
+#include "shmring.h"
+#include "metrics.h"
+
+class ShmServer;
+
+/*
+ * Sleeps on the ring's futex while it is empty and asks the GUI thread to
+ * drain it when records arrive, then waits until the drain emptied it. A
+ * burst of records costs one wakeup and one queued call, not one per record.
+ */
+class ShmWaiter : public QThread
+{
+public:
+    explicit ShmWaiter(ShmServer *server, shmring *ring);
+
+    void stop();
+    void drained();
+
+protected:
+    void run();
+
+private:
+    ShmServer *m_server;
+    shmring *m_ring;
+    QAtomicInt m_stop;
+    QSemaphore m_drained;
+};
+
+
+/*
+ * Inbound only channel for a data acquisition process on the same module.
+ * The process writes obj.prop=value records into a POSIX shared memory ring
+ * with the shmring library (tools/shmring), the records come out of
+ * MessageAvailable like lines from the other servers. There is nothing to
+ * send back, acks and replies go to the primary connection.
+ */
+class ShmServer : public QObject
+{
+    Q_OBJECT
+
+    Q_PROPERTY(QString portName READ getPortName)
+
+public:
+    explicit ShmServer(QObject *parent = 0, QString name = "", quint32 size = 262144, bool parseJson = false, bool translate = false,
+                       QString translateID = "");
+    ~ShmServer();
+
+    QString getPortName() {
+           return m_name;
+    }
+
+signals:
+    void MessageAvailable(QByteArray ba, bool parseJson, bool translate, QString translateID);
+
+public slots:
+    QString getName();
+    bool getTranslate();
+    QString getTranslateID();
+    bool Start();
+
+private slots:
+    void drain();
+
+private:
+    QString m_name;
+    quint32 m_size;
+    bool m_parseJson;
+    bool m_translate;
+    QString m_translateID;
+    shmring *m_ring;
+    ShmWaiter *m_waiter;
+    bool m_continuing;
+    quint64 m_reportedDropped;
+    quint64 m_reportedCorrupt;
+    MetricCounter *m_bytesReceived;
+    MetricCounter *m_wakeups;
+    MetricCounter *m_dropped;
+    MetricCounter *m_corrupt;
+};
+
+#endif // SHMSERVER_H
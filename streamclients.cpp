@@ -0,0 +1,256 @@
+#include <QLocalSocket>
+#include <QTcpSocket>
+#include "streamclients.h"
+#include "systemdefs.h"
+
+StreamClients::StreamClients(Category category, const QString &kind, const QString &connection, const LineHandler &lineHandler,
+                             QObject *parent) : QObject(parent)
+  ,m_category(category)
+  ,m_lineHandler(lineHandler)
+  ,m_outboundCount(0)
+  ,m_flushScheduled(false)
+  ,m_sendQueueBytes(1048576)
+  ,m_sendQueueMessages(10000)
+  ,m_sendQueuePolicy(SendQueue::DropOldest)
+{
+    Metrics *metrics = Metrics::instance();
+    QString labels = Metrics::label("connection", connection);
+    m_bytesReceived = metrics->counter("qmlviewer_bytes_received_total", "Bytes read from a connection.", labels);
+    m_bytesSent = metrics->counter("qmlviewer_bytes_sent_total", "Bytes written to a connection.", labels);
+    m_messagesSent = metrics->counter("qmlviewer_messages_sent_total", "Messages written to a connection.", labels);
+    m_slowClientDisconnects = metrics->counter("qmlviewer_" + kind + "_slow_client_disconnects_total",
+                                               "Clients disconnected because their send queue was full.", labels);
+}
+
+
+StreamClients::~StreamClients()
+{
+    foreach (const Client &client, m_clients)
+        delete client.queue;
+}
+
+
+void StreamClients::setSendQueue(qint64 maxBytes, int maxMessages, SendQueue::Policy policy)
+{
+    m_sendQueueBytes = maxBytes;
+    m_sendQueueMessages = maxMessages;
+    m_sendQueuePolicy = policy;
+}
+
+
+void StreamClients::add(QIODevice *device, const QString &peer, const QueueMetrics &metrics)
+{
+    connect(device, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    connect(device, SIGNAL(bytesWritten(qint64)), this, SLOT(onBytesWritten(qint64)));
+
+    Client client;
+    client.scanned = 0;
+    client.queue = new SendQueue(m_sendQueueBytes, m_sendQueueMessages, m_sendQueuePolicy);
+    client.peer = peer;
+    client.warned = false;
+    client.reportedBytes = 0;
+    client.reportedDropped = 0;
+    client.reportedCoalesced = 0;
+    client.metrics = metrics;
+    m_clients.insert(device, client);
+}
+
+
+bool StreamClients::remove(QIODevice *device, QString *peer)
+{
+    if (!m_clients.contains(device))
+        return false;
+
+    Client client = m_clients.take(device);
+    disconnect(device, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    disconnect(device, SIGNAL(bytesWritten(qint64)), this, SLOT(onBytesWritten(qint64)));
+
+    client.metrics.queuedBytes->add(-client.reportedBytes);
+    delete client.queue;
+    *peer = client.peer;
+    return true;
+}
+
+
+int StreamClients::count() const
+{
+    return m_clients.size();
+}
+
+
+bool StreamClients::isEmpty() const
+{
+    return m_clients.isEmpty();
+}
+
+
+void StreamClients::send(const QString &msg)
+{
+    if (m_clients.isEmpty())
+        return;
+
+    /* Encoded once for all the clients, the writes happen when control returns to the event loop */
+    m_outbound.append(msg.toLatin1());
+    m_outbound.append("\r\n");
+    m_outboundEnds.append(m_outbound.size());
+    m_outboundCount += 1;
+
+    if (!m_flushScheduled)
+    {
+        m_flushScheduled = true;
+        QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+    }
+}
+
+
+void StreamClients::flush()
+{
+    QByteArray data;
+    data.swap(m_outbound);
+    int messages = m_outboundCount;
+    m_outboundCount = 0;
+    m_flushScheduled = false;
+
+    if (data.isEmpty())
+    {
+        m_outboundEnds.clear();
+        return;
+    }
+
+    /* A client can be aborted below, which removes it from m_clients */
+    QList<QIODevice*> devices = m_clients.keys();
+
+    foreach (QIODevice *device, devices) {
+        QHash<QIODevice*, Client>::iterator it = m_clients.find(device);
+        if (it == m_clients.end() || !device->isOpen())
+            continue;
+
+        /* One write per client for everything sent since the last flush, as long as it keeps up */
+        Client &client = it.value();
+        if (client.queue->isEmpty() && device->bytesToWrite() < TCP_SEND_HIGH_WATER)
+        {
+            qint64 bytes = device->write(data);
+            if (bytes > 0) {
+                m_bytesSent->add(bytes);
+                m_messagesSent->add(messages);
+            }
+            continue;
+        }
+
+        if (!enqueue(client, data))
+        {
+            qCWarning(m_category) << "[QMLVIEWER] Send queue full, disconnecting" << client.peer;
+            m_slowClientDisconnects->add();
+            abort(device);
+        }
+    }
+
+    m_outboundEnds.clear();
+}
+
+
+bool StreamClients::enqueue(Client &client, const QByteArray &data)
+{
+    int start = 0;
+    foreach (int end, m_outboundEnds)
+    {
+        if (!client.queue->enqueue(data.mid(start, end - start)))
+            return false;
+        start = end;
+    }
+
+    if (!client.warned && client.queue->dropped() > 0)
+    {
+        qCWarning(m_category) << "[QMLVIEWER]" << client.peer << "is not reading, dropping messages";
+        client.warned = true;
+    }
+
+    updateQueueMetrics(client);
+    return true;
+}
+
+
+void StreamClients::pump(QIODevice *device, Client &client)
+{
+    /* Keep Qt's write buffer under the high water mark, the rest waits in the bounded queue */
+    while (!client.queue->isEmpty() && device->bytesToWrite() < TCP_SEND_HIGH_WATER)
+    {
+        int messages = 0;
+        qint64 bytes = device->write(client.queue->take(TCP_SEND_HIGH_WATER - device->bytesToWrite(), &messages));
+        if (bytes <= 0)
+            break;
+        m_bytesSent->add(bytes);
+        m_messagesSent->add(messages);
+    }
+
+    updateQueueMetrics(client);
+}
+
+
+void StreamClients::updateQueueMetrics(Client &client)
+{
+    client.metrics.queuedBytes->add(client.queue->bytes() - client.reportedBytes);
+    client.metrics.dropped->add(client.queue->dropped() - client.reportedDropped);
+    client.metrics.coalesced->add(client.queue->coalesced() - client.reportedCoalesced);
+    client.reportedBytes = client.queue->bytes();
+    client.reportedDropped = client.queue->dropped();
+    client.reportedCoalesced = client.queue->coalesced();
+}
+
+
+void StreamClients::abort(QIODevice *device)
+{
+    /* Drop what is buffered, close() would try to write it first */
+    if (QAbstractSocket *socket = qobject_cast<QAbstractSocket*>(device))
+        socket->abort();
+    else if (QLocalSocket *socket = qobject_cast<QLocalSocket*>(device))
+        socket->abort();
+    else
+        device->close();
+}
+
+
+void StreamClients::onReadyRead()
+{
+    /* Only the device that fired is read, its partial line is kept until the rest arrives */
+    QIODevice *device = qobject_cast<QIODevice*>(sender());
+    QHash<QIODevice*, Client>::iterator it = m_clients.find(device);
+    if (it == m_clients.end())
+        return;
+
+    Client &client = it.value();
+    QByteArray data = device->readAll();
+    m_bytesReceived->add(data.size());
+    client.readBuffer.append(data);
+
+    int start = 0;
+    int end = client.readBuffer.indexOf('\n', client.scanned);
+    while (end >= 0)
+    {
+        m_lineHandler(client.readBuffer.mid(start, end + 1 - start));
+        start = end + 1;
+        end = client.readBuffer.indexOf('\n', start);
+    }
+
+    if (start > 0)
+        client.readBuffer.remove(0, start);
+    client.scanned = client.readBuffer.size();
+
+    if (client.readBuffer.size() > TCP_MAX_LINE_LENGTH)
+    {
+        qCWarning(m_category) << "[QMLVIEWER] Line longer than" << TCP_MAX_LINE_LENGTH << "bytes from" << client.peer << ", discarded";
+        client.readBuffer.clear();
+        client.scanned = 0;
+    }
+}
+
+
+void StreamClients::onBytesWritten(qint64 bytes)
+{
+    Q_UNUSED(bytes);
+
+    QIODevice *device = qobject_cast<QIODevice*>(sender());
+    QHash<QIODevice*, Client>::iterator it = m_clients.find(device);
+    if (it != m_clients.end())
+        pump(device, it.value());
+}
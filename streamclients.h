@@ -0,0 +1,97 @@
+#ifndef STREAMCLIENTS_H
+#define STREAMCLIENTS_H
+
+#include <functional>
+#include <QObject>
+#include <QIODevice>
+#include <QHash>
+#include <QVector>
+#include <QLoggingCategory>
+#include "metrics.h"
+#include "sendqueue.h"
+
+/*
+ * The clients of a line based stream server, StringServer (TCP) and
+ * LocalServer (unix socket) share it. Works on the QIODevice of each socket:
+ *
+ *   reading  readyRead is split into '\n' terminated lines, the partial line
+ *            is kept per client and dropped once it passes TCP_MAX_LINE_LENGTH
+ *   sending  send() batches messages until control returns to the event loop
+ *            and writes them to every client at once; a client whose socket
+ *            holds TCP_SEND_HIGH_WATER bytes gets them through its SendQueue,
+ *            pumped on bytesWritten
+ *
+ * The server accepts the sockets, calls add() and remove() and hands lines
+ * on from the line handler. kind ("tcp", "unix") names the server's own
+ * series, connection is their connection label.
+ */
+class StreamClients : public QObject
+{
+    Q_OBJECT
+public:
+    typedef const QLoggingCategory &(*Category)();
+    typedef std::function<void(const QByteArray &)> LineHandler;
+
+    /* Send queue series of one client, may be shared by all of them */
+    struct QueueMetrics {
+        MetricGauge *queuedBytes;
+        MetricCounter *dropped;
+        MetricCounter *coalesced;
+    };
+
+    StreamClients(Category category, const QString &kind, const QString &connection, const LineHandler &lineHandler, QObject *parent = 0);
+    ~StreamClients();
+
+    void setSendQueue(qint64 maxBytes, int maxMessages, SendQueue::Policy policy);
+    void add(QIODevice *device, const QString &peer, const QueueMetrics &metrics);
+    bool remove(QIODevice *device, QString *peer);
+    int count() const;
+    bool isEmpty() const;
+    void send(const QString &msg);
+
+private slots:
+    void flush();
+    void onReadyRead();
+    void onBytesWritten(qint64 bytes);
+
+private:
+    /*
+     * Per client state, looked up by the device that fired. readBuffer holds
+     * the incomplete line, scanned is how much of it is known to have no '\n'.
+     * queue holds what the socket couldn't take yet.
+     */
+    struct Client {
+        QByteArray readBuffer;
+        int scanned;
+        SendQueue *queue;
+        QString peer;
+        bool warned;
+        qint64 reportedBytes;
+        quint64 reportedDropped;
+        quint64 reportedCoalesced;
+        QueueMetrics metrics;
+    };
+
+    Category m_category;
+    LineHandler m_lineHandler;
+    QHash<QIODevice*, Client> m_clients;
+    /* Messages sent during this event loop turn, CRLF terminated, written to every client at once */
+    QByteArray m_outbound;
+    QVector<int> m_outboundEnds;
+    int m_outboundCount;
+    bool m_flushScheduled;
+    qint64 m_sendQueueBytes;
+    int m_sendQueueMessages;
+    SendQueue::Policy m_sendQueuePolicy;
+    MetricCounter *m_bytesReceived;
+    MetricCounter *m_bytesSent;
+    MetricCounter *m_messagesSent;
+    MetricCounter *m_slowClientDisconnects;
+
+    bool enqueue(Client &client, const QByteArray &data);
+    void pump(QIODevice *device, Client &client);
+    void updateQueueMetrics(Client &client);
+    static void abort(QIODevice *device);
+};
+
+#endif // STREAMCLIENTS_H
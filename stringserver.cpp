@@ -1,15 +1,25 @@
 #include <QDebug>
 #include <QTimer>
+#include <QThread>
 #include "stringserver.h"
+#include "iothread.h"
+#include "systemdefs.h"
+#include "logging.h"
 
 StringServer::StringServer(QObject *parent, int port, bool parseJson, bool translate, QString translateID, bool primaryConnection) : QObject(parent)
-  ,m_server(new QTcpServer)
+  ,m_server(new QTcpServer(this))
+  ,m_ioThread(0)
 {
     m_port = port;
     m_parseJson = parseJson;
     m_translate = translate;
     m_translateID = translateID;
     m_primaryConnection = primaryConnection;
+
+    QString connection = "tcp:" + QString::number(m_port);
+    m_clients = new StreamClients(lcTcp, "tcp", connection, [this](const QByteArray &line) { deliver(line); }, this);
+    m_clientCount = Metrics::instance()->gauge("qmlviewer_tcp_clients", "Clients connected to a TCP server.",
+                                               Metrics::label("connection", connection));
 }
 
 
@@ -27,7 +37,9 @@ bool StringServer::Start()
 {
     if (this->m_server->listen(QHostAddress::Any, m_port))
     {
-        qDebug() << "[QMLVIEWER] TCP Server listening on port" << m_port;
+        /* Port 0 lets the system pick one, report the real one */
+        m_port = m_server->serverPort();
+        qCInfo(lcTcp) << "[QMLVIEWER] TCP Server listening on port" << m_port;
         connect(m_server, SIGNAL(newConnection()), this, SLOT(onClientConnected()));
         if (m_primaryConnection)
             emit PrimaryConnectionAvailable();
@@ -35,7 +47,7 @@ bool StringServer::Start()
     }
     else
     {
-        qDebug() << "[QMLVIEWER] Error: TCP Server cannot listen on port" << m_port;
+        qCWarning(lcTcp) << "[QMLVIEWER] Error: TCP Server cannot listen on port" << m_port;
         return false;
     }
 
@@ -44,18 +56,45 @@ bool StringServer::Start()
 
 bool StringServer::Send(QString msg)
 {
-    int count = m_clients.size();
-
-    for(int i = 0; i < count; i++) {
-       if(m_clients[i]->state() == QAbstractSocket::ConnectedState) {
-           m_clients[i]->write(msg.append("\r\n").toLatin1());
-       }
+    /* The sockets belong to the I/O thread when there is one, write from there. */
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "Send", Qt::QueuedConnection, Q_ARG(QString, msg));
+        return true;
     }
 
+    m_clients->send(msg);
     return true;
 }
 
 
+void StringServer::setIoThread(IoThread *ioThread)
+{
+    m_ioThread = ioThread;
+}
+
+
+void StringServer::setSendQueue(qint64 maxBytes, int maxMessages, SendQueue::Policy policy)
+{
+    m_clients->setSendQueue(maxBytes, maxMessages, policy);
+}
+
+
+void StringServer::dispatchMessage(const QByteArray &ba)
+{
+    emit MessageAvailable(ba, m_parseJson, m_translate, m_translateID);
+}
+
+
+void StringServer::deliver(const QByteArray &ba)
+{
+    if (m_ioThread)
+        m_ioThread->post(ba);
+    else
+        dispatchMessage(ba);
+}
+
+
 int StringServer::getPort()
 {
     return m_port;
@@ -74,44 +113,40 @@ QString StringServer::getTranslateID()
 
 void StringServer::onClientConnected()
 {
-    qDebug() << "[QMLVIEWER] Handling new connection.";
+    qCInfo(lcTcp) << "[QMLVIEWER] Handling new connection.";
 
     QTcpSocket *s = m_server->nextPendingConnection();
-    connect(s, SIGNAL(readyRead()), this,SLOT(onClientReadyRead()));
+    /* Messages are short and already batched per event loop turn, don't let Nagle hold them back */
+    s->setSocketOption(QAbstractSocket::LowDelayOption, 1);
     connect(s, SIGNAL(disconnected()), this, SLOT(onClientDisconnected()));
 
-    m_clients.append(s);
-    emit ClientConnected();
-}
+    /* Series are per peer host, monitoring clients reconnect from the same few addresses */
+    Metrics *metrics = Metrics::instance();
+    QString labels = Metrics::label("connection", "tcp:" + QString::number(m_port)) + ","
+            + Metrics::label("client", s->peerAddress().toString());
 
+    StreamClients::QueueMetrics queueMetrics;
+    queueMetrics.queuedBytes = metrics->gauge("qmlviewer_tcp_send_queue_bytes", "Bytes waiting in TCP client send queues.", labels);
+    queueMetrics.dropped = metrics->counter("qmlviewer_tcp_send_dropped_total", "Messages dropped from TCP client send queues.", labels);
+    queueMetrics.coalesced = metrics->counter("qmlviewer_tcp_send_coalesced_total", "Messages replaced by a newer one in TCP client send queues.", labels);
 
-void StringServer::onClientReadyRead()
-{
-    int count = m_clients.size();
-
-    for(int i = 0; i < count; i++) {
-        while (m_clients[i]->bytesAvailable() && m_clients[i]->canReadLine()) {
-            QByteArray ba = m_clients[i]->readLine();
-            emit MessageAvailable(ba, m_parseJson, m_translate, m_translateID);
-        }
-    }
+    m_clients->add(s, "client " + s->peerAddress().toString() + ":" + QString::number(s->peerPort()), queueMetrics);
+    m_clientCount->set(m_clients->count());
+    emit ClientConnected();
 }
 
 
 void StringServer::onClientDisconnected()
 {
-    int count = m_clients.size();
-
-    for(int i = 0; i < count; i++) {
-       if(m_clients[i]->state() == QAbstractSocket::UnconnectedState) {
-           qDebug() << "[QMLVIEWER] Removing client:" << i;
-           disconnect(m_clients[i], SIGNAL(readyRead()), this,SLOT(onClientReadyRead()));
-           disconnect(m_clients[i], SIGNAL(disconnected()), this, SLOT(onClientDisconnected()));
-           m_clients[i]->deleteLater();
-           m_clients.removeAt(i);
-           emit ClientDisconnected();
-           break;
-       }
-    }
-}
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    QString peer;
+    if (!m_clients->remove(socket, &peer))
+        return;
+
+    qCInfo(lcTcp) << "[QMLVIEWER] Removing" << peer;
+    disconnect(socket, SIGNAL(disconnected()), this, SLOT(onClientDisconnected()));
 
+    socket->deleteLater();
+    m_clientCount->set(m_clients->count());
+    emit ClientDisconnected();
+}
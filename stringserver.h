@@ -4,6 +4,11 @@
 #include <QObject>
 #include <QTcpServer>
 #include <QTcpSocket>
+#include "metrics.h"
+#include "sendqueue.h"
+#include "streamclients.h"
+
+class IoThread;
 
 class StringServer : public QObject
 {
@@ -20,6 +25,9 @@ public:
            return m_port;
     }
 
+    void setIoThread(IoThread *ioThread);
+    void setSendQueue(qint64 maxBytes, int maxMessages, SendQueue::Policy policy);
+
 signals:
     void MessageAvailable(QByteArray ba, bool parseJson, bool translate, QString translateID);
     void ClientConnected(void);
@@ -32,21 +40,24 @@ public slots:
     bool getTranslate();
     QString getTranslateID();
     bool Start();
+    void dispatchMessage(const QByteArray &ba);
 
 private slots:
     void onClientConnected(void);
-    void onClientReadyRead(void);
     void onClientDisconnected(void);
 
 private:
     QTcpServer *m_server;
-    QList<QTcpSocket*> m_clients;
+    StreamClients *m_clients;
     int m_port;
     bool m_parseJson;
     bool m_translate;
     QString m_translateID;
     bool m_primaryConnection;
+    IoThread *m_ioThread;
+    MetricGauge *m_clientCount;
 
+    void deliver(const QByteArray &ba);
 };
 
 #endif // STRINGSERVER_H
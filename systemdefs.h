@@ -8,5 +8,16 @@
 #define APPLICATION_SETTINGS_SECTION "Application"
 #define TRANSLATION_FILE_PATH "/application/src/translate.txt"
 #define SETTINGS_FILE "settings.json"
+#define LOG_QUEUE_SIZE 4096
+#define TRANSLATION_RELOAD_DELAY 250
+#define TCP_SEND_HIGH_WATER 65536
+#define TCP_MAX_LINE_LENGTH 1048576
+#define SHM_WAIT_TIMEOUT 100
+#define SHM_DRAIN_BUDGET 256
+#define NATIVE_SERIAL_READ_SIZE 4096
+#define UDP_BATCH 32
+#define UDP_MAX_BATCHES 8
+#define UDP_SEQUENCE_WINDOW 4096
+#define UDP_MAX_SOURCES 256
 
 #endif // SYSTEMDEFS_H
@@ -0,0 +1,316 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "shmring.h"
+
+struct shmring
+{
+    struct shmring_header *header;
+    char *data;
+    size_t size;
+    uint32_t mask;
+    /* Consumer side copies, the header is writable by the producer and is not trusted */
+    uint32_t capacity;
+    uint64_t tail;
+    uint32_t pending;
+    uint64_t corrupt;
+    int owner;
+    char name[NAME_MAX];
+};
+
+typedef char shmring_header_size_check[sizeof(struct shmring_header) == SHMRING_HEADER_SIZE ? 1 : -1];
+
+
+/* Shared futexes, the word lives in a mapping used by two processes */
+static int futex_wait(uint32_t *word, uint32_t value, int timeout_ms)
+{
+    struct timespec timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+    return syscall(SYS_futex, word, FUTEX_WAIT, value, timeout_ms < 0 ? NULL : &timeout, NULL, 0);
+}
+
+
+static void futex_wake(uint32_t *word)
+{
+    syscall(SYS_futex, word, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+
+static uint32_t record_size(uint32_t length)
+{
+    return (4 + length + 3) & ~3u;
+}
+
+
+static shmring *shmring_map(const char *name, int fd, size_t size, int owner)
+{
+    shmring *ring;
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return NULL;
+
+    ring = calloc(1, sizeof(*ring));
+    if (!ring) {
+        munmap(base, size);
+        return NULL;
+    }
+
+    ring->header = base;
+    ring->data = (char *)base + SHMRING_HEADER_SIZE;
+    ring->size = size;
+    ring->owner = owner;
+    strncpy(ring->name, name, sizeof(ring->name) - 1);
+    return ring;
+}
+
+
+shmring *shmring_create(const char *name, uint32_t capacity)
+{
+    shmring *ring;
+    size_t size;
+    int fd;
+
+    /* Power of two so that positions wrap with a mask */
+    if (capacity < 4096 || (capacity & (capacity - 1)) != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    /* A ring left by a previous run may still be mapped by a producer, which then sees it closed */
+    fd = shm_open(name, O_RDWR, 0);
+    if (fd >= 0) {
+        struct shmring_header *old = mmap(NULL, sizeof(*old), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (old != MAP_FAILED) {
+            __atomic_store_n(&old->open, 0, __ATOMIC_RELEASE);
+            munmap(old, sizeof(*old));
+        }
+        close(fd);
+        shm_unlink(name);
+    }
+
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0660);
+    if (fd < 0)
+        return NULL;
+
+    size = SHMRING_HEADER_SIZE + (size_t)capacity;
+    if (ftruncate(fd, size) < 0) {
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+
+    ring = shmring_map(name, fd, size, 1);
+    if (!ring) {
+        shm_unlink(name);
+        return NULL;
+    }
+
+    ring->mask = capacity - 1;
+    ring->capacity = capacity;
+    ring->header->version = SHMRING_VERSION;
+    ring->header->capacity = capacity;
+    ring->header->open = 1;
+    /* Producers check the magic last, the rest of the header is valid once it is set */
+    __atomic_store_n(&ring->header->magic, SHMRING_MAGIC, __ATOMIC_RELEASE);
+    return ring;
+}
+
+
+shmring *shmring_open(const char *name)
+{
+    struct stat st;
+    shmring *ring;
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+        return NULL;
+
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < SHMRING_HEADER_SIZE) {
+        close(fd);
+        errno = EPROTO;
+        return NULL;
+    }
+
+    ring = shmring_map(name, fd, st.st_size, 0);
+    if (!ring)
+        return NULL;
+
+    if (__atomic_load_n(&ring->header->magic, __ATOMIC_ACQUIRE) != SHMRING_MAGIC
+            || ring->header->version != SHMRING_VERSION
+            || SHMRING_HEADER_SIZE + (size_t)ring->header->capacity != ring->size) {
+        shmring_close(ring);
+        errno = EPROTO;
+        return NULL;
+    }
+
+    ring->mask = ring->header->capacity - 1;
+    ring->capacity = ring->header->capacity;
+    return ring;
+}
+
+
+int shmring_write(shmring *ring, const void *data, uint32_t length)
+{
+    struct shmring_header *h = ring->header;
+    uint32_t capacity = h->capacity;
+    uint32_t size = record_size(length);
+    uint64_t head, tail;
+    uint32_t offset, skip;
+
+    if (!__atomic_load_n(&h->open, __ATOMIC_ACQUIRE))
+        return SHMRING_CLOSED;
+    if (size > capacity / 4)
+        return SHMRING_TOO_LARGE;
+
+    head = h->head;
+    tail = __atomic_load_n(&h->tail, __ATOMIC_ACQUIRE);
+    offset = head & ring->mask;
+    skip = capacity - offset < size ? capacity - offset : 0;
+
+    if (capacity - (head - tail) < (uint64_t)skip + size) {
+        __atomic_add_fetch(&h->dropped, 1, __ATOMIC_RELAXED);
+        return SHMRING_FULL;
+    }
+
+    if (skip) {
+        *(uint32_t *)(ring->data + offset) = SHMRING_WRAP;
+        head += skip;
+        offset = 0;
+    }
+
+    *(uint32_t *)(ring->data + offset) = length;
+    memcpy(ring->data + offset + 4, data, length);
+    __atomic_store_n(&h->head, head + size, __ATOMIC_RELEASE);
+
+    /* Pairs with the fence in shmring_wait(), either the consumer sees the new head or we see it waiting */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&h->waiting, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&h->waiting, 0, __ATOMIC_RELAXED);
+        futex_wake(&h->waiting);
+    }
+
+    return SHMRING_OK;
+}
+
+
+int shmring_write_string(shmring *ring, const char *s)
+{
+    return shmring_write(ring, s, strlen(s));
+}
+
+
+/* Nothing the producer wrote may take the consumer outside the data, a bad record resyncs to head */
+static int shmring_corrupted(shmring *ring, uint64_t head)
+{
+    ring->tail = head;
+    ring->pending = 0;
+    ring->corrupt++;
+    __atomic_store_n(&ring->header->tail, head, __ATOMIC_RELEASE);
+    return SHMRING_CORRUPT;
+}
+
+
+int shmring_peek(shmring *ring, const char **data, uint32_t *length)
+{
+    struct shmring_header *h = ring->header;
+    uint32_t capacity = ring->capacity;
+    uint64_t tail = ring->tail;
+    uint64_t head = __atomic_load_n(&h->head, __ATOMIC_ACQUIRE);
+    uint32_t offset, value;
+
+    if (head == tail)
+        return 0;
+    if (head - tail > capacity)
+        return shmring_corrupted(ring, head);
+
+    offset = tail & ring->mask;
+    value = *(volatile uint32_t *)(ring->data + offset);
+    if (value == SHMRING_WRAP) {
+        if (offset == 0 || capacity - offset > head - tail)
+            return shmring_corrupted(ring, head);
+        tail += capacity - offset;
+        ring->tail = tail;
+        __atomic_store_n(&h->tail, tail, __ATOMIC_RELEASE);
+        if (head == tail)
+            return 0;
+        offset = 0;
+        value = *(volatile uint32_t *)ring->data;
+    }
+
+    /* The length is read once, the checks and shmring_consume() use this copy */
+    if (value > capacity / 4 || record_size(value) > head - tail || offset + record_size(value) > capacity)
+        return shmring_corrupted(ring, head);
+
+    ring->pending = record_size(value);
+    *data = ring->data + offset + 4;
+    *length = value;
+    return 1;
+}
+
+
+void shmring_consume(shmring *ring)
+{
+    ring->tail += ring->pending;
+    ring->pending = 0;
+    __atomic_store_n(&ring->header->tail, ring->tail, __ATOMIC_RELEASE);
+}
+
+
+int shmring_wait(shmring *ring, int timeout_ms)
+{
+    struct shmring_header *h = ring->header;
+
+    if (__atomic_load_n(&h->head, __ATOMIC_ACQUIRE) != ring->tail)
+        return 1;
+
+    __atomic_store_n(&h->waiting, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&h->head, __ATOMIC_ACQUIRE) == ring->tail)
+        futex_wait(&h->waiting, 1, timeout_ms);
+    __atomic_store_n(&h->waiting, 0, __ATOMIC_RELAXED);
+
+    return __atomic_load_n(&h->head, __ATOMIC_ACQUIRE) != ring->tail;
+}
+
+
+void shmring_wake(shmring *ring)
+{
+    __atomic_store_n(&ring->header->waiting, 0, __ATOMIC_RELAXED);
+    futex_wake(&ring->header->waiting);
+}
+
+
+uint64_t shmring_corrupt(const shmring *ring)
+{
+    return ring->corrupt;
+}
+
+
+uint64_t shmring_dropped(const shmring *ring)
+{
+    return __atomic_load_n(&ring->header->dropped, __ATOMIC_RELAXED);
+}
+
+
+void shmring_close(shmring *ring)
+{
+    if (!ring)
+        return;
+
+    if (ring->owner) {
+        __atomic_store_n(&ring->header->open, 0, __ATOMIC_RELEASE);
+        shm_unlink(ring->name);
+    }
+
+    munmap(ring->header, ring->size);
+    free(ring);
+}
@@ -0,0 +1,81 @@
+#ifndef SHMRING_H
+#define SHMRING_H
+
+/*
+ * Single producer, single consumer ring of records in POSIX shared memory.
+ *
+ * The viewer creates the ring (shmring_create) and consumes it, a producer
+ * process opens it (shmring_open) and writes one obj.prop=value record per
+ * shmring_write(). Writing and reading are plain memory accesses, the only
+ * syscall is a futex wake when the consumer went to sleep on an empty ring.
+ *
+ * A full ring never blocks the producer, the record is dropped and counted.
+ * When the viewer exits or restarts the ring is marked closed, shmring_write()
+ * then returns SHMRING_CLOSED and the producer should shmring_open() again.
+ *
+ * Layout: a 256 byte header, head, tail and the futex word on their own cache
+ * lines, followed by capacity bytes of data. Records are a 32 bit length and
+ * the bytes, padded to 4 bytes. A record that doesn't fit before the end of
+ * the data is preceded by a wrap marker and written at the start.
+ *
+ * The consumer doesn't trust what the producer writes: a length or position
+ * that would reach outside the data makes shmring_peek() return
+ * SHMRING_CORRUPT and skip everything up to the producer's head.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHMRING_MAGIC 0x52535651u /* "QVSR" */
+#define SHMRING_VERSION 1
+#define SHMRING_HEADER_SIZE 256
+#define SHMRING_WRAP 0xFFFFFFFFu
+
+#define SHMRING_OK 0
+#define SHMRING_FULL -1
+#define SHMRING_TOO_LARGE -2
+#define SHMRING_CLOSED -3
+#define SHMRING_CORRUPT -4
+
+struct shmring_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t open;
+    uint64_t dropped;
+    char pad0[40];
+    uint64_t head;
+    char pad1[56];
+    uint64_t tail;
+    char pad2[56];
+    uint32_t waiting;
+    char pad3[60];
+};
+
+typedef struct shmring shmring;
+
+/* Producer */
+shmring *shmring_open(const char *name);
+int shmring_write(shmring *ring, const void *data, uint32_t length);
+int shmring_write_string(shmring *ring, const char *s);
+
+/* Consumer */
+shmring *shmring_create(const char *name, uint32_t capacity);
+int shmring_peek(shmring *ring, const char **data, uint32_t *length);
+void shmring_consume(shmring *ring);
+int shmring_wait(shmring *ring, int timeout_ms);
+void shmring_wake(shmring *ring);
+uint64_t shmring_dropped(const shmring *ring);
+uint64_t shmring_corrupt(const shmring *ring);
+
+void shmring_close(shmring *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHMRING_H */
@@ -0,0 +1,13 @@
+TEMPLATE = lib
+TARGET = shmring
+
+QT =
+CONFIG += staticlib
+CONFIG -= qt
+
+# Producer side of the shm_servers ingest channel, see shmring.h. Plain C,
+# link it into the data acquisition process or copy the two files.
+LIBS += -lrt
+
+SOURCES += shmring.c
+HEADERS += shmring.h
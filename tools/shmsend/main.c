@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "shmring.h"
+
+/*
+ * Example producer for a shm_servers ring.
+ *
+ *   shmsend /qml-viewer < updates.txt
+ *       writes every line of stdin as one record
+ *
+ *   shmsend /qml-viewer -g tank.level -r 5000 -n 100000
+ *       writes tank.level=<n> for n = 0, 1, ... at 5000 records per second
+ *
+ * Prints how many records were written and dropped because the ring was full.
+ */
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s NAME [-g obj.prop] [-r rate] [-n count]\n", argv0);
+    exit(2);
+}
+
+
+static shmring *reopen(const char *name)
+{
+    shmring *ring;
+    while (!(ring = shmring_open(name)))
+        usleep(100000);
+    return ring;
+}
+
+
+static int send_record(shmring **ring, const char *name, const char *record, unsigned long *dropped)
+{
+    for (;;) {
+        int result = shmring_write_string(*ring, record);
+        if (result == SHMRING_OK)
+            return 1;
+        if (result == SHMRING_FULL) {
+            (*dropped)++;
+            return 0;
+        }
+        if (result == SHMRING_TOO_LARGE) {
+            fprintf(stderr, "record too large, skipped\n");
+            return 0;
+        }
+        /* The viewer restarted, follow it to the new ring */
+        shmring_close(*ring);
+        *ring = reopen(name);
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    const char *name;
+    const char *generate = NULL;
+    long rate = 0;
+    long count = -1;
+    unsigned long written = 0;
+    unsigned long dropped = 0;
+    char record[4096];
+    shmring *ring;
+    int opt;
+
+    if (argc < 2 || argv[1][0] == '-')
+        usage(argv[0]);
+    name = argv[1];
+    optind = 2;
+
+    while ((opt = getopt(argc, argv, "g:r:n:")) != -1) {
+        switch (opt) {
+        case 'g': generate = optarg; break;
+        case 'r': rate = atol(optarg); break;
+        case 'n': count = atol(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+
+    ring = shmring_open(name);
+    if (!ring) {
+        fprintf(stderr, "waiting for %s\n", name);
+        ring = reopen(name);
+    }
+
+    if (generate) {
+        struct timespec start, now;
+        long n;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (n = 0; count < 0 || n < count; n++) {
+            if (rate > 0) {
+                /* Sleep until record n is due, not a fixed delay, so the rate holds on a busy machine */
+                long long due = n * 1000000000LL / rate;
+                long long elapsed;
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                elapsed = (now.tv_sec - start.tv_sec) * 1000000000LL + (now.tv_nsec - start.tv_nsec);
+                if (due > elapsed)
+                    usleep((due - elapsed) / 1000);
+            }
+            snprintf(record, sizeof(record), "%s=%ld", generate, n);
+            written += send_record(&ring, name, record, &dropped);
+        }
+    } else {
+        while (fgets(record, sizeof(record), stdin)) {
+            record[strcspn(record, "\r\n")] = 0;
+            if (record[0])
+                written += send_record(&ring, name, record, &dropped);
+        }
+    }
+
+    printf("%lu written, %lu dropped\n", written, dropped);
+    shmring_close(ring);
+    return 0;
+}
@@ -0,0 +1,17 @@
+TEMPLATE = app
+TARGET = shmsend
+
+QT =
+CONFIG += console
+CONFIG -= qt app_bundle
+
+# Writes stdin lines, or generated values, into a shm_servers ring.
+INCLUDEPATH += ../shmring
+LIBS += -lrt
+
+SOURCES += \
+    main.c \
+    ../shmring/shmring.c
+
+HEADERS += \
+    ../shmring/shmring.h
@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSaveFile>
+#include "translationrules.h"
+#include "ruleimage.h"
+
+/*
+ * Compiles translate.txt into translate.txt.bin next to it (or the -o file).
+ * The viewer maps the image instead of parsing the text file as long as the
+ * text file keeps the size and modification time it had when compiled, so
+ * run this again after every edit, and copy both files preserving their
+ * times (scp -p, cp -p) or run it on the target.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compiles a translate.txt file for the QML viewer.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("file", "translate.txt file to compile.");
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "Image file, default <file>.bin.", "image");
+    parser.addOption(outputOption);
+    parser.process(app);
+
+    if (parser.positionalArguments().count() != 1)
+        parser.showHelp(1);
+
+    QString sourceFile = parser.positionalArguments().at(0);
+    QString imageFile = parser.isSet(outputOption) ? parser.value(outputOption) : RuleImage::imageFileName(sourceFile);
+
+    TranslationRules rules;
+    if (!rules.loadText(sourceFile, 0))
+        return 1;
+
+    QFileInfo source(sourceFile);
+    QByteArray image = RuleImage::build(rules, source.size(), source.lastModified().toMSecsSinceEpoch());
+
+    /* Written aside and renamed, a running viewer never maps a partial image */
+    QSaveFile file(imageFile);
+    if (!file.open(QIODevice::WriteOnly) || file.write(image) != image.size() || !file.commit())
+    {
+        fprintf(stderr, "translatec: unable to write %s: %s\n", qPrintable(imageFile), qPrintable(file.errorString()));
+        return 1;
+    }
+
+    RuleImage check;
+    if (!check.open(imageFile, sourceFile) || check.count() != rules.count())
+    {
+        fprintf(stderr, "translatec: %s does not verify\n", qPrintable(imageFile));
+        return 1;
+    }
+
+    printf("%s: %d rules, %d bytes\n", qPrintable(imageFile), rules.count(), image.size());
+    return 0;
+}
@@ -0,0 +1,23 @@
+TEMPLATE = app
+TARGET = translatec
+
+QT -= gui
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+# Offline compiler for translate.txt, see ruleimage.h. Builds for the host
+# and for the target.
+INCLUDEPATH += ../..
+
+SOURCES += \
+    main.cpp \
+    ../../translationrules.cpp \
+    ../../ruleimage.cpp \
+    ../../wildcardrules.cpp \
+    ../../logging.cpp
+
+HEADERS += \
+    ../../translationrules.h \
+    ../../ruleimage.h \
+    ../../wildcardrules.h \
+    ../../logging.h
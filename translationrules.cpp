@@ -0,0 +1,296 @@
+#include <QFile>
+#include <QTextStream>
+#include "translationrules.h"
+#include "ruleimage.h"
+#include "logging.h"
+
+TranslationRules::TranslationRules() :
+    m_count(0)
+  ,m_image(0)
+{
+}
+
+
+TranslationRules::~TranslationRules()
+{
+    delete m_image;
+}
+
+
+bool TranslationRules::load(const QString &fileName, int maxRules)
+{
+    clear();
+
+    /* An up to date compiled image is mapped as is, no parsing and no limit */
+    RuleImage *image = new RuleImage;
+    if (image->open(RuleImage::imageFileName(fileName), fileName))
+    {
+        qCInfo(lcTranslator) << "[TRANSLATE] Using compiled rules" << RuleImage::imageFileName(fileName)
+                             << "," << image->count() << "rules";
+        m_image = image;
+        return true;
+    }
+    delete image;
+
+    return loadText(fileName, maxRules);
+}
+
+
+bool TranslationRules::loadText(const QString &fileName, int maxRules)
+{
+    clear();
+
+    QFile inputFile;
+    inputFile.setFileName(fileName);
+
+    if (inputFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        qCInfo(lcTranslator) << "[TRANSLATE] Loading" << fileName;
+
+        QTextStream in(&inputFile);
+        int i = 1;
+        while (!in.atEnd())
+        {
+            if (maxRules > 0 && m_count > maxRules)
+            {
+                qCWarning(lcTranslator) << "[TRANSLATE] Too many translation rules, maximum allowed: " << maxRules
+                                        << ". Compile the file with translatec to lift the limit.";
+                break;
+            }
+
+            QString line = in.readLine();
+
+            if (line.isEmpty() || line.startsWith("#") || line.startsWith("/"))
+                qCDebug(lcTranslator) << "[TRANSLATE] Ignoring line" << i << ":" << line;
+            else
+                addLine(line, i);
+            i+=1;
+        }
+
+        inputFile.close();
+        return true;
+    }
+    else
+    {
+        qCWarning(lcTranslator) << "[QMLVIEWER] Could not open translate file: " << inputFile.fileName().toLatin1();
+        return false;
+    }
+}
+
+
+bool TranslationRules::addLine(const QString &line, int lineNumber)
+{
+    /*
+         * Translations are one per line in the form of:
+         * O:K,M:G\n
+         *
+         * where:
+         *  O = origin (G = GUI, M = micro)
+         *  K = key, a string to match* or % for default translation
+         *  M = marker
+         *  G = message
+         *
+         *  * The key can contain a "setter" of the form "=%d" or "=%s" which
+         *    allows for numeric or string substitutions into the message.
+         */
+
+    //Check for empty line
+    if (line == "\n" || line == "\r")
+        return false;
+
+    if (!line.startsWith("G") && !line.startsWith("M"))
+    {
+        qCDebug(lcTranslator) << "[TRANSLATE] Ignoring line" << lineNumber << ":" << line;
+        return false;
+    }
+
+    //Split the line on a comma
+    QStringList list = line.split(",");
+    if (list.length() != 2)
+    {
+        qCWarning(lcTranslator) << "[TRANSLATE] line in wrong format" << lineNumber << ":" << line;
+        return false;
+    }
+
+    //Split both lines on colon
+    QStringList originKey = list[0].split(":");
+    QStringList markerMessage = list[1].split(":");
+
+    if (originKey.length() != 2 || markerMessage.length() != 2)
+    {
+        qCWarning(lcTranslator) << "[TRANSLATE] line in wrong format" << lineNumber << ":" << line;
+        return false;
+    }
+
+    QString origin = originKey[0];
+    if (origin != "G" && !origin.startsWith("M"))
+    {
+        qCWarning(lcTranslator) << "[TRANSLATE] line in wrong format" << lineNumber << ":" << line;
+        return false;
+    }
+
+    QString key = originKey[1];
+    if (key.indexOf("%d") < 0 && key.indexOf("%s") < 0)
+    {
+        qCWarning(lcTranslator) << "[TRANSLATE] line in wrong format" << lineNumber << ":" << line;
+        return false;
+    }
+
+    if (markerMessage[0] != "T")
+    {
+        qCWarning(lcTranslator) << "[TRANSLATE] line in wrong format" << lineNumber << ":" << line;
+        return false;
+    }
+
+    //key can only have a %s or %d
+    if (key.indexOf("%d") > 0)
+        key.replace("%d", "");
+    else
+        key.replace("%s", "");
+
+    OriginTable &table = m_origins[origin];
+
+    /* An empty key is the default rule of the origin, unmatched messages pass through. */
+    if (key.length() == 0)
+    {
+        if (table.hasDefault && origin != "G")
+        {
+            qCWarning(lcTranslator) << "[TRANSLATE] line " << lineNumber << " not added. MCU key already exists:" << key;
+            return false;
+        }
+
+        table.hasDefault = true;
+        m_count += 1;
+        return true;
+    }
+
+    if (WildcardRules::isWildcard(key))
+    {
+        QString error;
+        if (!table.wildcards.add(key, markerMessage[1], &error))
+        {
+            qCWarning(lcTranslator) << "[TRANSLATE] line " << lineNumber << " not added," << error << ":" << origin + ":" + key;
+            return false;
+        }
+
+        m_count += 1;
+        return true;
+    }
+
+    if (find(table, QStringRef(&key)))
+    {
+        if (origin == "G")
+            qCWarning(lcTranslator) << "[TRANSLATE] line " << lineNumber << " not added. GUI key already exists:" << key;
+        else
+            qCWarning(lcTranslator) << "[TRANSLATE] line " << lineNumber << " not added. MCU key already exists:" << origin + ":" + key;
+        return false;
+    }
+
+    /* Split the template once, the placeholder is only replaced when it is not the first thing. */
+    QString message = markerMessage[1];
+    Rule rule;
+    rule.key = key;
+    if (message.indexOf("%d") > 0)
+        rule.literals = message.split("%d");
+    else if (message.indexOf("%s") > 0)
+        rule.literals = message.split("%s");
+    else
+        rule.literals << message;
+
+    rule.literalLength = 0;
+    foreach (const QString &literal, rule.literals)
+        rule.literalLength += literal.length();
+
+    table.index.insert(qHash(QStringRef(&rule.key)), table.rules.count());
+    table.rules.append(rule);
+    m_count += 1;
+    return true;
+}
+
+
+void TranslationRules::clear()
+{
+    delete m_image;
+    m_image = 0;
+    m_origins.clear();
+    m_count = 0;
+}
+
+
+int TranslationRules::count() const
+{
+    return m_image ? m_image->count() : m_count;
+}
+
+
+bool TranslationRules::isCompiled() const
+{
+    return m_image != 0;
+}
+
+
+TranslationRules::Result TranslationRules::translate(const QString &origin, const QString &message, QString *out) const
+{
+    if (m_image)
+        return m_image->translate(origin, message, out);
+
+    QHash<QString, OriginTable>::const_iterator table = m_origins.constFind(origin);
+    if (table == m_origins.constEnd())
+        return Miss;
+
+    /* The key is the text up to and including '=', without '=' it can't match */
+    int pos = message.indexOf('=');
+    QStringRef key = message.leftRef(pos + 1);
+    const Rule *rule = find(table.value(), key);
+    if (rule)
+    {
+        render(*rule, message.midRef(pos + 1), out);
+        return Translated;
+    }
+
+    if (table.value().wildcards.translate(key, message.midRef(pos + 1), out))
+        return Translated;
+
+    if (table.value().hasDefault)
+    {
+        *out = message;
+        return Default;
+    }
+
+    return Miss;
+}
+
+
+const TranslationRules::Rule *TranslationRules::find(const OriginTable &table, const QStringRef &key) const
+{
+    if (key.isEmpty())
+        return 0;
+
+    uint hash = qHash(key);
+    QMultiHash<uint, int>::const_iterator it = table.index.constFind(hash);
+
+    while (it != table.index.constEnd() && it.key() == hash)
+    {
+        const Rule &rule = table.rules.at(it.value());
+        if (rule.key == key)
+            return &rule;
+        ++it;
+    }
+
+    return 0;
+}
+
+
+void TranslationRules::render(const Rule &rule, const QStringRef &value, QString *out)
+{
+    int placeholders = rule.literals.count() - 1;
+
+    out->clear();
+    out->reserve(rule.literalLength + placeholders * value.length());
+    out->append(rule.literals.at(0));
+    for (int i = 1; i <= placeholders; i++)
+    {
+        out->append(value);
+        out->append(rule.literals.at(i));
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef TRANSLATIONRULES_H
+#define TRANSLATIONRULES_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
+#include "wildcardrules.h"
+
+class RuleImage;
+
+/*
+ * Compiled translate.txt rules.
+ *
+ * Rules are grouped per origin ("G" for the GUI, "M..." for each translate_id)
+ * so a lookup never builds an "origin:key" string. Each table is indexed by
+ * the hash of the key (the text up to and including '='), computed straight
+ * from the message with a QStringRef.
+ *
+ * Templates are split on their placeholder when the rule is added, rendering
+ * is a single reserve followed by appends. Like the original implementation
+ * every occurrence of the placeholder is replaced, "%d" wins over "%s", and a
+ * placeholder at the very start of the template is left as is.
+ *
+ * Keys with a '*' are wildcard rules (see WildcardRules), they are only tried
+ * when no exact rule matches.
+ *
+ * load() uses the compiled image of the file (see RuleImage) when there is an
+ * up to date one, it is queried in place and has no rule limit.
+ */
+class TranslationRules
+{
+public:
+    enum Result {
+        Translated,
+        Default,
+        Miss
+    };
+
+    TranslationRules();
+    ~TranslationRules();
+
+    bool load(const QString &fileName, int maxRules);
+    bool loadText(const QString &fileName, int maxRules);
+    bool addLine(const QString &line, int lineNumber);
+    void clear();
+    int count() const;
+    bool isCompiled() const;
+
+    Result translate(const QString &origin, const QString &message, QString *out) const;
+
+private:
+    Q_DISABLE_COPY(TranslationRules)
+    friend class RuleImage;
+
+    struct Rule {
+        QString key;
+        /* literal, value, literal, value ... literal */
+        QStringList literals;
+        int literalLength;
+    };
+
+    struct OriginTable {
+        OriginTable() : hasDefault(false) {}
+
+        QVector<Rule> rules;
+        QMultiHash<uint, int> index;
+        WildcardRules wildcards;
+        bool hasDefault;
+    };
+
+    const Rule *find(const OriginTable &table, const QStringRef &key) const;
+    static void render(const Rule &rule, const QStringRef &value, QString *out);
+
+    QHash<QString, OriginTable> m_origins;
+    int m_count;
+    RuleImage *m_image;
+};
+
+#endif // TRANSLATIONRULES_H
@@ -1,8 +1,15 @@
+#include <QtConcurrent>
 #include "translator.h"
+#include "ruleimage.h"
+#include "logging.h"
 
 Translator::Translator(QString translateFile, int translateMaxMapSize, QObject *parent) :
     QObject(parent)
+  ,m_rules(new TranslationRules)
   ,m_watcher (new QFileSystemWatcher(this))
+  ,m_reloadTimer(new QTimer(this))
+  ,m_reloadWatcher(new QFutureWatcher<QSharedPointer<TranslationRules> >(this))
+  ,m_reloadPending(false)
 {
     m_translateFile = translateFile;
     m_translateMaxMapSize = translateMaxMapSize;
@@ -15,15 +22,30 @@ Translator::Translator(QString translateFile, int translateMaxMapSize, QObject *
 
     /* Add a watcher to the translate file, so we can reload it when updated. */
     connect(m_watcher, SIGNAL(fileChanged(const QString &)), this, SLOT(onFileChanged(const QString &)));
-    m_watcher->addPath(m_translateFile.toLatin1());
-
-    m_defaultGuiMessage.set = false;
-    m_defaultGuiMessage.message = "";
+    watchFiles();
+
+    /* Editors save in several writes, reload once things have settled */
+    m_reloadTimer->setSingleShot(true);
+    m_reloadTimer->setInterval(TRANSLATION_RELOAD_DELAY);
+    connect(m_reloadTimer, SIGNAL(timeout()), this, SLOT(onReloadTimeout()));
+    connect(m_reloadWatcher, SIGNAL(finished()), this, SLOT(onReloadFinished()));
+
+    Metrics *metrics = Metrics::instance();
+    m_guiHits = metrics->counter("qmlviewer_translations_total", "Translation lookups.", "direction=\"gui\",result=\"hit\"");
+    m_guiMisses = metrics->counter("qmlviewer_translations_total", "Translation lookups.", "direction=\"gui\",result=\"miss\"");
+    m_mcuHits = metrics->counter("qmlviewer_translations_total", "Translation lookups.", "direction=\"mcu\",result=\"hit\"");
+    m_mcuMisses = metrics->counter("qmlviewer_translations_total", "Translation lookups.", "direction=\"mcu\",result=\"miss\"");
+    m_reloads = metrics->counter("qmlviewer_translation_reloads_total", "Translate file reloads.", "result=\"ok\"");
+    m_reloadFailures = metrics->counter("qmlviewer_translation_reloads_total", "Translate file reloads.", "result=\"failed\"");
 }
 
 
 Translator::~Translator()
 {
+    /* The rules being built are dropped with the future's result */
+    m_reloadWatcher->disconnect(this);
+    m_reloadWatcher->waitForFinished();
+
     if (m_watcher)
         delete m_watcher;
 }
@@ -31,46 +53,38 @@ Translator::~Translator()
 
 bool Translator::loadTranslations()
 {
-    m_guiHash.clear();
-    m_mcuHash.clear();
-    m_translationCount = 0;
-    m_defaultGuiMessage.set = false;
-    m_defaultGuiMessage.message = "";
-    m_mcuDefaultMessages.clear();
-
-    QFile inputFile;    
-    inputFile.setFileName(m_translateFile.toLatin1());
+    QSharedPointer<TranslationRules> rules = buildRules(m_translateFile, m_translateMaxMapSize);
+    if (rules.isNull())
+        return false;
 
-    if (inputFile.open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        qDebug() << "[TRANSLATE] Loading" << m_translateFile;
+    m_rules = rules;
+    return true;
+}
 
-        QTextStream in(&inputFile);
-        int i = 1;
-        while (!in.atEnd())
-        {
-            if (m_translationCount > m_translateMaxMapSize)
-            {
-                qDebug() << "[TRANSLATE] Too many translation rules, maximum allowed: " << m_translateMaxMapSize;
-                break;
-            }
 
-            QString line = in.readLine();
+QSharedPointer<TranslationRules> Translator::buildRules(QString translateFile, int translateMaxMapSize)
+{
+    QSharedPointer<TranslationRules> rules(new TranslationRules);
+    if (!rules->load(translateFile, translateMaxMapSize))
+        rules.clear();
+    return rules;
+}
 
-            if (line.isEmpty() || line.startsWith("#") || line.startsWith("/"))
-                qDebug() << "[TRANSLATE] Ignoring line" << i << ":" << line;
-            else
-                traslateAddMapping(line, i);
-            i+=1;
-        }
 
-        inputFile.close();
-        return true;
-    }
-    else
+void Translator::watchFiles()
+{
+    /*
+     * Saving by rename replaces the inode and the watcher drops the path, so
+     * add the files back whenever they exist. The compiled image is watched
+     * too, translatec rewrites it without touching translate.txt.
+     */
+    QStringList files;
+    files << m_translateFile << RuleImage::imageFileName(m_translateFile);
+
+    foreach (const QString &file, files)
     {
-        qDebug() << "[QMLVIEWER] Could not open translate file: " << inputFile.fileName().toLatin1();
-        return false;
+        if (!m_watcher->files().contains(file) && QFile::exists(file))
+            m_watcher->addPath(file);
     }
 }
 
@@ -81,25 +95,20 @@ QString Translator::translateGuiMessage(QString message)
     if (message.isEmpty() || message.isNull())
         return "";
 
-    /* see if we have a key */
-    QString key = message.mid(0, message.indexOf("=")+1);
-    QString value = message.mid(message.indexOf("=")+1, message.length());
-
-    if (m_guiHash.contains(key))
+    QString translated;
+    switch (m_rules->translate(QStringLiteral("G"), message, &translated))
     {
-        qDebug() << "[TRANSLATE] GUI key found:" << key;
-        //We need to replace %d or %s with the value
-        QString message = m_guiHash.value(key).message;
-        if (message.indexOf("%d") > 0)
-            message = message.replace("%d", value);
-        else if (message.indexOf("%s") > 0)
-            message = message.replace("%s", value);
-        return message;
+    case TranslationRules::Translated:
+        m_guiHits->add();
+        qCDebug(lcTranslator) << "[TRANSLATE] GUI key found:" << message.left(message.indexOf("=")+1);
+        return translated;
+    case TranslationRules::Default:
+        m_guiMisses->add();
+        return translated;
+    default:
+        m_guiMisses->add();
+        return "";
     }
-    else if (m_defaultGuiMessage.set)
-        return message;
-
-    return "";
 }
 
 QString Translator::translateMCUMessage(QString origin, QString message)
@@ -108,161 +117,66 @@ QString Translator::translateMCUMessage(QString origin, QString message)
     if (message.isEmpty() || message.isNull())
         return "";
 
-    /* see if we have a key */
-    QString key = origin + ":" + message.mid(0, message.indexOf("=")+1);
-    QString value = message.mid(message.indexOf("=")+1, message.length());
-
-    if (m_mcuHash.contains(key))
+    QString translated;
+    switch (m_rules->translate(origin, message, &translated))
     {
-        qDebug() << "[TRANSLATE] MCU key found:" << key;
-
-        //We need to replace %d or %s with the value
-        QString message = m_mcuHash.value(key).message;
-        if (message.indexOf("%d") > 0)
-            message = message.replace("%d", value);
-        else if (message.indexOf("%s") > 0)
-            message = message.replace("%s", value);
-
-        return message;
+    case TranslationRules::Translated:
+        m_mcuHits->add();
+        qCDebug(lcTranslator) << "[TRANSLATE] MCU key found:" << origin + ":" + message.left(message.indexOf("=")+1);
+        return translated;
+    case TranslationRules::Default:
+        m_mcuMisses->add();
+        return translated;
+    default:
+        m_mcuMisses->add();
+        return "";
     }
-    else if (m_mcuDefaultMessages.contains(origin))
-        return message;
-
-    return "";
 }
 
-bool Translator::traslateAddMapping(const QString line, int lineNumber)
+void Translator::onFileChanged(const QString &path)
 {
-    /*
-         * Translations are one per line in the form of:
-         * O:K,M:G\n
-         *
-         * where:
-         *  O = origin (G = GUI, M = micro)
-         *  K = key, a string to match* or % for default translation
-         *  M = marker
-         *  G = message
-         *
-         *  * The key can contain a "setter" of the form "=%d" or "=%s" which
-         *    allows for numeric or string substitutions into the message.
-         */
-
-    QString origin, key, marker, message;
+    qCInfo(lcTranslator) << "[TRANSLATE] File has changed:" << path;
+    watchFiles();
+    m_reloadTimer->start();
+}
 
-    //Check for empty line
-    if (line == "\n" || line == "\r")
-        return false;
 
-    if (line.startsWith("G") || line.startsWith("M"))
+void Translator::onReloadTimeout()
+{
+    /* One build at a time, changes made meanwhile trigger another one after it */
+    if (m_reloadWatcher->isRunning())
     {
-        //Split the line on a comma
-        QStringList list = line.split(",");
-        if (list.length() != 2)
-        {
-            qDebug() << "[TRANSLATE] line in wrong format" << lineNumber << ":" << line;
-            return false;
-        }
-
-        //Split both lines on colon
-        QStringList originKey = list[0].split(":");
-        QStringList markerMessage = list[1].split(":");
-
-        if (originKey.length() != 2 || markerMessage.length() != 2)
-        {
-            qDebug() << "[TRANSLATE] line in wrong format" << lineNumber << ":" << line;
-            return false;
-        }
-
-        //Add to Struct and Hash
-        QString origin = originKey[0];
-        if (origin != "G" && !origin.startsWith("M"))
-        {
-            qDebug() << "[TRANSLATE] line in wrong format" << lineNumber << ":" << line;
-            return false;
-        }
-
-        QString key = originKey[1];
-        if (key.indexOf("%d") < 0 && key.indexOf("%s") < 0)
-        {
-            qDebug() << "[TRANSLATE] line in wrong format" << lineNumber << ":" << line;
-            return false;
-        }
-
-        QString marker = markerMessage[0];
-        if (marker != "T")
-        {
-            qDebug() << "[TRANSLATE] line in wrong format" << lineNumber << ":" << line;
-            return false;
-        }
-
-        QString message = markerMessage[1];
-        KeyValue kv;
-
-        //key can only have a %s or %d
-        if (key.indexOf("%d") > 0)
-        {
-            kv.type = "d";
-            key.replace("%d", "");
-        }
-        else
-        {
-            kv.type = "s";
-            key.replace("%s", "");
-        }
+        m_reloadPending = true;
+        return;
+    }
 
-        kv.marker = marker;
-        kv.message = message;
+    /* Messages keep using the current rules while the new ones are built */
+    m_reloadWatcher->setFuture(QtConcurrent::run(&Translator::buildRules, m_translateFile, m_translateMaxMapSize));
+}
 
-        /* Add items to HASH */
-        if (origin == "G")
-        {
-            if (key.length() == 0)
-                m_defaultGuiMessage.set = true;
-            else if (!m_guiHash.contains(key))
-                m_guiHash.insert(key, kv);
-            else
-            {
-                qDebug() << "[TRANSLATE] line " << lineNumber << " not added. GUI key already exists:" << key;
-                return false;
-            }
 
-        }
-        else
-        {
-            if (key.length() == 0)
-            {
-                if (!m_mcuDefaultMessages.contains(origin))
-                    m_mcuDefaultMessages.insert(origin, key);
-                else
-                {
-                    qDebug() << "[TRANSLATE] line " << lineNumber << " not added. MCU key already exists:" << key;
-                    return false;
-                }
-            }
-            else if (!m_mcuHash.contains(origin + ":" + key))
-            {
-                m_mcuHash.insert(origin + ":" + key, kv);
-            }
-            else
-            {
-                qDebug() << "[TRANSLATE] line " << lineNumber << " not added. MCU key already exists:" << origin + ":" + key;
-                return false;
-            }
-        }
+void Translator::onReloadFinished()
+{
+    QSharedPointer<TranslationRules> rules = m_reloadWatcher->result();
 
-        m_translationCount += 1;
-        return true;
+    /* Translation only happens on this thread, the swap is atomic for it */
+    if (rules.isNull())
+    {
+        m_reloadFailures->add();
+        qCWarning(lcTranslator) << "[TRANSLATE] Reload failed, keeping the current" << m_rules->count() << "rules";
     }
     else
     {
-        qDebug() << "[TRANSLATE] Ignoring line" << lineNumber << ":" << line;
-        return false;
+        m_reloads->add();
+        m_rules = rules;
+        qCInfo(lcTranslator) << "[TRANSLATE] Reloaded" << m_rules->count() << "rules";
     }
-}
 
-void Translator::onFileChanged(const QString &path)
-{
-    qDebug() << "[TRANSLATE] File has changed:" << path;
-    m_watcher->addPath(TRANSLATION_FILE_PATH);
-    loadTranslations();
+    watchFiles();
+
+    if (m_reloadPending)
+    {
+        m_reloadPending = false;
+        m_reloadTimer->start();
+    }
 }
@@ -9,17 +9,11 @@
 #include <QDebug>
 #include "systemdefs.h"
 #include <QDateTime>
-
-struct KeyValue{
-    QString marker;
-    QString message;
-    QString type;
-};
-
-struct DefaultGuiMessage{
-    bool set;
-    QString message;
-};
+#include <QTimer>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include "metrics.h"
+#include "translationrules.h"
 
 class Translator : public QObject
 {
@@ -35,18 +29,28 @@ public slots:
     QString translateMCUMessage(QString origin, QString message);
 
 private slots:
-    bool traslateAddMapping(const QString line, int lineNumber);
     void onFileChanged(const QString & path);
+    void onReloadTimeout();
+    void onReloadFinished();
 
 private:
+    static QSharedPointer<TranslationRules> buildRules(QString translateFile, int translateMaxMapSize);
+    void watchFiles();
+
     QString m_translateFile;
-    QHash<QString, KeyValue> m_guiHash;
-    QHash<QString, KeyValue> m_mcuHash;
+    /* Replaced as a whole on reload, never modified once published */
+    QSharedPointer<TranslationRules> m_rules;
     QFileSystemWatcher *m_watcher;
-    int m_translationCount;
-    DefaultGuiMessage m_defaultGuiMessage;
-    QHash<QString, QString> m_mcuDefaultMessages;
+    QTimer *m_reloadTimer;
+    QFutureWatcher<QSharedPointer<TranslationRules> > *m_reloadWatcher;
+    bool m_reloadPending;
     int m_translateMaxMapSize;
+    MetricCounter *m_reloads;
+    MetricCounter *m_reloadFailures;
+    MetricCounter *m_guiHits;
+    MetricCounter *m_guiMisses;
+    MetricCounter *m_mcuHits;
+    MetricCounter *m_mcuMisses;
 };
 
 #endif // TRANSLATOR_H
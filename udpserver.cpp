@@ -0,0 +1,290 @@
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <QHostAddress>
+#include "udpserver.h"
+#include "iothread.h"
+#include "messageparser.h"
+#include "systemdefs.h"
+#include "logging.h"
+
+static int highestBit(quint64 value)
+{
+    int bit = -1;
+    while (value)
+    {
+        value >>= 1;
+        bit++;
+    }
+    return bit;
+}
+
+
+UdpServer::UdpServer(const UdpServerSetting &setting, QObject *parent) : QObject(parent)
+  ,m_fd(-1)
+  ,m_notifier(0)
+  ,m_ioThread(0)
+  ,m_sequenced(0)
+  ,m_warnedTruncated(false)
+{
+    m_port = setting.port();
+    m_bindAddress = setting.bindAddress();
+    m_multicastGroup = setting.multicastGroup();
+    m_multicastInterface = setting.multicastInterface();
+    m_receiveBufferSize = setting.receiveBufferSize();
+    m_maxDatagramSize = setting.maxDatagramSize();
+    m_parseJson = setting.parseJson();
+    m_translate = setting.translate();
+    m_translateID = setting.translateId();
+    m_name = m_multicastGroup.isEmpty() ? QString::number(m_port) : m_multicastGroup + ":" + QString::number(m_port);
+
+    /* One slot per datagram of a recvmmsg() batch, reused for every batch */
+    m_buffer.resize(UDP_BATCH * m_maxDatagramSize);
+
+    Metrics *metrics = Metrics::instance();
+    QString labels = Metrics::label("connection", "udp:" + m_name);
+    m_bytesReceived = metrics->counter("qmlviewer_bytes_received_total", "Bytes read from a connection.", labels);
+    m_datagrams = metrics->counter("qmlviewer_udp_datagrams_total", "Datagrams received.", labels);
+    m_receiveCalls = metrics->counter("qmlviewer_udp_receive_calls_total", "recvmmsg() calls that returned datagrams.", labels);
+    m_lost = metrics->counter("qmlviewer_udp_lost_total", "Datagrams missing from a sender's sequence numbers.", labels);
+    m_late = metrics->counter("qmlviewer_udp_late_total", "Late or duplicated datagrams, dropped.", labels);
+    m_truncated = metrics->counter("qmlviewer_udp_truncated_total", "Datagrams larger than max_datagram_size, dropped.", labels);
+}
+
+
+UdpServer::~UdpServer()
+{
+    delete m_notifier;
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+
+bool UdpServer::Start()
+{
+    m_fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0)
+    {
+        qCWarning(lcUdp) << "[QMLVIEWER] Error: cannot create UDP socket:" << strerror(errno);
+        return false;
+    }
+
+    /* Lets several viewers, or a capture tool, join the same group on one host */
+    int one = 1;
+    setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    if (m_receiveBufferSize > 0 && setsockopt(m_fd, SOL_SOCKET, SO_RCVBUF, &m_receiveBufferSize, sizeof(m_receiveBufferSize)) < 0)
+        qCWarning(lcUdp) << "[QMLVIEWER] Cannot set the receive buffer of UDP port" << m_port << "to" << m_receiveBufferSize << ":" << strerror(errno);
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(m_port);
+    address.sin_addr.s_addr = htonl(QHostAddress(m_bindAddress).toIPv4Address());
+
+    if (::bind(m_fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        qCWarning(lcUdp) << "[QMLVIEWER] Error: UDP server cannot bind to" << m_bindAddress << "port" << m_port << ":" << strerror(errno);
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    if (!m_multicastGroup.isEmpty())
+    {
+        struct ip_mreqn membership;
+        memset(&membership, 0, sizeof(membership));
+        membership.imr_multiaddr.s_addr = htonl(QHostAddress(m_multicastGroup).toIPv4Address());
+        membership.imr_address.s_addr = m_multicastInterface.isEmpty() ? htonl(INADDR_ANY)
+                                                                       : htonl(QHostAddress(m_multicastInterface).toIPv4Address());
+
+        if (setsockopt(m_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0)
+        {
+            qCWarning(lcUdp) << "[QMLVIEWER] Error: cannot join multicast group" << m_multicastGroup << ":" << strerror(errno);
+            ::close(m_fd);
+            m_fd = -1;
+            return false;
+        }
+    }
+
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, SIGNAL(activated(int)), this, SLOT(onReadable()));
+
+    qCInfo(lcUdp) << "[QMLVIEWER] UDP server listening on" << (m_multicastGroup.isEmpty() ? m_bindAddress : m_multicastGroup) << "port" << m_port;
+    return true;
+}
+
+
+void UdpServer::onReadable()
+{
+    struct mmsghdr messages[UDP_BATCH];
+    struct iovec vectors[UDP_BATCH];
+    struct sockaddr_in senders[UDP_BATCH];
+    char *buffer = m_buffer.data();
+
+    memset(messages, 0, sizeof(messages));
+    for (int i = 0; i < UDP_BATCH; i++)
+    {
+        vectors[i].iov_base = buffer + i * m_maxDatagramSize;
+        vectors[i].iov_len = m_maxDatagramSize;
+        messages[i].msg_hdr.msg_iov = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+        messages[i].msg_hdr.msg_name = &senders[i];
+    }
+
+    /* Bounded so a flood can't starve the event loop, the notifier fires again for what is left */
+    for (int batch = 0; batch < UDP_MAX_BATCHES; batch++)
+    {
+        for (int i = 0; i < UDP_BATCH; i++)
+            messages[i].msg_hdr.msg_namelen = sizeof(senders[i]);
+
+        int received = recvmmsg(m_fd, messages, UDP_BATCH, MSG_DONTWAIT, 0);
+        if (received <= 0)
+        {
+            if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                qCWarning(lcUdp) << "[QMLVIEWER] UDP receive error on port" << m_port << ":" << strerror(errno);
+            break;
+        }
+        m_receiveCalls->add();
+
+        for (int i = 0; i < received; i++)
+        {
+            if (messages[i].msg_hdr.msg_flags & MSG_TRUNC)
+            {
+                m_truncated->add();
+                if (!m_warnedTruncated)
+                {
+                    qCWarning(lcUdp) << "[QMLVIEWER] Datagram larger than" << m_maxDatagramSize << "bytes on port" << m_port
+                                     << ", dropped. Raise max_datagram_size.";
+                    m_warnedTruncated = true;
+                }
+                continue;
+            }
+
+            handleDatagram(ntohl(senders[i].sin_addr.s_addr), ntohs(senders[i].sin_port),
+                           (const char *)vectors[i].iov_base, messages[i].msg_len);
+        }
+
+        if (received < UDP_BATCH)
+            break;
+    }
+}
+
+
+void UdpServer::handleDatagram(quint32 address, quint16 port, const char *data, int length)
+{
+    m_datagrams->add();
+    m_bytesReceived->add(length);
+
+    quint32 sequence;
+    if (MessageParser::takeSequence(&data, &length, &sequence) && !checkSequence(address, port, sequence))
+        return;
+
+    /* The buffer is reused by the next batch, each record is copied out */
+    const char *end = data + length;
+    while (data < end)
+    {
+        const char *newline = (const char *)memchr(data, '\n', end - data);
+        const char *lineEnd = newline ? newline : end;
+        if (lineEnd > data)
+            deliver(QByteArray(data, lineEnd - data));
+        data = newline ? newline + 1 : end;
+    }
+}
+
+
+bool UdpServer::checkSequence(quint32 address, quint16 port, quint32 sequence)
+{
+    quint64 key = (quint64(address) << 16) | port;
+    QHash<quint64, Source>::iterator it = m_sources.find(key);
+    m_sequenced++;
+    if (it == m_sources.end())
+    {
+        /* Senders come back on a new ephemeral port and addresses can be spoofed, forget the stalest */
+        if (m_sources.size() >= UDP_MAX_SOURCES)
+        {
+            QHash<quint64, Source>::iterator oldest = m_sources.begin();
+            for (QHash<quint64, Source>::iterator i = m_sources.begin(); i != m_sources.end(); ++i)
+            {
+                if (i.value().lastSeen < oldest.value().lastSeen)
+                    oldest = i;
+            }
+            m_sources.erase(oldest);
+        }
+
+        Source source;
+        source.expected = sequence + 1;
+        source.lost = 0;
+        source.lastSeen = m_sequenced;
+        m_sources.insert(key, source);
+        return true;
+    }
+
+    Source &source = it.value();
+    source.lastSeen = m_sequenced;
+    /* Signed difference, so the sequence number may wrap */
+    qint32 delta = qint32(sequence - source.expected);
+
+    if (delta > 0 && delta < UDP_SEQUENCE_WINDOW)
+    {
+        quint64 before = source.lost;
+        source.lost += delta;
+        m_lost->add(delta);
+        /* Don't flood the log, report 1, 2, 4, 8... lost datagrams */
+        if (highestBit(source.lost) != highestBit(before))
+            qCWarning(lcUdp) << "[QMLVIEWER]" << QString("%1:%2").arg(QHostAddress(address).toString()).arg(port)
+                             << "on UDP port" << m_port << "lost" << delta << "datagrams," << source.lost << "in total";
+    }
+    else if (delta < 0 && delta > -UDP_SEQUENCE_WINDOW)
+    {
+        m_late->add();
+        return false;
+    }
+    else if (delta != 0)
+    {
+        qCInfo(lcUdp) << "[QMLVIEWER]" << QString("%1:%2").arg(QHostAddress(address).toString()).arg(port)
+                      << "restarted its sequence at" << sequence;
+    }
+
+    source.expected = sequence + 1;
+    return true;
+}
+
+
+void UdpServer::setIoThread(IoThread *ioThread)
+{
+    m_ioThread = ioThread;
+}
+
+
+void UdpServer::dispatchMessage(const QByteArray &ba)
+{
+    emit MessageAvailable(ba, m_parseJson, m_translate, m_translateID);
+}
+
+
+void UdpServer::deliver(const QByteArray &ba)
+{
+    if (m_ioThread)
+        m_ioThread->post(ba);
+    else
+        dispatchMessage(ba);
+}
+
+
+int UdpServer::getPort()
+{
+    return m_port;
+}
+
+bool UdpServer::getTranslate()
+{
+    return m_translate;
+}
+
+QString UdpServer::getTranslateID()
+{
+    return m_translateID;
+}
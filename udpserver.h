@@ -0,0 +1,92 @@
+#ifndef UDPSERVER_H
+#define UDPSERVER_H
+
+#include <QObject>
+#include <QSocketNotifier>
+#include <QHash>
+#include <QVector>
+#include "applicationsettings.h"
+#include "metrics.h"
+
+class IoThread;
+
+/*
+ * Receives telemetry datagrams on a unicast port or a multicast group.
+ *
+ * A datagram carries one or more obj.prop=value records separated by
+ * newlines. It may start with a sequence number, "@1042", per sender; a
+ * skipped number counts as lost datagrams, a number just below the last one
+ * is a late or duplicated datagram and is dropped so it can't overwrite newer
+ * values, a large jump either way is taken as the sender restarting. At most
+ * UDP_MAX_SOURCES senders are tracked, the one seen least recently makes room.
+ *
+ * Datagrams are read with recvmmsg(), a burst costs one wakeup and a few
+ * syscalls instead of one of each per datagram. Nothing is ever sent back.
+ */
+class UdpServer : public QObject
+{
+    Q_OBJECT
+
+    Q_PROPERTY(QString portName READ getPortName)
+
+public:
+    explicit UdpServer(const UdpServerSetting &setting, QObject *parent = 0);
+    ~UdpServer();
+
+    /* The port, prefixed with the group for a multicast server, "239.1.2.3:5000" */
+    QString getPortName() {
+           return m_name;
+    }
+
+    void setIoThread(IoThread *ioThread);
+
+signals:
+    void MessageAvailable(QByteArray ba, bool parseJson, bool translate, QString translateID);
+
+public slots:
+    int getPort();
+    bool getTranslate();
+    QString getTranslateID();
+    bool Start();
+    void dispatchMessage(const QByteArray &ba);
+
+private slots:
+    void onReadable();
+
+private:
+    struct Source {
+        quint32 expected;
+        quint64 lost;
+        quint64 lastSeen;
+    };
+
+    int m_fd;
+    QSocketNotifier *m_notifier;
+    QString m_name;
+    int m_port;
+    QString m_bindAddress;
+    QString m_multicastGroup;
+    QString m_multicastInterface;
+    int m_receiveBufferSize;
+    int m_maxDatagramSize;
+    bool m_parseJson;
+    bool m_translate;
+    QString m_translateID;
+    IoThread *m_ioThread;
+    QByteArray m_buffer;
+    QHash<quint64, Source> m_sources;
+    quint64 m_sequenced;
+    bool m_warnedTruncated;
+    MetricCounter *m_bytesReceived;
+    MetricCounter *m_datagrams;
+    MetricCounter *m_receiveCalls;
+    MetricCounter *m_lost;
+    MetricCounter *m_late;
+    MetricCounter *m_truncated;
+
+    void handleDatagram(quint32 address, quint16 port, const char *data, int length);
+    bool checkSequence(quint32 address, quint16 port, quint32 sequence);
+    void deliver(const QByteArray &ba);
+};
+
+#endif // UDPSERVER_H
@@ -0,0 +1,82 @@
+#include <QDebug>
+#include "updatecoalescer.h"
+#include "logging.h"
+
+UpdateCoalescer::UpdateCoalescer(QQuickWindow *window, QObject *parent) :
+    QObject(parent)
+  ,m_window(window)
+  ,m_updateRequested(false)
+{
+    /* afterAnimating is emitted on the GUI thread before every frame is synchronized. */
+    connect(m_window, SIGNAL(afterAnimating()), this, SLOT(flush()));
+}
+
+
+void UpdateCoalescer::enqueue(QObject *obj, const QMetaProperty &property, const QVariant &value)
+{
+    /* No frames are coming while the window is not exposed, so don't hold the write back. */
+    if (!m_window->isExposed())
+    {
+        property.write(obj, value);
+        return;
+    }
+
+    QPair<QObject*, int> key(obj, property.propertyIndex());
+    QHash<QPair<QObject*, int>, int>::const_iterator it = m_pendingIndex.constFind(key);
+    if (it != m_pendingIndex.constEnd())
+    {
+        /* The object is stored again in case the old one died and the address was reused. */
+        PendingWrite &pending = m_pending[it.value()];
+        pending.object = obj;
+        pending.property = property;
+        pending.value = value;
+        return;
+    }
+
+    PendingWrite write;
+    write.object = obj;
+    write.property = property;
+    write.value = value;
+    m_pendingIndex.insert(key, m_pending.count());
+    m_pending.append(write);
+
+    if (!m_updateRequested)
+    {
+        m_updateRequested = true;
+        m_window->update();
+    }
+}
+
+
+int UpdateCoalescer::pendingCount() const
+{
+    return m_pending.count();
+}
+
+
+void UpdateCoalescer::flush()
+{
+    m_updateRequested = false;
+    if (m_pending.isEmpty())
+        return;
+
+    /* Writes may trigger bindings that queue more writes, those go to the next frame. */
+    QVector<PendingWrite> pending;
+    pending.swap(m_pending);
+    m_pendingIndex.clear();
+
+    for (int i = 0; i < pending.count(); i++)
+    {
+        const PendingWrite &write = pending.at(i);
+        QObject *obj = write.object.data();
+        if (!obj)
+            continue;
+
+        /* Skip values the property already holds, they would only re-run bindings. */
+        if (write.property.read(obj) == write.value)
+            continue;
+
+        if (!write.property.write(obj, write.value))
+            qCWarning(lcMain) << "[QMLVIEWER] coalesced write failed:" << obj->objectName() << "." << write.property.name();
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef UPDATECOALESCER_H
+#define UPDATECOALESCER_H
+
+#include <QObject>
+#include <QHash>
+#include <QPair>
+#include <QPointer>
+#include <QVariant>
+#include <QVector>
+#include <QMetaProperty>
+#include <QQuickWindow>
+
+/*
+ * Buffers property writes and applies them once per frame.
+ *
+ * Only the newest value per (object, property) is kept and keys are flushed in
+ * the order they were first queued. The flush runs on the GUI thread right
+ * before the scene graph is synchronized, so a value received many times
+ * between two frames costs one write and one round of binding updates.
+ */
+class UpdateCoalescer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit UpdateCoalescer(QQuickWindow *window, QObject *parent = 0);
+
+    void enqueue(QObject *obj, const QMetaProperty &property, const QVariant &value);
+    int pendingCount() const;
+
+public slots:
+    void flush();
+
+private:
+    struct PendingWrite {
+        QPointer<QObject> object;
+        QMetaProperty property;
+        QVariant value;
+    };
+
+    QQuickWindow *m_window;
+    QHash<QPair<QObject*, int>, int> m_pendingIndex;
+    QVector<PendingWrite> m_pending;
+    bool m_updateRequested;
+};
+
+#endif // UPDATECOALESCER_H
@@ -1,4 +1,5 @@
 #include "watchdog.h"
+#include "logging.h"
 
 Watchdog::Watchdog(QObject *parent, bool startWatchdog) :
     QObject(parent)
@@ -25,7 +26,7 @@ bool Watchdog::start()
     //If the watchdog is already started then don't start
     if (m_started)
     {
-        qDebug() << "[QML] watchdog error: watchdog has already been started";
+        qCWarning(lcWatchdog) << "[QML] watchdog error: watchdog has already been started";
         emit watchdogError(QString("Watchdog error: watchdog has already been started."));
         return false;
     }
@@ -34,12 +35,12 @@ bool Watchdog::start()
 
     if (fd == -1)
     {
-        qDebug() << "[QML] Watchdog Error:  Open failed on " << dev;
+        qCWarning(lcWatchdog) << "[QML] Watchdog Error:  Open failed on " << dev;
         emit watchdogError(QString("Watchdog open failed on ").append(dev));
         return false;
     }
 
-    qDebug() << "[QML] starting watchdog timer";
+    qCInfo(lcWatchdog) << "[QML] starting watchdog timer";
     m_started = true;
     return true;
 }
@@ -64,20 +65,20 @@ void Watchdog::stop()
     if (m_timer->isActive())
         m_timer->stop();
 
-    qDebug() << "[QML] stopped watchdog timer";
+    qCInfo(lcWatchdog) << "[QML] stopped watchdog timer";
 }
 
 bool Watchdog::setInterval(int interval)
 {
     if (interval < 30 || interval > 128)
     {
-        qDebug() << "[QML] Watchdog error : set interval failed.  Interval must be >= 30 seconds and <= 128 seconds.";
+        qCWarning(lcWatchdog) << "[QML] Watchdog error : set interval failed.  Interval must be >= 30 seconds and <= 128 seconds.";
         emit watchdogError("Interval must be >= 30 seconds and <= 128 seconds.");
         return false;
     }
 
     if (ioctl(fd, WDIOC_SETTIMEOUT, &interval) != 0) {
-        qDebug() << "[QML] Watchdog error : set interval failed.";
+        qCWarning(lcWatchdog) << "[QML] Watchdog error : set interval failed.";
         if (m_started)
             stop();
         emit watchdogError("Set interval failed.  Watchdog may not have been started.");
@@ -91,7 +92,7 @@ bool Watchdog::setInterval(int interval)
         m_timer->start(static_cast<int>(interval/2) * 1000);
     }
 
-    qDebug() << "[QML] watchdog set interval: " << interval;
+    qCInfo(lcWatchdog) << "[QML] watchdog set interval: " << interval;
     return true;
 }
 
@@ -102,7 +103,7 @@ int Watchdog::getInterval()
         return interval;
     }
     else {
-        qDebug() << "[QML] watchdog error: get interval failed";
+        qCWarning(lcWatchdog) << "[QML] watchdog error: get interval failed";
         if (m_started)
             stop();
         emit watchdogError("Get interval failed.  Watchdog may not have been started.");
@@ -115,7 +116,7 @@ bool Watchdog::keepAlive()
 {
     int size = 0;
     size =  write(fd, "W", 1);
-    qDebug() << "[QML] watchdog kicked.";
+    qCDebug(lcWatchdog) << "[QML] watchdog kicked.";
     return size;
 }
 
@@ -127,7 +128,7 @@ bool Watchdog::lastBootByWatchDog()
             return true;
     }
     else{
-        qDebug() << "[QML] watchdog error: get boot status failed.";
+        qCWarning(lcWatchdog) << "[QML] watchdog error: get boot status failed.";
         if (m_started)
             stop();
         emit watchdogError("Get boot status failed.  Watchdog may not have been started.");
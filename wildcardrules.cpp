@@ -0,0 +1,218 @@
+#include "wildcardrules.h"
+
+WildcardRules::WildcardRules()
+{
+}
+
+
+bool WildcardRules::isWildcard(const QString &key)
+{
+    return key.contains('*');
+}
+
+
+bool WildcardRules::add(const QString &pattern, const QString &message, QString *error)
+{
+    int stars = pattern.count('*');
+    if (stars == 0)
+    {
+        *error = "no wildcard in key";
+        return false;
+    }
+    if (stars > WILDCARD_MAX_CAPTURES)
+    {
+        *error = QString("more than %1 wildcards in key").arg(WILDCARD_MAX_CAPTURES);
+        return false;
+    }
+    if (pattern.contains("**"))
+    {
+        *error = "adjacent wildcards in key";
+        return false;
+    }
+
+    /* Nodes are referred to by index, m_nodes grows while walking */
+    if (m_nodes.isEmpty())
+        m_nodes.append(Node());
+
+    int node = 0;
+    for (int i = 0; i < pattern.length(); i++)
+    {
+        QChar c = pattern.at(i);
+        int next = c == '*' ? m_nodes.at(node).star : m_nodes.at(node).children.value(c.unicode(), -1);
+        if (next < 0)
+        {
+            next = m_nodes.count();
+            m_nodes.append(Node());
+            if (c == '*')
+                m_nodes[node].star = next;
+            else
+                m_nodes[node].children.insert(c.unicode(), next);
+        }
+        node = next;
+    }
+
+    if (m_nodes.at(node).rule >= 0)
+    {
+        *error = "key already exists";
+        return false;
+    }
+
+    /* Same placeholder rules as exact rules, captures are only numbered up to the stars */
+    QString placeholder;
+    if (message.indexOf("%d") > 0)
+        placeholder = "%d";
+    else if (message.indexOf("%s") > 0)
+        placeholder = "%s";
+
+    Rule rule;
+    rule.literalLength = 0;
+    rule.values = 0;
+
+    Part literal;
+    literal.type = Literal;
+    literal.capture = 0;
+
+    int i = 0;
+    while (i < message.length())
+    {
+        Part part;
+        part.capture = 0;
+
+        if (!placeholder.isEmpty() && message.midRef(i, 2) == placeholder)
+        {
+            part.type = Value;
+            rule.values += 1;
+        }
+        else if (message.at(i) == '$' && i + 1 < message.length()
+                 && message.at(i + 1) >= '1' && message.at(i + 1).unicode() - '0' <= stars)
+        {
+            part.type = Capture;
+            part.capture = message.at(i + 1).unicode() - '1';
+        }
+        else
+        {
+            literal.text.append(message.at(i));
+            i += 1;
+            continue;
+        }
+
+        if (!literal.text.isEmpty())
+        {
+            rule.literalLength += literal.text.length();
+            rule.parts.append(literal);
+            literal.text.clear();
+        }
+        rule.parts.append(part);
+        i += 2;
+    }
+
+    if (!literal.text.isEmpty())
+    {
+        rule.literalLength += literal.text.length();
+        rule.parts.append(literal);
+    }
+
+    m_nodes[node].rule = m_rules.count();
+    m_rules.append(rule);
+
+    Entry entry;
+    entry.pattern = pattern;
+    entry.message = message;
+    m_entries.append(entry);
+    return true;
+}
+
+
+bool WildcardRules::translate(const QStringRef &key, const QStringRef &value, QString *out) const
+{
+    if (m_rules.isEmpty() || key.isEmpty())
+        return false;
+
+    /* Offset and length of what each star matched */
+    int captures[WILDCARD_MAX_CAPTURES * 2];
+    int index = -1;
+    const QChar *begin = key.constData();
+    if (!match(0, begin, begin, begin + key.length(), 0, captures, &index))
+        return false;
+
+    const Rule &rule = m_rules.at(index);
+    out->clear();
+    out->reserve(rule.literalLength + rule.values * value.length() + key.length());
+    foreach (const Part &part, rule.parts)
+    {
+        switch (part.type)
+        {
+        case Literal:
+            out->append(part.text);
+            break;
+        case Capture:
+            out->append(begin + captures[part.capture * 2], captures[part.capture * 2 + 1]);
+            break;
+        case Value:
+            out->append(value);
+            break;
+        }
+    }
+
+    return true;
+}
+
+
+bool WildcardRules::match(int node, const QChar *p, const QChar *begin, const QChar *end, int depth, int *captures, int *rule) const
+{
+    const Node &n = m_nodes.at(node);
+
+    if (p == end)
+    {
+        if (n.rule < 0)
+            return false;
+        *rule = n.rule;
+        return true;
+    }
+
+    int child = n.children.value(p->unicode(), -1);
+    if (child >= 0 && match(child, p + 1, begin, end, depth, captures, rule))
+        return true;
+
+    /* A star never runs past a '.' or '=', so the backtracking stays within one segment */
+    if (n.star >= 0)
+    {
+        const QChar *q = p;
+        while (q < end && *q != '.' && *q != '=')
+        {
+            ++q;
+            captures[depth * 2] = p - begin;
+            captures[depth * 2 + 1] = q - p;
+            if (match(n.star, q, begin, end, depth + 1, captures, rule))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+
+void WildcardRules::clear()
+{
+    m_nodes.clear();
+    m_rules.clear();
+    m_entries.clear();
+}
+
+
+int WildcardRules::count() const
+{
+    return m_rules.count();
+}
+
+
+bool WildcardRules::isEmpty() const
+{
+    return m_rules.isEmpty();
+}
+
+
+const QVector<WildcardRules::Entry> &WildcardRules::entries() const
+{
+    return m_entries;
+}
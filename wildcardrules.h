@@ -0,0 +1,77 @@
+#ifndef WILDCARDRULES_H
+#define WILDCARDRULES_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+
+#define WILDCARD_MAX_CAPTURES 9
+
+/*
+ * Wildcard translation rules of one origin, e.g.
+ *
+ *   M:tank*.level=%s,T:tank$1.value=%s
+ *
+ * A '*' in the key matches one or more characters up to the next '.' or '=',
+ * "$1".."$9" in the template insert what the stars matched, in order. The
+ * value placeholder works like in exact rules.
+ *
+ * The keys are merged into a trie walked one character at a time, a lookup
+ * costs the length of the key whatever the number of rules. Literal
+ * characters are tried before a star, so "tank1.level=" wins over
+ * "tank*.level=" and the order of the rules in the file doesn't matter.
+ */
+class WildcardRules
+{
+public:
+    struct Entry {
+        QString pattern;
+        QString message;
+    };
+
+    WildcardRules();
+
+    static bool isWildcard(const QString &key);
+
+    bool add(const QString &pattern, const QString &message, QString *error);
+    bool translate(const QStringRef &key, const QStringRef &value, QString *out) const;
+    void clear();
+    int count() const;
+    bool isEmpty() const;
+    const QVector<Entry> &entries() const;
+
+private:
+    enum PartType {
+        Literal,
+        Capture,
+        Value
+    };
+
+    struct Part {
+        PartType type;
+        QString text;
+        int capture;
+    };
+
+    struct Rule {
+        QVector<Part> parts;
+        int literalLength;
+        int values;
+    };
+
+    struct Node {
+        Node() : star(-1), rule(-1) {}
+
+        QHash<ushort, int> children;
+        int star;
+        int rule;
+    };
+
+    bool match(int node, const QChar *p, const QChar *begin, const QChar *end, int depth, int *captures, int *rule) const;
+
+    QVector<Node> m_nodes;
+    QVector<Rule> m_rules;
+    QVector<Entry> m_entries;
+};
+
+#endif // WILDCARDRULES_H